@@ -10,42 +10,92 @@
 AbstractALU::AbstractALU(SpecialRegister* psr, Register* y) {
   _psr = psr;
   _y = y;
+  _lazy = false;
+  _cckind = ALU_CC_NONE;
+  _cca = _ccb = _ccres = 0;
 }
 
 // Dstr
 AbstractALU::~AbstractALU() {
 }
 
+// Lazy flags mode
+void AbstractALU::setLazyFlags(bool enabled) {
+  syncFlags();
+  _lazy = enabled;
+}
+
+bool AbstractALU::isLazyFlags() const {
+  return _lazy;
+}
+
+// Compute the pending condition codes
+void AbstractALU::writeFlags() const {
+  uint32_t n = ISNEG(_ccres) ? 1 : 0, z = (_ccres == 0 ? 1 : 0), v = 0, c = 0;
+
+  switch (_cckind) {
+    case ALU_CC_ADD:
+      v = (sub(_cca, 31, 1) == sub(_ccb, 31, 1) && sub(_ccres, 31, 1) != sub(_cca, 31, 1)) ? 1 : 0;
+      c = (_ccres < _cca || _ccres < _ccb) ? 1 : 0;
+      break;
+    case ALU_CC_SUB:
+      v = (sub(_cca, 31, 1) != sub(_ccb, 31, 1) && sub(_ccres, 31, 1) != sub(_cca, 31, 1)) ? 1 : 0;
+      c = (_ccres > _cca || _ccres > _ccb) ? 1 : 0;
+      break;
+  }
+
+  // one write for the four bits (N Z V C)
+  _psr->setField(PSR_ICC, (n << 3) | (z << 2) | (v << 1) | c);
+  _cckind = ALU_CC_NONE;
+}
+
+void AbstractALU::setFlags(uint8_t kind, uint32_t a, uint32_t b, uint32_t res) {
+  _cckind = kind;
+  _cca = a;
+  _ccb = b;
+  _ccres = res;
+  if (!_lazy)
+    writeFlags();
+}
+
 // Condition codes
 bool AbstractALU::getN() const {
+  syncFlags();
   return _psr->getField(PSR_ICC_N) == 1;
 }
 
 bool AbstractALU::getZ() const {
+  syncFlags();
   return _psr->getField(PSR_ICC_Z) == 1;
 }
 
 bool AbstractALU::getC() const {
+  syncFlags();
   return _psr->getField(PSR_ICC_C) == 1;
 }
 
 bool AbstractALU::getV() const {
+  syncFlags();
   return _psr->getField(PSR_ICC_V) == 1;
 }
 
 void AbstractALU::setN(bool v) {
+  syncFlags();
   return _psr->setField(PSR_ICC_N, v ? 1 : 0);
 }
 
 void AbstractALU::setZ(bool v) {
+  syncFlags();
   return _psr->setField(PSR_ICC_Z, v ? 1 : 0);
 }
 
 void AbstractALU::setC(bool v) {
+  syncFlags();
   return _psr->setField(PSR_ICC_C, v ? 1 : 0);
 }
 
 void AbstractALU::setV(bool v) {
+  syncFlags();
   return _psr->setField(PSR_ICC_V, v ? 1 : 0);
 }
 
@@ -48,6 +48,12 @@
 #define ALU_OP_SRL    0x26    // shift right logical
 #define ALU_OP_SRA    0x27    // shift right arithmetic : preserve the sign of the result
 
+// Kinds of operations whose condition codes are pending (lazy flags)
+#define ALU_CC_NONE   0x00    // nothing pending, the PSR is up to date
+#define ALU_CC_ADD    0x01    // ADDcc, ADDXcc
+#define ALU_CC_SUB    0x02    // SUBcc, SUBXcc
+#define ALU_CC_LOGIC  0x03    // ANDcc, ORcc, XORcc, ANDNcc, ORNcc, XNORcc : V and C are cleared
+
 /**
  * Represents an abstract arithmetic and logic unit.
  *
@@ -63,6 +69,14 @@
  * ================
  *
  * The y register is mainly used in the multiplication and division algorithm. Typically, the multiplication takes two 32-bit operands and gives a 64-bit result, from which the most significant bits are stored in y. For the division though, y contains the rest of the division.
+ *
+ * Lazy condition codes
+ * ====================
+ *
+ * Most of the *cc results are overwritten by the next *cc operation before anything reads them. In lazy flags mode, an
+ * arithmetic or logic *cc operation only records its kind, its operands and its result; the icc bits are computed and
+ * written in the PSR by syncFlags(), which must be called before the icc field of the PSR is read or the PSR is written
+ * (Bicc, Ticc, RDPSR, WRPSR, traps, or when the engine gives back the control). ADDX and SUBX get the carry this way too.
  */
 class AbstractALU {
 	public:
@@ -77,7 +91,7 @@ class AbstractALU {
     /**
      * Destructor
      */
-		~AbstractALU();
+		virtual ~AbstractALU();
 
     /**
      * Ask the ALU to make a calculus from two source registers, putting the result in a destination register
@@ -96,6 +110,31 @@ class AbstractALU {
      */
     virtual void calc(uint8_t op, const Register* rs1, uint32_t simm, Register* rd) = 0;
 
+    /**
+     * Enable or disable the lazy condition codes. Disabling them writes the pending ones.
+     * @param enabled true to compute the condition codes only when they are needed
+     */
+    void setLazyFlags(bool enabled);
+    /**
+     * Tells if the condition codes are computed lazily
+     * @returns true in lazy flags mode
+     */
+    bool isLazyFlags() const;
+    /**
+     * Write the pending condition codes, if any, in the PSR
+     */
+    void syncFlags() const;
+
+    /**
+     * Make a shift (SLL, SRL or SRA) : only the 5 least significant bits of the count are used.
+     * The engines that make the shifts themselves call it too, so that they all give the same results.
+     * @param op ALU_OP_SLL, ALU_OP_SRL or ALU_OP_SRA
+     * @param value value to shift
+     * @param count number of bits
+     * @returns the shifted value
+     */
+    static uint32_t shift(uint8_t op, uint32_t value, uint32_t count);
+
   protected:
     /**
      * Get the 'N' condition code (for negative)
@@ -146,6 +185,15 @@ class AbstractALU {
      * @see getV()
      */
     void setV(bool);
+    /**
+     * Set the four condition codes from an arithmetic or logic operation.
+     * In lazy flags mode, they are only recorded, and computed by syncFlags().
+     * @param kind kind of operation (ALU_CC_*)
+     * @param a first operand
+     * @param b second operand
+     * @param res result of the operation
+     */
+    void setFlags(uint8_t kind, uint32_t a, uint32_t b, uint32_t res);
 
     /**
      * Get the y register
@@ -166,9 +214,36 @@ class AbstractALU {
     void writeY(uint32_t);
 
 	private:
+    /**
+     * Compute the pending condition codes and write them in the PSR
+     */
+    void writeFlags() const;
+
     SpecialRegister *_psr;
     Register* _y;
+
+    /**
+     * Lazy flags : mode, and the last *cc operation (ALU_CC_NONE if the PSR is up to date)
+     */
+    bool _lazy;
+    mutable uint8_t _cckind;
+    uint32_t _cca, _ccb, _ccres;
 };
 
+// Called before each access to the icc : only a test when nothing is pending
+inline void AbstractALU::syncFlags() const {
+  if (_cckind != ALU_CC_NONE)
+    writeFlags();
+}
+
+inline uint32_t AbstractALU::shift(uint8_t op, uint32_t value, uint32_t count) {
+  count &= 0x1F;
+  if (op == ALU_OP_SLL)
+    return value << count;
+  if (op == ALU_OP_SRL)
+    return value >> count;
+  return (uint32_t)((int32_t)value >> count);
+}
+
 #endif // ABSTRACTALU_H
 
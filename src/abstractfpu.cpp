@@ -0,0 +1,101 @@
+/*
+ * abstractfpu.cpp -- implementation of the AbstractFPU class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "abstractfpu.h"
+
+// Cstr
+AbstractFPU::AbstractFPU(SpecialRegister* fsr) : _fsr(fsr) {
+  for (uint32_t nb = 0; nb < FPU_REGISTERS; nb++)
+    _f[nb] = 0;
+}
+
+// Dstr
+AbstractFPU::~AbstractFPU() {
+}
+
+// Reset
+void AbstractFPU::reset() {
+  for (uint32_t nb = 0; nb < FPU_REGISTERS; nb++)
+    _f[nb] = 0;
+  _fsr->write(0);
+  _fsr->setField(FPU_VERS, FPU_VERSION);
+}
+
+// Registers
+uint32_t AbstractFPU::read(uint32_t nb) const {
+  return _f[nb % FPU_REGISTERS];
+}
+
+void AbstractFPU::write(uint32_t nb, uint32_t value) {
+  _f[nb % FPU_REGISTERS] = value;
+}
+
+uint64_t AbstractFPU::readDouble(uint32_t nb) const {
+  return ((uint64_t)read(nb) << 32) | (uint64_t)read(nb + 1);
+}
+
+void AbstractFPU::writeDouble(uint32_t nb, uint64_t value) {
+  write(nb, (uint32_t)(value >> 32));
+  write(nb + 1, (uint32_t)value);
+}
+
+// FSR
+void AbstractFPU::loadFSR(uint32_t value) {
+  uint32_t vers = _fsr->getField(FPU_VERS), ftt = _fsr->getField(FPU_FTT);
+  _fsr->write(value);
+  _fsr->setField(FPU_VERS, vers);
+  _fsr->setField(FPU_FTT, ftt);
+}
+
+uint32_t AbstractFPU::fail(uint32_t ftt) {
+  _fsr->setField(FPU_FTT, ftt);
+  return ftt;
+}
+
+uint32_t AbstractFPU::getRounding() const {
+  return _fsr->getField(FPU_ROUND);
+}
+
+void AbstractFPU::setFCC(uint32_t fcc) {
+  _fsr->setField(FPU_FCC, fcc);
+}
+
+// Exceptions : a trapped operation leaves AEXC alone
+bool AbstractFPU::complete(uint32_t exceptions) {
+  _fsr->setField(FPU_CEXC, exceptions);
+  if ((exceptions & _fsr->getField(FPU_TEM)) != 0) {
+    fail(FPU_FTT_IEEE_EXCEPTION);
+    return false;
+  }
+  _fsr->setField(FPU_AEXC, _fsr->getField(FPU_AEXC) | exceptions);
+  _fsr->setField(FPU_FTT, FPU_FTT_NONE);
+  return true;
+}
+
+// Double operands and results
+bool AbstractFPU::isAligned(uint32_t opf, uint32_t rs1, uint32_t rs2, uint32_t rd) {
+  switch (opf) {
+    case FPU_OP_FADDD:
+    case FPU_OP_FSUBD:
+    case FPU_OP_FMULD:
+    case FPU_OP_FDIVD:
+      return ((rs1 | rs2 | rd) & 1) == 0;
+    case FPU_OP_FCMPD:
+    case FPU_OP_FCMPED:
+      return ((rs1 | rs2) & 1) == 0;
+    case FPU_OP_FSQRTD:
+      return ((rs2 | rd) & 1) == 0;
+    case FPU_OP_FDTOS:
+    case FPU_OP_FDTOI:
+      return (rs2 & 1) == 0;
+    case FPU_OP_FSMULD:
+    case FPU_OP_FITOD:
+    case FPU_OP_FSTOD:
+      return (rd & 1) == 0;
+    default:
+      return true;
+  }
+}
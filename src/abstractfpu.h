@@ -0,0 +1,182 @@
+/*
+ * abstractfpu.h -- abstract class for defining the floating-point unit
+ * -----
+ * Author: krab
+ * Version: 0.1
+ */
+/** @file */
+#ifndef ABSTRACTFPU_H
+#define ABSTRACTFPU_H
+
+#include "specialregister.h"
+#include "utils.h"
+
+// Number of f registers (a double takes an aligned pair of them)
+#define FPU_REGISTERS       32
+
+// Version of the FPU, in the FSR (7 would tell there is none)
+#define FPU_VERSION         0x00
+
+// Operations (opf of FPop1 and FPop2)
+#define FPU_OP_FMOVS        0x001
+#define FPU_OP_FNEGS        0x005
+#define FPU_OP_FABSS        0x009
+#define FPU_OP_FSQRTS       0x029
+#define FPU_OP_FSQRTD       0x02A
+#define FPU_OP_FADDS        0x041
+#define FPU_OP_FADDD        0x042
+#define FPU_OP_FSUBS        0x045
+#define FPU_OP_FSUBD        0x046
+#define FPU_OP_FMULS        0x049
+#define FPU_OP_FMULD        0x04A
+#define FPU_OP_FDIVS        0x04D
+#define FPU_OP_FDIVD        0x04E
+#define FPU_OP_FSMULD       0x069   // single operands, double result
+#define FPU_OP_FITOS        0x0C4
+#define FPU_OP_FDTOS        0x0C6
+#define FPU_OP_FITOD        0x0C8
+#define FPU_OP_FSTOD        0x0C9
+#define FPU_OP_FSTOI        0x0D1   // always rounded toward zero
+#define FPU_OP_FDTOI        0x0D2
+#define FPU_OP_FCMPS        0x051   // FPop2 : set the fcc
+#define FPU_OP_FCMPD        0x052
+#define FPU_OP_FCMPES       0x055   // same, but an unordered compare is an invalid operation
+#define FPU_OP_FCMPED       0x056
+
+// Trap types of the FSR (FPU_FTT)
+#define FPU_FTT_NONE              0x00
+#define FPU_FTT_IEEE_EXCEPTION    0x01  // an exception enabled in the TEM has occurred
+#define FPU_FTT_UNIMPLEMENTED     0x03  // unknown operation, or quad precision
+#define FPU_FTT_INVALID_REGISTER  0x06  // a double operand or result in an odd register
+
+// Exceptions, as they are in the TEM, AEXC and CEXC fields
+#define FPU_EXC_NV          0x10  // invalid operation
+#define FPU_EXC_OF          0x08  // overflow
+#define FPU_EXC_UF          0x04  // underflow
+#define FPU_EXC_DZ          0x02  // division by zero
+#define FPU_EXC_NX          0x01  // inexact
+
+// Condition codes (FPU_FCC)
+#define FPU_FCC_EQUAL       0x00
+#define FPU_FCC_LESS        0x01
+#define FPU_FCC_GREATER     0x02
+#define FPU_FCC_UNORDERED   0x03
+
+// Rounding directions (FPU_ROUND)
+#define FPU_ROUND_NEAREST   0x00
+#define FPU_ROUND_ZERO      0x01
+#define FPU_ROUND_UP        0x02  // toward +infinity
+#define FPU_ROUND_DOWN      0x03  // toward -infinity
+
+/**
+ * Represents an abstract floating-point unit.
+ *
+ * The FPU holds the 32 f registers, each one a single precision number; a double precision number takes two of
+ * them, an even one (the most significant word) and the next one, so there are 16 doubles. The registers are
+ * raw bits : the loads and stores of the engine move them without any conversion.
+ *
+ * The state of the unit is in the FSR, shared with the engine : the rounding direction and the enabled exceptions
+ * (TEM) are given by the program, the FPU writes the condition codes (by the compares), the current exceptions
+ * (CEXC) of the last operation and the accrued ones (AEXC). When an operation raises an exception enabled in the
+ * TEM, its result is not written and the engine raises an fp_exception trap, with the reason in FPU_FTT.
+ */
+class AbstractFPU {
+	public:
+    /**
+     * Constructor
+     *
+     * @param fsr the FPU state register
+     */
+		AbstractFPU(SpecialRegister* fsr);
+
+    /**
+     * Destructor
+     */
+		virtual ~AbstractFPU();
+
+    /**
+     * Clear the registers and the FSR (but the version of the unit)
+     */
+    void reset();
+
+    /**
+     * Ask the FPU to make an operation (FPop1 or FPop2)
+     * @param opf operation to make (FPU_OP_*)
+     * @param rs1 first source register
+     * @param rs2 second source register
+     * @param rd destination register
+     * @returns FPU_FTT_NONE, or the trap type (also written in the FSR) if the operation has trapped
+     */
+    virtual uint32_t execute(uint32_t opf, uint32_t rs1, uint32_t rs2, uint32_t rd) = 0;
+
+    /**
+     * Read a register
+     * @param nb number of the register
+     * @returns its bits
+     */
+    uint32_t read(uint32_t nb) const;
+    /**
+     * Write a register
+     * @param nb number of the register
+     * @param value its bits
+     */
+    void write(uint32_t nb, uint32_t value);
+    /**
+     * Read a pair of registers
+     * @param nb number of the even register
+     * @returns the bits of the double
+     */
+    uint64_t readDouble(uint32_t nb) const;
+    /**
+     * Write a pair of registers
+     * @param nb number of the even register
+     * @param value the bits of the double
+     */
+    void writeDouble(uint32_t nb, uint64_t value);
+
+    /**
+     * Write the FSR as LDFSR does : the version and the trap type are kept
+     * @param value the new FSR
+     */
+    void loadFSR(uint32_t value);
+    /**
+     * Raise a trap with a given reason (see FPU_FTT)
+     * @param ftt trap type
+     * @returns ftt
+     */
+    uint32_t fail(uint32_t ftt);
+
+  protected:
+    /**
+     * Get the rounding direction asked by the program
+     * @returns FPU_ROUND_*
+     */
+    uint32_t getRounding() const;
+    /**
+     * Set the condition codes (the compares)
+     * @param fcc FPU_FCC_*
+     */
+    void setFCC(uint32_t fcc);
+    /**
+     * Record the exceptions of an operation in CEXC; unless one of them is enabled in the TEM, they are accrued
+     * in AEXC and the operation completes.
+     * @param exceptions FPU_EXC_*
+     * @returns true if the result may be written, false if the operation has trapped
+     */
+    bool complete(uint32_t exceptions);
+    /**
+     * Check that the double operands and result of an operation are in aligned pairs of registers
+     * @param opf the operation
+     * @param rs1 first source register
+     * @param rs2 second source register
+     * @param rd destination register
+     * @returns false if a double is in an odd register
+     */
+    static bool isAligned(uint32_t opf, uint32_t rs1, uint32_t rs2, uint32_t rd);
+
+	private:
+    SpecialRegister* _fsr;
+    uint32_t _f[FPU_REGISTERS];
+};
+
+#endif // ABSTRACTFPU_H
@@ -6,6 +6,10 @@
  */
 #include "abstractmemory.h"
 
+#include <cstring>
+#include <fstream>
+#include <vector>
+
 // Implements the BadAlignmentException class
 AbstractMemory::BadAlignmentException::BadAlignmentException() : std::logic_error("This device has encountered a bad alignment problem") {
 }
@@ -13,23 +17,217 @@ AbstractMemory::BadAlignmentException::BadAlignmentException() : std::logic_erro
 AbstractMemory::BadAlignmentException::~BadAlignmentException() {
 }
 
+// Implements the FetchListener class
+AbstractMemory::FetchListener::~FetchListener() {
+}
+
 // Implements the AbstractMemory class
 // Cstr
-AbstractMemory::AbstractMemory(const uint32_t size) : _size(size) {
+AbstractMemory::AbstractMemory(const uint32_t size) : _size(size), _usetlb(true), _strict(false), _fault(MEM_FAULT_NONE), _faultaddr(0), _mapping(0), _listener(NULL) {
 }
 
 // Dstr
 AbstractMemory::~AbstractMemory() {
 }
 
-// Returns the size of the memory
-uint32_t AbstractMemory::getSize() const {
-  return _size;
+// Load a file
+uint32_t AbstractMemory::loadFile(const std::string& filename, uint32_t baseaddr) {
+  std::ifstream fs(filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!fs)
+    throw std::runtime_error("Cannot open file " + filename);
+
+  // only what fits is read
+  uint64_t length = fs.tellg();
+  uint32_t size = (baseaddr >= _size ? 0 : _size - baseaddr);
+  if (length < size)
+    size = length;
+
+  std::vector<uint8_t> content(size);
+  fs.seekg(0);
+  if (size > 0 && !fs.read((char*)content.data(), size))
+    throw std::runtime_error("Cannot read file " + filename);
+  copyIn(baseaddr, content.data(), size);
+  return size;
+}
+
+// Translation
+// By default, pages are not accessible directly
+const uint8_t* AbstractMemory::readablePage(uint32_t /*address*/) const {
+  return NULL;
+}
+
+uint8_t* AbstractMemory::writablePage(uint32_t /*address*/) {
+  return NULL;
+}
+
+void AbstractMemory::setTLB(bool enabled) {
+  _usetlb = enabled;
+  remapAll();
+}
+
+bool AbstractMemory::isTLBEnabled() const {
+  return _usetlb;
+}
+
+const SoftTLB& AbstractMemory::instructionTLB() const {
+  return _itlb;
+}
+
+const SoftTLB& AbstractMemory::dataTLB() const {
+  return _dtlb;
+}
+
+void AbstractMemory::remap(uint32_t address) {
+  _itlb.invalidate(address);
+  _dtlb.invalidate(address);
+}
+
+void AbstractMemory::remapAll() {
+  _itlb.flush();
+  _dtlb.flush();
+}
+
+// Instruction fetch
+// By default, through the instruction side of the TLB
+const uint8_t* AbstractMemory::instructionPage(uint32_t address) const {
+  return translateRead(_itlb, address & ~TLB_PAGE_MASK, TLB_PAGE_SIZE);
+}
+
+const uint8_t* AbstractMemory::fetchRun(uint32_t address, uint32_t& count) const {
+  markFetched(address);
+  const uint8_t* page = ((address & 3) == 0 ? instructionPage(address) : NULL);
+  if (page == NULL) {
+    count = 0;
+    return NULL;
+  }
+  count = (TLB_PAGE_SIZE - (address & TLB_PAGE_MASK)) >> 2;
+  return page + (address & TLB_PAGE_MASK);
+}
+
+void AbstractMemory::setFetchListener(FetchListener* listener) {
+  _listener = listener;
+}
+
+// Faults
+void AbstractMemory::setStrict(bool strict) {
+  _strict = strict;
+}
+
+void AbstractMemory::clearFault() {
+  _fault = MEM_FAULT_NONE;
+}
+
+// Find data to read
+const uint8_t* AbstractMemory::translateRead(SoftTLB& tlb, uint32_t address, uint32_t size) const {
+  if (!_usetlb || (address & TLB_PAGE_MASK) + size > TLB_PAGE_SIZE)
+    return NULL;
+
+  const uint8_t* data = tlb.lookup(address);
+  if (data == NULL) {
+    const uint8_t* page = readablePage(address);
+    if (page == NULL)
+      return NULL;
+    // the entry is read-only : the page is not written through it
+    tlb.fill(address, const_cast<uint8_t*>(page), false);
+    data = page + (address & TLB_PAGE_MASK);
+  }
+  return data;
+}
+
+// Find where to write data
+uint8_t* AbstractMemory::translateWrite(uint32_t address, uint32_t size) {
+  if (!_usetlb || (address & TLB_PAGE_MASK) + size > TLB_PAGE_SIZE)
+    return NULL;
+
+  uint8_t* data = _dtlb.lookupWritable(address);
+  if (data == NULL) {
+    uint8_t* page = writablePage(address);
+    if (page == NULL)
+      return NULL;
+    _dtlb.fill(address, page, true);
+    data = page + (address & TLB_PAGE_MASK);
+  }
+  return data;
+}
+
+// Fast paths : by default, through the TLB
+uint32_t AbstractMemory::load32(uint32_t address) const {
+  uint8_t buffer[4];
+  const uint8_t* res = translateRead(_dtlb, address, 4);
+  if (res == NULL) {
+    read(address, 4, buffer);
+    res = buffer;
+  }
+  return ((uint32_t)res[0] << 24) + ((uint32_t)res[1] << 16)
+    + ((uint32_t)res[2] << 8 ) + ((uint32_t)res[3]);
+}
+
+uint16_t AbstractMemory::load16(uint32_t address) const {
+  uint8_t buffer[2];
+  const uint8_t* res = translateRead(_dtlb, address, 2);
+  if (res == NULL) {
+    read(address, 2, buffer);
+    res = buffer;
+  }
+  return ((uint16_t)res[1] << 8)
+    +  ((uint16_t)res[0]);
+}
+
+uint64_t AbstractMemory::load64(uint32_t address) const {
+  uint32_t res1 = load32(address);   // most significant
+  uint32_t res2 = load32(address+4); // less significant
+  return ((uint64_t)res1 << 32) + ((uint64_t)res2);
+}
+
+uint32_t AbstractMemory::fetch32(uint32_t address) const {
+  // through the instruction side of the TLB
+  uint8_t buffer[4];
+  const uint8_t* res = translateRead(_itlb, address, 4);
+  if (res == NULL) {
+    read(address, 4, buffer);
+    res = buffer;
+  }
+  return ((uint32_t)res[0] << 24) + ((uint32_t)res[1] << 16)
+    + ((uint32_t)res[2] << 8 ) + ((uint32_t)res[3]);
+}
+
+void AbstractMemory::store32(uint32_t address, uint32_t data) {
+  uint8_t d[4] = {
+    (uint8_t)((data & 0xFF000000) >> 24),
+    (uint8_t)((data & 0x00FF0000) >> 16),
+    (uint8_t)((data & 0x0000FF00) >> 8),
+    (uint8_t)( data & 0x000000FF)
+  };
+  uint8_t* dest = translateWrite(address, 4);
+  if (dest != NULL) {
+    for (uint32_t i = 0; i < 4; i++)
+      dest[i] = d[i];
+  } else {
+    write(address, d, 4);
+  }
+}
+
+void AbstractMemory::store16(uint32_t address, uint16_t data) {
+  uint8_t d[2] = {
+    (uint8_t)((data & 0xFF00) >> 8),
+    (uint8_t)( data & 0x00FF)
+  };
+  uint8_t* dest = translateWrite(address, 2);
+  if (dest != NULL) {
+    dest[0] = d[0];
+    dest[1] = d[1];
+  } else {
+    write(address, d, 2);
+  }
 }
 
 // Read functions
 // Read a byte
 uint8_t AbstractMemory::readByte(uint32_t address) const {
+  const uint8_t* data = translateRead(_dtlb, address, 1);
+  if (data != NULL)
+    return data[0];
+
   uint8_t res[1];
   read(address, 1, res);
   return res[0];
@@ -43,10 +241,9 @@ void AbstractMemory::readByte(uint32_t address, Register* rd) const {
 
 // Read a halfword
 uint16_t AbstractMemory::readHalfword(uint32_t address) const {
-  uint8_t res[2];
-  read(address, 2, res);
-  return ((uint16_t)res[1] << 8)
-    +  ((uint16_t)res[0]);
+  if (!aligned(address, 2))
+    return 0;
+  return load16(address);
 }
 
 // Read a halfword into a register
@@ -57,10 +254,9 @@ void AbstractMemory::readHalfword(uint32_t address, Register* rd) const {
 
 // Read a word
 uint32_t AbstractMemory::readWord(uint32_t address) const {
-  uint8_t res[4];
-  read(address, 4, res);
-  return ((uint32_t)res[0] << 24) + ((uint32_t)res[1] << 16)
-    + ((uint32_t)res[2] << 8 ) + ((uint32_t)res[3]);
+  if (!aligned(address, 4))
+    return 0;
+  return load32(address);
 }
 
 // Read a word into a register
@@ -71,28 +267,35 @@ void AbstractMemory::readWord(uint32_t address, Register* rd) const {
 
 // Read a double word
 uint64_t AbstractMemory::readDoubleword(uint32_t address) const {
-  uint32_t res1 = readWord(address);   // most significant
-  uint32_t res2 = readWord(address+4); // less significant
-  return ((uint64_t)res1 << 32) + ((uint64_t)res2);
+  if (!aligned(address, 8))
+    return 0;
+  return load64(address);
 }
 
 // Read a double word into two registers
 void AbstractMemory::readDoubleword(uint32_t address, Register* rdeven, Register* rdodd) const {
-  rdeven->write(readWord(address));
-  rdodd->write(readWord(address+4));
+  uint64_t data = readDoubleword(address);
+  rdeven->write((uint32_t)(data >> 32));
+  rdodd->write((uint32_t)data);
 }
 
 // Read an instruction
 Instruction AbstractMemory::readInstruction(uint32_t address) const {
-  uint32_t inst = readWord(address);
-  return Instruction(inst);
+  markFetched(address);
+  return Instruction(fetch32(address));
 }
 
 // Write functions
 // Write a byte
 void AbstractMemory::writeByte(uint32_t address, uint8_t data) {
-  uint8_t d[1] = { data };
-  write(address, d, 1);
+  uint8_t* dest = translateWrite(address, 1);
+  if (dest != NULL) {
+    dest[0] = data;
+  } else {
+    uint8_t d[1] = { data };
+    write(address, d, 1);
+  }
+  written(address, 1);
 }
 
 // Write a byte from a register
@@ -104,11 +307,10 @@ void AbstractMemory::writeByte(uint32_t address, const Register* rd) {
 
 // Write a half word
 void AbstractMemory::writeHalfword(uint32_t address, uint16_t data) {
-  uint8_t d[2] = {
-    (uint8_t)((data & 0xFF00) >> 8),
-    (uint8_t)( data & 0x00FF)
-  };
-  write(address, d, 2);
+  if (!aligned(address, 2))
+    return;
+  store16(address, data);
+  written(address, 2);
 }
 
 // Write a half word from register
@@ -120,13 +322,10 @@ void AbstractMemory::writeHalfword(uint32_t address, const Register* rd) {
 
 // Write a word
 void AbstractMemory::writeWord(uint32_t address, uint32_t data) {
-  uint8_t d[4] = {
-    (uint8_t)((data & 0xFF000000) >> 24),
-    (uint8_t)((data & 0x00FF0000) >> 16),
-    (uint8_t)((data & 0x0000FF00) >> 8),
-    (uint8_t)( data & 0x000000FF)
-  };
-  write(address, d, 4);
+  if (!aligned(address, 4))
+    return;
+  store32(address, data);
+  written(address, 4);
 }
 
 // Write a word from register
@@ -136,15 +335,67 @@ void AbstractMemory::writeWord(uint32_t address, const Register* rd) {
 
 // Write a double word
 void AbstractMemory::writeDoubleword(uint32_t address, uint64_t data) {
-  writeWord(address,   (uint32_t)((data & 0xFFFFFFFF00000000) >> 32));
-  writeWord(address+1, (uint32_t)((data & 0x00000000FFFFFFFF)));
+  if (!aligned(address, 8))
+    return;
+  store32(address,   (uint32_t)((data & 0xFFFFFFFF00000000) >> 32));
+  store32(address+4, (uint32_t)((data & 0x00000000FFFFFFFF)));
+  written(address, 8);
 }
 
 // Write a double word from two registers
 void AbstractMemory::writeDoubleword(uint32_t address, const Register* rdeven, const Register* rdodd) {
-  writeWord(address,  rdeven->read());
-  writeWord(address+1, rdodd->read());
+  writeDoubleword(address, ((uint64_t)rdeven->read() << 32) | (uint64_t)rdodd->read());
 }
 
 
 
+
+// Block transfers
+// By default, through read() and write()
+void AbstractMemory::copyIn(uint32_t address, const uint8_t* data, uint32_t size) {
+  if (size == 0)
+    return;
+  write(address, const_cast<uint8_t*>(data), size); // write() does not modify the data
+  writtenBlock(address, size);
+}
+
+void AbstractMemory::copyOut(uint32_t address, uint8_t* data, uint32_t size) const {
+  if (size > 0)
+    read(address, size, data);
+}
+
+void AbstractMemory::fill(uint32_t address, uint8_t value, uint32_t size) {
+  uint8_t chunk[MEM_BLOCK_CHUNK];
+  std::memset(chunk, value, (size < MEM_BLOCK_CHUNK ? size : MEM_BLOCK_CHUNK));
+  for (uint32_t i = 0; i < size; i += MEM_BLOCK_CHUNK)
+    write(address + i, chunk, (size - i < MEM_BLOCK_CHUNK ? size - i : MEM_BLOCK_CHUNK));
+  if (size > 0)
+    writtenBlock(address, size);
+}
+
+int AbstractMemory::compare(uint32_t address, const uint8_t* data, uint32_t size) const {
+  uint8_t chunk[MEM_BLOCK_CHUNK];
+  for (uint32_t i = 0; i < size; i += MEM_BLOCK_CHUNK) {
+    uint32_t n = (size - i < MEM_BLOCK_CHUNK ? size - i : MEM_BLOCK_CHUNK);
+    read(address + i, n, chunk);
+    int diff = std::memcmp(chunk, data + i, n);
+    if (diff != 0)
+      return diff;
+  }
+  return 0;
+}
+
+// A block may cover pages fetched from between its ends
+void AbstractMemory::writtenBlock(uint32_t address, uint32_t size) {
+  if (_listener == NULL || _fetched.empty())
+    return;
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t a = address + i;
+    uint32_t n = TLB_PAGE_SIZE - (a & TLB_PAGE_MASK);
+    if (n > size - i)
+      n = size - i;
+    if (isFetchedPage(a))
+      _listener->fetchedPageWritten(a, n);
+    i += n;
+  }
+}
@@ -8,10 +8,21 @@
 #define MEMORY_H
 
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "utils.h"
 #include "instruction.h"
 #include "register.h"
+#include "softtlb.h"
+
+// Block transfers : size of the buffer of the default fill() and compare()
+#define MEM_BLOCK_CHUNK       256
+
+// Kinds of faults (see AbstractMemory::getFaultType())
+#define MEM_FAULT_NONE        0
+#define MEM_FAULT_ACCESS      1  // nothing there, or not allowed : data (or instruction) access exception
+#define MEM_FAULT_ALIGNMENT   2  // not aligned on the size of the access (strict mode) : mem_address_not_aligned
 
 /**
  * Represents an abstract virtual memory device for using with the kSPARC engine.
@@ -29,6 +40,54 @@
  * realistic behaviours cannot be achieved whithout it.
  *
  * This is why a "BadAlignmentException" exception class for handling that kind of problem.
+ * The engines cannot resume an instruction after an exception though : in strict mode (see setStrict()), the
+ * halfword, word and double word functions check the alignment with a mask, and report a misaligned access as a
+ * fault (see below) of type MEM_FAULT_ALIGNMENT, that the engine turns into a mem_address_not_aligned trap. The
+ * devices with bounds (SimpleMemory) report the accesses beyond them as data access faults in strict mode; in
+ * permissive mode (the default), misaligned accesses are made anyway, and the accesses beyond the bounds read
+ * zeros and write nothing.
+ *
+ * Translation
+ * ===========
+ *
+ * The byte, halfword, word and double word functions look for the page of the access in a software TLB (one for
+ * the instructions, see readInstruction(), and one for the data), and access the host memory directly when it is
+ * there. On a miss, they ask the device where the page is (readablePage(), writablePage()), and enter it in the TLB; when the device
+ * cannot tell (a device-mapped page, for instance) or the access crosses a page, they call read() or write().
+ *
+ * A device whose pages move in the host memory must call remap() for them.
+ *
+ * Faults
+ * ======
+ *
+ * A device may have holes in the address space. An access to a hole does not throw (the engines
+ * could not resume the instruction) : the device calls fault(), the access reads zeros or writes
+ * nothing, and the engine, which polls hasFault() after each access, turns it into a data access
+ * exception trap before writing the destination register. A fault while fetching an instruction becomes an
+ * instruction access exception.
+ *
+ * Mapping
+ * =======
+ *
+ * The engines cache what they decode by address. A device whose addresses may designate other memory from a
+ * moment to the next (an MMU switching contexts, see SrmmuMemory) calls newMapping(), and the engines drop what
+ * they have decoded when getMappingVersion() changes.
+ *
+ * Instruction fetch
+ * =================
+ *
+ * The instructions have a path of their own : readInstruction() and fetchRun(), which gives the run of words up to
+ * the end of the page, so that an engine decodes ahead without a call per word. The pages fetched from are
+ * remembered; a store in one of them, through the write functions of this class or reported by the engine with
+ * written(), is told to the FetchListener (the engine, which drops what it has decoded there). The stores to the
+ * other pages cost a bit test.
+ *
+ * Block transfers
+ * ===============
+ *
+ * The host side (loaders, displays, devices) moves blocks with copyIn(), copyOut(), fill() and compare() rather
+ * than a call per byte. They work as read() and write() (holes and bounds fault the same way), and the devices
+ * with their storage in the host memory override them with memcpy(), memset() and memcmp().
  */
 class AbstractMemory {
 	public:
@@ -41,6 +100,20 @@ class AbstractMemory {
         ~BadAlignmentException();
     };
 
+    /**
+     * Told of the stores in the pages that instructions have been fetched from
+     */
+    class FetchListener {
+      public:
+        virtual ~FetchListener();
+        /**
+         * Some instructions may have been modified
+         * @param address beginning of the store
+         * @param size size of the store
+         */
+        virtual void fetchedPageWritten(uint32_t address, uint32_t size) = 0;
+    };
+
     /**
      * Constructor
      *
@@ -60,6 +133,179 @@ class AbstractMemory {
      */
     uint32_t getSize() const;
 
+    /**
+     * Load the content of a file (a program made by kasm, for instance) into the memory.
+     * What does not fit in the memory is left out. By default, the file is read at once and written with write();
+     * a device may map the file instead.
+     * @param filename name of the file
+     * @param baseaddr where to put the content
+     * @returns number of bytes loaded
+     * @throws std::runtime_error if the file cannot be read
+     */
+    virtual uint32_t loadFile(const std::string& filename, uint32_t baseaddr = 0);
+
+    // Translation
+    /**
+     * Tell where a page of the memory is in the host memory, to read it through the TLB.
+     * By default, no page can be accessed directly.
+     * @param address an address in the page (pages of TLB_PAGE_SIZE bytes)
+     * @returns host address of the beginning of the page, or NULL if it must be read through read()
+     */
+    virtual const uint8_t* readablePage(uint32_t address) const;
+    /**
+     * Tell where a page of the memory is in the host memory, to write it through the TLB.
+     * By default, no page can be accessed directly.
+     * @param address an address in the page (pages of TLB_PAGE_SIZE bytes)
+     * @returns host address of the beginning of the page, or NULL if it must be written through write()
+     */
+    virtual uint8_t* writablePage(uint32_t address);
+    /**
+     * Enable or disable the TLB (enabled by default)
+     * @param enabled true to use the TLB
+     */
+    void setTLB(bool enabled);
+    /**
+     * Tells if the TLB is used
+     * @returns true if the TLB is enabled
+     */
+    bool isTLBEnabled() const;
+    /**
+     * Get the instruction side of the TLB (mainly for statistics)
+     * @returns the TLB
+     */
+    const SoftTLB& instructionTLB() const;
+    /**
+     * Get the data side of the TLB (mainly for statistics)
+     * @returns the TLB
+     */
+    const SoftTLB& dataTLB() const;
+
+    // Instruction fetch
+    /**
+     * Tell where a page of instructions is in the host memory, to fetch from it directly.
+     * By default, it goes through the instruction side of the TLB.
+     * @param address an address in the page
+     * @returns host address of the beginning of the page, or NULL if the instructions must be read one by one
+     */
+    virtual const uint8_t* instructionPage(uint32_t address) const;
+    /**
+     * Get the instruction words from an address up to the end of its page. The instruction at the address must
+     * have been read with readInstruction() without a fault : the run is not checked.
+     * @param address address of the first instruction (word aligned)
+     * @param count number of words of the run (0 if there is none)
+     * @returns host address of the first word (big endian words), or NULL if there is no run
+     */
+    const uint8_t* fetchRun(uint32_t address, uint32_t& count) const;
+    /**
+     * Set who is told of the stores in the pages fetched from
+     * @param listener the listener (NULL for none)
+     */
+    void setFetchListener(FetchListener* listener);
+    /**
+     * Tells if instructions have been fetched from a page
+     * @param address an address in the page
+     * @returns true if the page has been fetched from
+     */
+    bool isFetchedPage(uint32_t address) const;
+    /**
+     * Tell the listener about a store, if it is in a page fetched from. The write functions call it; the engines
+     * that store through the fast paths (store32(), write()) must call it themselves.
+     * @param address beginning of the store
+     * @param size size of the store
+     */
+    void written(uint32_t address, uint32_t size);
+
+    // Fast paths
+    /**
+     * Load a word (32 bits, big endian). Every word access goes through this function; a device can override it
+     * with a direct access to its storage. By default, it goes through the TLB, or read().
+     * @param address address of the data
+     * @returns the data
+     */
+    virtual uint32_t load32(uint32_t address) const;
+    /**
+     * Load a halfword (16 bits, in the order of readHalfword()).
+     * @param address address of the data
+     * @returns the data
+     * @see load32()
+     */
+    virtual uint16_t load16(uint32_t address) const;
+    /**
+     * Load a double word (64 bits, big endian).
+     * @param address address of the data
+     * @returns the data
+     * @see load32()
+     */
+    virtual uint64_t load64(uint32_t address) const;
+    /**
+     * Load an instruction word (32 bits, big endian). By default, it goes through the instruction side of the TLB,
+     * or read().
+     * @param address address of the instruction
+     * @returns the instruction word
+     * @see load32()
+     */
+    virtual uint32_t fetch32(uint32_t address) const;
+    /**
+     * Store a word (32 bits, big endian).
+     * @param address address of the data
+     * @param data the data
+     * @see load32()
+     */
+    virtual void store32(uint32_t address, uint32_t data);
+    /**
+     * Store a halfword (16 bits, big endian).
+     * @param address address of the data
+     * @param data the data
+     * @see load32()
+     */
+    virtual void store16(uint32_t address, uint16_t data);
+
+    // Faults
+    /**
+     * Check the alignment and the bounds of the accesses, and report them as faults, or not (permissive)
+     * @param strict true for the strict mode
+     */
+    void setStrict(bool strict);
+    /**
+     * Tells if the accesses are checked
+     * @returns true in strict mode
+     */
+    bool isStrict() const;
+    /**
+     * Check the alignment of an access (in strict mode only). A misaligned access must not be made : a fault is
+     * recorded instead.
+     * @param address address of the access
+     * @param size size of the access (a power of two)
+     * @returns false if the access is misaligned
+     */
+    bool aligned(uint32_t address, uint32_t size) const;
+    /**
+     * Tells if an access has faulted since the last call to clearFault()
+     * @returns true after a fault
+     */
+    bool hasFault() const;
+    /**
+     * Get the kind of the last fault
+     * @returns MEM_FAULT_*
+     */
+    uint32_t getFaultType() const;
+    /**
+     * Get the address of the last fault
+     * @returns the guest address
+     */
+    uint32_t getFaultAddress() const;
+    /**
+     * Forget the fault, once the engine has handled it
+     */
+    virtual void clearFault();
+
+    // Mapping
+    /**
+     * Version of the mapping of the addresses : it changes each time an address may designate something else
+     * @returns the version
+     */
+    uint32_t getMappingVersion() const;
+
     // Read functions
     /**
      * Core function of the virtual device : read data from the memory
@@ -135,7 +381,7 @@ class AbstractMemory {
     void readDoubleword(uint32_t address, Register* rdeven, Register* rdodd) const;
 
     /**
-     * Utility function that reads an instruction from the memory
+     * Utility function that reads an instruction from the memory (the page is remembered as fetched from)
      * @param address address of the instruction
      * @returns the instruction
      */
@@ -211,11 +457,172 @@ class AbstractMemory {
      */
     void writeDoubleword(uint32_t address, const Register* rdeven, const Register* rdodd);
 
+    // Block transfers
+    /**
+     * Copy a block from the host into the memory, and tell the fetch listener about it. By default, it goes
+     * through write(); a device can override it with a direct copy into its storage.
+     * @param address where to put the block
+     * @param data the block
+     * @param size size of the block
+     */
+    virtual void copyIn(uint32_t address, const uint8_t* data, uint32_t size);
+    /**
+     * Copy a block of the memory to the host. By default, it goes through read().
+     * @param address address of the block
+     * @param data where to put the block
+     * @param size size of the block
+     */
+    virtual void copyOut(uint32_t address, uint8_t* data, uint32_t size) const;
+    /**
+     * Fill a block of the memory with a byte, and tell the fetch listener about it. By default, it goes through
+     * write(), a few hundred bytes at a time.
+     * @param address address of the block
+     * @param value the byte
+     * @param size size of the block
+     */
+    virtual void fill(uint32_t address, uint8_t value, uint32_t size);
+    /**
+     * Compare a block of the memory with a block of the host, as memcmp() does. By default, it goes through read(),
+     * a few hundred bytes at a time.
+     * @param address address of the block
+     * @param data the block of the host
+     * @param size size of the blocks
+     * @returns 0 if they are equal, less than 0 if the memory is lower, more than 0 if it is greater
+     */
+    virtual int compare(uint32_t address, const uint8_t* data, uint32_t size) const;
+
+  protected:
+    /**
+     * Tell the TLB that a page is not where it was in the host memory anymore
+     * @param address an address in the page
+     */
+    void remap(uint32_t address);
+    /**
+     * Tell the TLB that every page may have moved
+     */
+    void remapAll();
+    /**
+     * Record a fault (it may be called from a signal handler)
+     * @param address guest address of the access
+     * @param type MEM_FAULT_*
+     */
+    void fault(uint32_t address, uint32_t type = MEM_FAULT_ACCESS) const;
+    /**
+     * Tell the engines that the addresses may designate something else than before
+     */
+    void newMapping();
+    /**
+     * Tell the listener about a block written, page by page (written() only looks at both ends)
+     * @param address beginning of the block
+     * @param size size of the block
+     */
+    void writtenBlock(uint32_t address, uint32_t size);
+
 	private:
+    /**
+     * Find where to read data in the host memory, through a TLB
+     * @param tlb the TLB (instruction or data side)
+     * @param address address of the data
+     * @param size size of the data
+     * @returns host address of the data, or NULL if it must be read through read()
+     */
+    const uint8_t* translateRead(SoftTLB& tlb, uint32_t address, uint32_t size) const;
+    /**
+     * Find where to write data in the host memory, through the data TLB
+     * @param address address of the data
+     * @param size size of the data
+     * @returns host address of the data, or NULL if it must be written through write()
+     */
+    uint8_t* translateWrite(uint32_t address, uint32_t size);
+    /**
+     * Remember that instructions are fetched from a page
+     * @param address an address in the page
+     */
+    void markFetched(uint32_t address) const;
+
     //!< Size of the memory
     uint32_t _size;
 
+    //!< TLB : instruction and data sides
+    bool _usetlb;
+    mutable SoftTLB _itlb;
+    mutable SoftTLB _dtlb;
+
+    //!< Strict mode
+    bool _strict;
+
+    //!< Last fault (written by signal handlers, and by the const accesses)
+    mutable volatile uint32_t _fault;
+    mutable volatile uint32_t _faultaddr;
+
+    //!< Version of the mapping
+    uint32_t _mapping;
+
+    //!< Pages fetched from (a bit per page, allocated on the first fetch), and who is told of their stores
+    mutable std::vector<uint64_t> _fetched;
+    FetchListener* _listener;
 };
 
+inline uint32_t AbstractMemory::getSize() const {
+  return _size;
+}
+
+// Faults are polled after each access
+inline bool AbstractMemory::hasFault() const {
+  return _fault != MEM_FAULT_NONE;
+}
+
+inline uint32_t AbstractMemory::getFaultType() const {
+  return _fault;
+}
+
+inline uint32_t AbstractMemory::getFaultAddress() const {
+  return _faultaddr;
+}
+
+inline void AbstractMemory::fault(uint32_t address, uint32_t type) const {
+  _faultaddr = address;
+  _fault = type;
+}
+
+// A mask and a test in permissive mode
+inline bool AbstractMemory::isStrict() const {
+  return _strict;
+}
+
+inline bool AbstractMemory::aligned(uint32_t address, uint32_t size) const {
+  if (!_strict || (address & (size - 1)) == 0)
+    return true;
+  fault(address, MEM_FAULT_ALIGNMENT);
+  return false;
+}
+
+// The engines compare the version around the accesses that may change the mapping
+inline uint32_t AbstractMemory::getMappingVersion() const {
+  return _mapping;
+}
+
+inline void AbstractMemory::newMapping() {
+  _mapping++;
+}
+
+// The stores test a bit
+inline bool AbstractMemory::isFetchedPage(uint32_t address) const {
+  uint32_t page = address >> TLB_PAGE_BITS;
+  return !_fetched.empty() && ((_fetched[page >> 6] >> (page & 63)) & 1) != 0;
+}
+
+inline void AbstractMemory::written(uint32_t address, uint32_t size) {
+  if (_listener != NULL && (isFetchedPage(address) || isFetchedPage(address + size - 1)))
+    _listener->fetchedPageWritten(address, size);
+}
+
+inline void AbstractMemory::markFetched(uint32_t address) const {
+  uint32_t page = address >> TLB_PAGE_BITS;
+  if (_fetched.empty())
+    _fetched.resize(1 << (32 - TLB_PAGE_BITS - 6));
+  _fetched[page >> 6] |= (uint64_t)1 << (page & 63);
+}
+
 #endif // MEMORY_H
 
@@ -10,7 +10,7 @@
 AbstractSparcEngine::AbstractSparcEngine(
     AbstractMemory* mem,
     AbstractALU* alu,
-    /*AbstractFPU* fpu,*/
+    AbstractFPU* fpu,
     WindowRegisters* registers,
     SpecialRegister* psr,
     SpecialRegister* wim,
@@ -22,7 +22,7 @@ AbstractSparcEngine::AbstractSparcEngine(
     ) {
   _mem = mem;
   _alu = alu;
-  // _fpu = fpu;
+  _fpu = fpu;
   _reg = registers;
   _psr = psr;
   _wim = wim;
@@ -46,9 +46,9 @@ AbstractALU* AbstractSparcEngine::alu() {
   return _alu;
 }
 
-/*AbstractFPU* AbstractSparcEngine::fpu() {
- * return _fpu;
-}*/
+AbstractFPU* AbstractSparcEngine::fpu() {
+  return _fpu;
+}
 
 WindowRegisters* AbstractSparcEngine::registers() {
   return _reg;
@@ -82,6 +82,15 @@ SpecialRegister* AbstractSparcEngine::fsr() {
   return _fsr;
 }
 
-
-
-
+// Stop reasons
+const char* stopReason(uint32_t reason) {
+  switch (reason) {
+    case SE_STOP_NONE:       return "running";
+    case SE_STOP_BUDGET:     return "budget exhausted";
+    case SE_STOP_BREAKPOINT: return "breakpoint";
+    case SE_STOP_TRAP:       return "trap";
+    case SE_STOP_HALT:       return "halt";
+    case SE_STOP_ILLEGAL:    return "illegal instruction";
+    default:                 return "unknown";
+  }
+}
@@ -9,26 +9,41 @@
 
 #include "abstractmemory.h"
 #include "abstractalu.h"
-//#include "abstractfpu.h"
+#include "abstractfpu.h"
 
 #include "register.h"
 #include "windowregisters.h"
 #include "specialregister.h"
 
+// Why a run of the engine stopped (see AbstractSparcEngine::run())
+#define SE_STOP_NONE        0x00  // not stopped
+#define SE_STOP_BUDGET      0x01  // the maximum number of instructions has been executed
+#define SE_STOP_BREAKPOINT  0x02  // the next instruction is at the requested address
+#define SE_STOP_TRAP        0x03  // a trap occurred while the traps are disabled
+#define SE_STOP_HALT        0x04  // the next instruction is the null word
+#define SE_STOP_ILLEGAL     0x05  // an illegal instruction was met while the traps are disabled
+
+// No limit on the number of instructions of a run
+#define SE_UNLIMITED        0xFFFFFFFFFFFFFFFFull
+// No breakpoint (instructions are aligned, so this address is never reached)
+#define SE_NO_BREAKPOINT    0xFFFFFFFF
+
 /**
  * Represents an abstract SPARC engine.
  *
  * This is the core class for emulating SPARC; it defines all the important function
  * to emulate a SPARC processor.
  *
- * This engine is made of 4 main components :
+ * This engine is made of 5 main components :
  * - the memory, for storing and loading data
  * - the arithmetic and logic unit, for making calculus
+ * - the floating-point unit, with its own registers
  * - the window registers, which are the main registers of the unit
  * - a whole set of "special" registers that stores various informations about the state of the device
  *
  * @see AbstractMemory
  * @see AbstractALU
+ * @see AbstractFPU
  * @see WindowRegister
  * @see SpecialRegister
  */
@@ -39,6 +54,7 @@ class AbstractSparcEngine {
      *
      * @param mem the memory device
      * @param alu the arithmetic and logic unit
+     * @param fpu the floating-point unit
      * @param registers main registers of the engine
      * @param psr processor state register
      * @param wim window invalid mask register
@@ -51,7 +67,7 @@ class AbstractSparcEngine {
 		AbstractSparcEngine(
         AbstractMemory* mem,
         AbstractALU* alu,
-        /*AbstractFPU* fpu,*/
+        AbstractFPU* fpu,
         WindowRegisters* registers,
         SpecialRegister* psr,
         SpecialRegister* wim,
@@ -78,9 +94,36 @@ class AbstractSparcEngine {
      * - decoding the instruction
      * - executing the instruction
      * - update registers and memory
+     * @returns false if the engine has stopped (see SE_STOP_*) instead of executing an instruction
      */
     virtual bool next() = 0;
 
+    /**
+     * Execute instructions until the maximum number of instructions is reached or the engine
+     * stops by itself (null word, trap or illegal instruction while the traps are disabled).
+     * The whole loop stays in the engine, which is much faster than calling next() each time.
+     * @param maxInstructions maximum number of instructions to execute
+     * @returns why the engine stopped (SE_STOP_*)
+     */
+    virtual uint32_t run(uint64_t maxInstructions) = 0;
+    /**
+     * Same as run(), but also stops before executing the instruction at a given address
+     * @param address address of the breakpoint
+     * @param maxInstructions maximum number of instructions to execute
+     * @returns why the engine stopped (SE_STOP_*)
+     */
+    virtual uint32_t runUntil(uint32_t address, uint64_t maxInstructions = SE_UNLIMITED) = 0;
+    /**
+     * Execute instructions until the engine stops by itself
+     * @returns why the engine stopped (SE_STOP_*, never SE_STOP_BUDGET)
+     */
+    virtual uint32_t runUntilHalt() = 0;
+    /**
+     * Get the number of instructions executed since the last initialization
+     * @returns number of instructions
+     */
+    virtual uint64_t getInstructionCount() const = 0;
+
 	protected:
     /**
      * Get the memory device of the engine
@@ -92,7 +135,11 @@ class AbstractSparcEngine {
      * @returns the alu device
      */
     AbstractALU* alu();
-    //AbstractFPU* fpu();
+    /**
+     * Get the fpu device of the engine
+     * @returns the fpu device
+     */
+    AbstractFPU* fpu();
     /**
      * Get the window register of the engine
      * @returns the window register
@@ -145,7 +192,11 @@ class AbstractSparcEngine {
      * The ALU device of the engine
      */
     AbstractALU* _alu;
-    //AbstractFPU* _fpu;
+
+    /**
+     * The floating-point unit of the engine
+     */
+    AbstractFPU* _fpu;
     
     /**
      * The window register of the engine
@@ -159,5 +210,12 @@ class AbstractSparcEngine {
 
 };
 
+/**
+ * Get a readable description of why a run of the engine stopped
+ * @param reason the reason (SE_STOP_*)
+ * @returns the description
+ */
+const char* stopReason(uint32_t reason);
+
 #endif // ABSTRACTSPARCENGINE_H
 
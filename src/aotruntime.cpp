@@ -0,0 +1,149 @@
+/*
+ * aotruntime.cpp -- implement the AotRuntime class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "aotruntime.h"
+#include "sparcengine.h"
+
+#include <iomanip>
+
+/**
+ * The reference engine, opened up for the runtime : it executes the instructions which have not
+ * been translated.
+ */
+class AotEngine : public SparcEngine {
+	public:
+		AotEngine(AbstractMemory* mem, AbstractALU* alu, AbstractFPU* fpu, WindowRegisters* registers,
+              SpecialRegister* psr, SpecialRegister* wim, SpecialRegister* tbr, SpecialRegister* y,
+              SpecialRegister* pc, SpecialRegister* npc, SpecialRegister* fsr) :
+      SparcEngine(mem, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr) {
+    }
+
+    // Execute the instruction at a given address
+    void executeAt(uint32_t address) {
+      pc()->write(address);
+      execute(fetch(address));
+    }
+
+    // Run until no branch is pending; returns the next pc, or the pc of the instruction where the engine stopped
+    uint32_t interpret(uint32_t address, bool branch, uint32_t dcti, bool& halted) {
+      npc()->write(address);
+      _branch = branch;
+      _isdcti = false;
+      _dcti = dcti;
+      do {
+        if (!next()) {
+          halted = true;
+          return pc()->read();
+        }
+      } while (_branch);
+      return npc()->read();
+    }
+};
+
+// Cstr
+AotRuntime::AotRuntime(uint32_t memsize, uint32_t windows) : _halted(false) {
+  Logger::init("output.log");
+
+  _memory = new SimpleMemory(memsize);
+  _registers = new WindowRegisters(windows, &_psr, &_wim);
+  _alu = new SimpleALU(&_psr, &_y);
+  _alu->setLazyFlags(true);
+  _fpu = new HostFPU(&_fsr);
+  _engine = new AotEngine(_memory, _alu, _fpu, _registers, &_psr, &_wim, &_tbr, &_y, &_pc, &_npc, &_fsr);
+
+  // Start from a known state
+  _psr.write(0);
+  for (uint32_t w = 0; w < windows; w++) {
+    _psr.setField(PSR_CWP, w);
+    _registers->update();
+    for (uint32_t nb = 1; nb < 32; nb++)
+      _registers->write(nb, 0);
+  }
+  _y.write(0);
+  _fsr.write(0);
+  _engine->init();
+}
+
+// Dstr
+AotRuntime::~AotRuntime() {
+  delete _engine;
+  delete _alu;
+  delete _fpu;
+  delete _registers;
+  delete _memory;
+}
+
+// Load an image
+void AotRuntime::load(const uint8_t* image, uint32_t size, uint32_t baseaddr) {
+  for (uint32_t k = 0; k < size; k++)
+    _memory->writeByte(baseaddr + k, image[k]);
+}
+
+// Main loop
+uint64_t AotRuntime::run(Dispatcher dispatch, uint32_t entry) {
+  uint64_t count = 0;
+  uint32_t pc = entry;
+  _halted = false;
+  while (!_halted) {
+    pc = dispatch(*this, pc);
+    count++;
+  }
+
+  // As the engines leave it on the null word
+  _pc.write(pc);
+  _npc.write(pc);
+  return count;
+}
+
+// Dump
+void AotRuntime::dump(std::ostream& os) {
+  _alu->syncFlags();
+  os << std::hex << std::setfill('0');
+  os << "pc=" << std::setw(8) << _pc.read() << " npc=" << std::setw(8) << _npc.read()
+     << " psr=" << std::setw(8) << _psr.read() << " y=" << std::setw(8) << _y.read()
+     << " wim=" << std::setw(8) << _wim.read() << std::endl;
+  for (uint32_t nb = 0; nb < 32; nb++)
+    os << "r" << std::dec << nb << "=" << std::hex << std::setw(8) << _registers->read(nb)
+       << (nb % 8 == 7 ? "\n" : " ");
+  os << std::dec;
+}
+
+// Accessors
+AbstractMemory* AotRuntime::memory() {
+  return _memory;
+}
+
+WindowRegisters* AotRuntime::registers() {
+  return _registers;
+}
+
+// Branch condition
+bool AotRuntime::condition(uint8_t cond) {
+  _alu->syncFlags();
+  return SparcEngine::holds(cond, _psr.getField(PSR_ICC));
+}
+
+// ALU
+uint32_t AotRuntime::alu(uint8_t op3, uint32_t a, uint32_t b, uint32_t rd) {
+  Register rs1(&a), dest(&rd);
+  _alu->calc(op3, &rs1, b, &dest);
+  return rd;
+}
+
+// Reference engine
+void AotRuntime::execute(uint32_t address) {
+  _engine->executeAt(address);
+}
+
+uint32_t AotRuntime::interpret(uint32_t address, bool branch, uint32_t dcti) {
+  return _engine->interpret(address, branch, dcti, _halted);
+}
+
+uint32_t AotRuntime::halt(uint32_t address) {
+  _halted = true;
+  return address;
+}
+
@@ -0,0 +1,127 @@
+/*
+ * aotruntime.h -- defines the AotRuntime class, which runs programs translated by ksparc-aot
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef AOTRUNTIME_H
+#define AOTRUNTIME_H
+
+#include <stdint.h>
+#include <ostream>
+#include "simplememory.h"
+#include "simplealu.h"
+#include "hostfpu.h"
+#include "windowregisters.h"
+#include "specialregister.h"
+#include "utils.h"
+
+// Default machine : same as ksparc
+#define AOT_MEMORY_SIZE   32768
+#define AOT_WINDOWS       4
+
+class AotEngine;
+
+/**
+ * The AotRuntime is the machine on which the C++ code generated by ksparc-aot (see AotTranslator)
+ * runs : memory, register file, ALU, FPU, and a reference engine for what has not been translated.
+ *
+ * The generated code is made of one function per basic block, which executes the block and
+ * returns the address of the next one, and of a dispatch function which calls the function of the
+ * block at a given address (or the interpreter, for addresses that are not the start of a known
+ * block, such as some indirect jump targets).
+ */
+class AotRuntime {
+	public:
+    /**
+     * Generated dispatch function
+     * @param rt the runtime
+     * @param pc address of the block to execute
+     * @returns address of the next block
+     */
+    typedef uint32_t (*Dispatcher)(AotRuntime& rt, uint32_t pc);
+
+    /**
+     * Constructor
+     * @param memsize size of the memory
+     * @param windows number of register windows
+     */
+		AotRuntime(uint32_t memsize = AOT_MEMORY_SIZE, uint32_t windows = AOT_WINDOWS);
+    /**
+     * Destructor
+     */
+		~AotRuntime();
+
+    /**
+     * Load a program image into memory
+     * @param image the image
+     * @param size size of the image
+     * @param baseaddr where to put it
+     */
+    void load(const uint8_t* image, uint32_t size, uint32_t baseaddr = 0);
+    /**
+     * Run the program until it reaches the null word, or an instruction that stops the engine (see SE_STOP_*)
+     * @param dispatch generated dispatch function
+     * @param entry address of the first instruction
+     * @returns number of blocks executed
+     */
+    uint64_t run(Dispatcher dispatch, uint32_t entry = 0);
+    /**
+     * Print the pc, special registers and registers of the current window
+     * @param os stream
+     */
+    void dump(std::ostream& os);
+
+    /**
+     * Accessors, for the generated code
+     */
+    AbstractMemory* memory();
+    WindowRegisters* registers();
+
+    /**
+     * Evaluate a branch condition on the current condition codes
+     * @param cond condition (INST_COND_*, with the "not" bit)
+     * @returns true if the branch is taken
+     */
+    bool condition(uint8_t cond);
+    /**
+     * Make an operation with the ALU
+     * @param op3 operation
+     * @param a first operand
+     * @param b second operand
+     * @param rd current value of the destination (kept if the operation does not write it)
+     * @returns new value of the destination
+     */
+    uint32_t alu(uint8_t op3, uint32_t a, uint32_t b, uint32_t rd);
+    /**
+     * Execute with the reference engine an instruction which is not a control transfer
+     * @param address address of the instruction
+     */
+    void execute(uint32_t address);
+    /**
+     * Execute with the reference engine, from a given address, until no delayed branch is pending
+     * @param address address of the first instruction
+     * @param branch true if a branch to dcti is pending (the instruction at address is its delay slot)
+     * @param dcti target of the pending branch
+     * @returns address of the next instruction
+     */
+    uint32_t interpret(uint32_t address, bool branch = false, uint32_t dcti = 0);
+    /**
+     * Stop on the null word
+     * @param address address of the null word
+     * @returns address
+     */
+    uint32_t halt(uint32_t address);
+
+	private:
+    SimpleMemory* _memory;
+    WindowRegisters* _registers;
+    SpecialRegister _psr, _wim, _tbr, _y, _pc, _npc, _fsr;
+    SimpleALU* _alu;
+    HostFPU* _fpu;
+    AotEngine* _engine;
+    bool _halted;
+};
+
+#endif // AOTRUNTIME_H
+
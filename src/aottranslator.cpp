@@ -0,0 +1,334 @@
+/*
+ * aottranslator.cpp -- implement the AotTranslator class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "aottranslator.h"
+#include "aotruntime.h"
+#include "abstractalu.h"
+#include "disassembler.h"
+
+#include <iomanip>
+#include <sstream>
+
+// Formatting helpers
+static std::string hex32(uint32_t value) {
+  std::ostringstream ss;
+  ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << value << "u";
+  return ss.str();
+}
+
+static std::string blockName(uint32_t address) {
+  std::ostringstream ss;
+  ss << "block_" << std::hex << std::setfill('0') << std::setw(8) << address;
+  return ss.str();
+}
+
+// Cstr
+AotTranslator::AotTranslator(const std::vector<uint8_t>& image) : _image(image) {
+}
+
+// Dstr
+AotTranslator::~AotTranslator() {
+}
+
+// Block count
+uint32_t AotTranslator::getBlockCount() const {
+  return _blocks.size();
+}
+
+// Image words
+uint32_t AotTranslator::word(uint32_t address) const {
+  uint32_t w = 0;
+  for (uint32_t k = 0; k < 4; k++)
+    w = (w << 8) | (address + k < _image.size() ? _image[address + k] : 0);
+  return w;
+}
+
+// Straight-line instructions
+bool AotTranslator::isStraight(const DecodedInstruction& di) {
+  return di.handler != DI_HALT && di.handler != DI_UNKNOWN && !di.isControlTransfer();
+}
+
+// Second operand
+std::string AotTranslator::operand(const DecodedInstruction& di) {
+  if (di.i)
+    return hex32(di.imm);
+  std::ostringstream ss;
+  ss << "regs->read(" << (uint32_t)di.rs2 << ")";
+  return ss.str();
+}
+
+// Find the blocks
+void AotTranslator::discover(uint32_t entry) {
+  std::vector<uint32_t> work;
+  work.push_back(entry);
+
+  while (!work.empty()) {
+    uint32_t start = work.back();
+    work.pop_back();
+    if ((start & 3) != 0 || start >= _image.size() || _blocks.count(start) != 0)
+      continue;
+
+    uint32_t length = 0;
+    DecodedInstruction last;
+    bool terminated = false, alone = false;
+    while (length < AOT_MAX_BLOCK) {
+      last = DecodedInstruction::decode(Instruction(word(start + 4 * length)));
+      if (!isStraight(last)) {
+        // a block ends with its branch; the other instructions are alone in their block
+        if (last.handler == DI_BICC || last.handler == DI_CALL || last.handler == DI_JMPL) {
+          length++;
+          terminated = true;
+        } else if (length == 0) {
+          length++;
+          alone = true;
+        }
+        break;
+      }
+      length++;
+    }
+    _blocks[start] = length;
+
+    // Successors
+    uint32_t end = start + 4 * length;
+    if (terminated) {
+      if (last.handler != DI_JMPL) {
+        work.push_back(end - 4 + last.imm);
+        work.push_back(end);
+      }
+    } else if (!alone || last.handler != DI_HALT) {
+      work.push_back(end);
+    }
+  }
+}
+
+// Translate the program
+void AotTranslator::translate(std::ostream& os, uint32_t entry, uint32_t memsize) {
+  _blocks.clear();
+  discover(entry);
+
+  os << "/*" << std::endl
+     << " * Generated by ksparc-aot; compile it and link it against the ksparc-aot runtime" << std::endl
+     << " */" << std::endl
+     << "#include <iostream>" << std::endl
+     << "#include \"aotruntime.h\"" << std::endl
+     << std::endl;
+
+  // Image
+  os << "static const uint8_t image[] = {";
+  for (uint32_t k = 0; k < _image.size(); k++)
+    os << (k % 16 == 0 ? "\n  " : " ") << "0x" << std::hex << std::setfill('0') << std::setw(2)
+       << (uint32_t)_image[k] << std::dec << (k + 1 < _image.size() ? "," : "");
+  os << std::endl << "};" << std::endl << std::endl;
+
+  // Blocks
+  for (auto it = _blocks.begin(); it != _blocks.end(); it++)
+    emitBlock(os, it->first);
+
+  // Dispatch
+  os << "static uint32_t dispatch(AotRuntime& rt, uint32_t pc) {" << std::endl
+     << "  switch (pc) {" << std::endl;
+  for (auto it = _blocks.begin(); it != _blocks.end(); it++)
+    os << "    case " << hex32(it->first) << ": return " << blockName(it->first) << "(rt);" << std::endl;
+  os << "    default: return rt.interpret(pc);" << std::endl
+     << "  }" << std::endl
+     << "}" << std::endl << std::endl;
+
+  // Main : no size is the default of the runtime, unless the image does not fit in it
+  if (memsize == 0 ? _image.size() > AOT_MEMORY_SIZE : memsize < _image.size())
+    memsize = (_image.size() + 3) & ~3;
+  os << "int main() {" << std::endl
+     << "  AotRuntime rt" << (memsize == 0 ? "" : "(" + std::to_string(memsize) + ")") << ";" << std::endl
+     << "  rt.load(image, sizeof(image));" << std::endl
+     << "  rt.run(dispatch, " << hex32(entry) << ");" << std::endl
+     << "  rt.dump(std::cout);" << std::endl
+     << "  return 0;" << std::endl
+     << "}" << std::endl;
+}
+
+// Generate a block
+void AotTranslator::emitBlock(std::ostream& os, uint32_t start) {
+  uint32_t length = _blocks[start];
+
+  os << "static uint32_t " << blockName(start) << "(AotRuntime& rt) {" << std::endl
+     << "  WindowRegisters* regs = rt.registers();" << std::endl
+     << "  AbstractMemory* mem = rt.memory();" << std::endl
+     << "  (void)regs; (void)mem;" << std::endl;
+
+  for (uint32_t k = 0; k < length; k++) {
+    uint32_t address = start + 4 * k;
+    uint32_t w = word(address);
+    DecodedInstruction di = DecodedInstruction::decode(Instruction(w));
+    os << "  // " << std::hex << std::setfill('0') << std::setw(8) << address << std::dec << ": "
+       << disassemble(Instruction(w), address) << std::endl;
+
+    if (isStraight(di)) {
+      emitInstruction(os, di, address);
+      continue;
+    }
+
+    uint32_t target = address + di.imm;
+    switch (di.handler) {
+      case DI_HALT:
+        os << "  return rt.halt(" << hex32(address) << ");" << std::endl;
+        break;
+
+      case DI_BICC: {
+          // see SparcEngine::next() for the delay slot
+          std::ostringstream delay;
+          DecodedInstruction ds = DecodedInstruction::decode(Instruction(word(address + 4)));
+          if (isStraight(ds) && ds.handler != DI_SAVE && ds.handler != DI_RESTORE) {
+            delay << "    // " << std::hex << std::setfill('0') << std::setw(8) << address + 4 << std::dec
+                  << ": " << disassemble(Instruction(word(address + 4)), address + 4) << std::endl;
+            std::ostringstream code;
+            emitInstruction(code, ds, address + 4);
+            std::istringstream lines(code.str());
+            std::string line;
+            while (std::getline(lines, line))
+              delay << "  " << line << std::endl;
+            delay << "    return " << hex32(target) << ";" << std::endl;
+          } else {
+            delay << "    return rt.interpret(" << hex32(address + 4) << ", true, " << hex32(target) << ");" << std::endl;
+          }
+
+          if (di.cond == INST_COND_NEVER) {
+            os << "  return " << hex32(address + 4) << ";" << std::endl;
+          } else if (di.cond == (INST_COND_NEVER | 0x08)) {
+            // branch always
+            if (di.a)
+              os << "  return " << hex32(target) << ";" << std::endl;
+            else
+              os << "  {" << std::endl << delay.str() << "  }" << std::endl;
+          } else {
+            os << "  if (rt.condition(" << (uint32_t)di.cond << ")) {" << std::endl
+               << delay.str()
+               << "  }" << std::endl
+               << "  return " << hex32(address + 4) << ";" << std::endl;
+          }
+        }
+        break;
+
+      case DI_CALL:
+        os << "  regs->write(15, " << hex32(address >> 2) << ");" << std::endl
+           << "  return " << hex32(target) << ";" << std::endl;
+        break;
+
+      case DI_JMPL:
+        os << "  {" << std::endl
+           << "    uint32_t target = (regs->read(" << (uint32_t)di.rs1 << ") + " << operand(di) << ") << 2;" << std::endl;
+        if (di.rd != 0)
+          os << "    regs->write(" << (uint32_t)di.rd << ", " << hex32(address >> 2) << ");" << std::endl;
+        os << "    return target;" << std::endl
+           << "  }" << std::endl;
+        break;
+
+      default:
+        // other control transfers and illegal instructions (traps) : done by the interpreter
+        os << "  return rt.interpret(" << hex32(address) << ");" << std::endl;
+        break;
+    }
+    os << "}" << std::endl << std::endl;
+    return;
+  }
+
+  os << "  return " << hex32(start + 4 * length) << ";" << std::endl
+     << "}" << std::endl << std::endl;
+}
+
+// Generate an instruction
+void AotTranslator::emitInstruction(std::ostream& os, const DecodedInstruction& di, uint32_t address) {
+  uint32_t rd = di.rd, rs1 = di.rs1;
+  std::string a = "regs->read(" + std::to_string(rs1) + ")";
+  std::string b = operand(di);
+  std::string addr = a + " + " + b;
+  std::string dest = "regs->write(" + std::to_string(rd) + ", ";
+
+  switch (di.handler) {
+    case DI_FLUSH:
+      // nothing to do (nothing is cached here)
+      break;
+
+    case DI_SETHI:
+      if (rd != 0)
+        os << "  " << dest << hex32(di.imm) << ");" << std::endl;
+      break;
+
+    case DI_SAVE:
+    case DI_RESTORE:
+      // an invalid window : the interpreter spills, fills or traps (the delay slots of the branches go to it)
+      os << "  if (!regs->" << (di.handler == DI_SAVE ? "canSave" : "canRestore") << "())" << std::endl
+         << "    return rt.interpret(" << hex32(address) << ");" << std::endl
+         << "  {" << std::endl
+         << "    uint32_t v = " << addr << ";" << std::endl
+         << "    regs->" << (di.handler == DI_SAVE ? "save" : "restore") << "();" << std::endl;
+      if (rd != 0)
+        os << "    " << dest << "v);" << std::endl;
+      os << "  }" << std::endl;
+      break;
+
+    case DI_ALU: {
+        std::string expr;
+        switch (di.op3) {
+          case ALU_OP_ADD:  expr = a + " + " + b;       break;
+          case ALU_OP_AND:  expr = a + " & " + b;       break;
+          case ALU_OP_OR:   expr = a + " | " + b;       break;
+          case ALU_OP_XOR:  expr = a + " ^ " + b;       break;
+          case ALU_OP_SUB:  expr = a + " - " + b;       break;
+          case ALU_OP_ANDN: expr = a + " & ~" + b;      break;
+          case ALU_OP_ORN:  expr = a + " | ~" + b;      break;
+          case ALU_OP_XNOR: expr = a + " ^ ~" + b;      break;
+          case ALU_OP_SLL:
+          case ALU_OP_SRL:
+          case ALU_OP_SRA:  expr = "AbstractALU::shift(" + std::to_string((uint32_t)di.op3) + ", " + a + ", " + b + ")"; break;
+          default: break;
+        }
+
+        if (!expr.empty()) {
+          if (rd != 0)
+            os << "  " << dest << expr << ");" << std::endl;
+        } else {
+          // condition codes, y, multiplications, divisions : made by the ALU
+          std::string call = "rt.alu(" + std::to_string((uint32_t)di.op3) + ", " + a + ", " + b + ", regs->read(" + std::to_string(rd) + "))";
+          if (rd != 0)
+            os << "  " << dest << call << ");" << std::endl;
+          else
+            os << "  " << call << ";" << std::endl;
+        }
+      }
+      break;
+
+    case DI_LDSB:
+      os << "  " << (rd != 0 ? dest : "(void)(") << "signext(mem->readByte(" << addr << "), 8));" << std::endl;
+      break;
+    case DI_LDSH:
+      os << "  " << (rd != 0 ? dest : "(void)(") << "signext(mem->readHalfword(" << addr << "), 16));" << std::endl;
+      break;
+    case DI_LDUB:
+      os << "  " << (rd != 0 ? dest : "(void)(") << "mem->readByte(" << addr << "));" << std::endl;
+      break;
+    case DI_LDUH:
+      os << "  " << (rd != 0 ? dest : "(void)(") << "mem->readHalfword(" << addr << "));" << std::endl;
+      break;
+    case DI_LD:
+      os << "  " << (rd != 0 ? dest : "(void)(") << "mem->readWord(" << addr << "));" << std::endl;
+      break;
+
+    case DI_STB:
+      os << "  mem->writeByte(" << addr << ", (uint8_t)regs->read(" << rd << "));" << std::endl;
+      break;
+    case DI_STH:
+      os << "  mem->writeHalfword(" << addr << ", (uint16_t)regs->read(" << rd << "));" << std::endl;
+      break;
+    case DI_ST:
+      os << "  mem->writeWord(" << addr << ", regs->read(" << rd << "));" << std::endl;
+      break;
+
+    default:
+      // special registers, FPop, CPop, double words... : done by the reference engine
+      os << "  rt.execute(" << hex32(address) << ");" << std::endl;
+      break;
+  }
+}
+
@@ -0,0 +1,104 @@
+/*
+ * aottranslator.h -- defines the AotTranslator class, which translates a kSparc program into C++
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef AOTTRANSLATOR_H
+#define AOTTRANSLATOR_H
+
+#include <stdint.h>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "decodedinstruction.h"
+
+// Maximum number of instructions of a translated block
+#define AOT_MAX_BLOCK     1024
+
+/**
+ * The AotTranslator translates a program image (as produced by kasm) into a C++ source file, which
+ * is compiled and linked against the AotRuntime.
+ *
+ * The blocks are found by following the control flow from the entry point (branch targets and
+ * fall-through, call targets and return addresses). Each block becomes a function which executes
+ * it and returns the address of the next block; a dispatch function maps an address to the
+ * function of its block, which is how indirect jumps (JMPL) are resolved. Addresses that are not
+ * the start of a known block are run by the interpreter of the runtime, until they come back to a
+ * known block.
+ *
+ * The instructions with a simple semantic are translated into C++; the others (special registers,
+ * FPop, CPop, double word accesses...) are executed by the reference engine of the runtime. The
+ * translated program must not modify its own code.
+ */
+class AotTranslator {
+	public:
+    /**
+     * Constructor
+     * @param image program image, loaded at address 0
+     */
+		AotTranslator(const std::vector<uint8_t>& image);
+    /**
+     * Destructor
+     */
+		~AotTranslator();
+
+    /**
+     * Translate the program
+     * @param os output stream for the C++ source
+     * @param entry address of the first instruction
+     * @param memsize size of the memory of the generated program (0 for AOT_MEMORY_SIZE)
+     */
+    void translate(std::ostream& os, uint32_t entry = 0, uint32_t memsize = 0);
+
+    /**
+     * Get the number of blocks found by the last translation
+     * @returns number of blocks
+     */
+    uint32_t getBlockCount() const;
+
+	private:
+    /**
+     * Read a word of the image (0 outside)
+     * @param address address of the word
+     * @returns the word
+     */
+    uint32_t word(uint32_t address) const;
+    /**
+     * Find every block reachable from an address
+     * @param entry entry point
+     */
+    void discover(uint32_t entry);
+    /**
+     * Generate the function of a block
+     * @param os output stream
+     * @param start address of the block
+     */
+    void emitBlock(std::ostream& os, uint32_t start);
+    /**
+     * Generate the code of an instruction which is not a control transfer
+     * @param os output stream
+     * @param di decoded instruction
+     * @param address address of the instruction
+     */
+    void emitInstruction(std::ostream& os, const DecodedInstruction& di, uint32_t address);
+    /**
+     * Second operand of a format 3 instruction, as a C++ expression
+     * @param di decoded instruction
+     * @returns the expression
+     */
+    static std::string operand(const DecodedInstruction& di);
+    /**
+     * Tells if an instruction can be part of a block (not a control transfer, an illegal instruction nor the null word)
+     * @param di decoded instruction
+     * @returns true if it can
+     */
+    static bool isStraight(const DecodedInstruction& di);
+
+    std::vector<uint8_t> _image;
+    std::map<uint32_t, uint32_t> _blocks;   // start address -> number of instructions
+};
+
+#endif // AOTTRANSLATOR_H
+
@@ -197,6 +197,17 @@ vector<OpCode> opcodes {
     OpCode(INST_OP3_STC    , "stc"  , "[address]", "destination register", 2, false), 
     OpCode(INST_OP3_STDC   , "stdc" , "[address]", "destination register", 2, false), 
     OpCode(INST_OP3_STCSR  , "stcsr", "[address]", "destination register", 2, false),
+    // Alternate space load and store instr
+    OpCode(INST_OP3_LDSBA  , "ldsba", "[address] asi", "destination register"),
+    OpCode(INST_OP3_LDSHA  , "ldsha", "[address] asi", "destination register"),
+    OpCode(INST_OP3_LDUBA  , "lduba", "[address] asi", "destination register"),
+    OpCode(INST_OP3_LDUHA  , "lduha", "[address] asi", "destination register"),
+    OpCode(INST_OP3_LDA    , "lda"  , "[address] asi", "destination register"),
+    OpCode(INST_OP3_LDDA   , "ldda" , "[address] asi", "destination register"),
+    OpCode(INST_OP3_STBA   , "stba" , "[address] asi", "destination register"),
+    OpCode(INST_OP3_STHA   , "stha" , "[address] asi", "destination register"),
+    OpCode(INST_OP3_STA    , "sta"  , "[address] asi", "destination register"),
+    OpCode(INST_OP3_STDA   , "stda" , "[address] asi", "destination register"),
     // rd and wr
     OpCode(0, "rd", "source special register", "destination register"),
     OpCode(0, "wr", UAL_PARAMETERS),
@@ -464,6 +475,35 @@ void parseAddress(string str, uint32_t* rs1, uint32_t* s2, uint32_t* i, ErrorLis
   }
 }
 
+/*
+ * parseASI -- separate the address space identifier from the address of an alternate load or store
+ * str : string to parse, of the form [reg1+reg2]asi (spaces have been removed); only the address is left in it
+ *
+ * returns the address space identifier (decimal, or hexadecimal as the disassembler prints it)
+ */
+uint32_t parseASI(string& str, ErrorList& errs, size_t line) {
+  size_t p = str.find(']');
+  if (p == string::npos || p + 1 >= str.size()) {
+    errs.push_back(ASMError::WrongAddressFormatError(line));
+    return 0;
+  }
+
+  string field = str.substr(p + 1);
+  str = str.substr(0, p + 1);
+  size_t used = 0;
+  unsigned long asi = 0;
+  try {
+    asi = stoul(field, &used, 0);
+  } catch (std::logic_error& e) {
+    used = 0;
+  }
+  if (used != field.size() || asi > 0xFF) {
+    errs.push_back(ASMError::WrongNumberFormatError(field, line));
+    return 0;
+  }
+  return (uint32_t)asi;
+}
+
 /*
  * Cstr
  */
@@ -732,28 +772,26 @@ Assembler::InstructionList Assembler::read(string instr) {
           branchtype,
           disp
           ));
-  } else if (isLoadInstr(opcode)) {
-    uint32_t s1, s2, i;
-    parseAddress(argl[0], &s1, &s2, &i, _errors, _line);
-    instructions.push_back(Instruction::makeInstruction(
-          INST_OP_MEM,
-          getRegister(argl[1], _errors, _line),
-          oc.code,
-          s1,
-          i,
-          0,
-          s2
-          ));
-  } else if (isStoreInstr(opcode)) {
-    uint32_t s1, s2, i;
-    parseAddress(argl[1], &s1, &s2, &i, _errors, _line);
+  } else if (isLoadInstr(opcode) || isStoreInstr(opcode)) {
+    // loads : [address], rd; stores : rd, [address]
+    string address = argl[isLoadInstr(opcode) ? 0 : 1];
+    string reg = argl[isLoadInstr(opcode) ? 1 : 0];
+    uint32_t s1, s2, i, asi = 0;
+    bool alternate = (oc.code & 0x30) == INST_OP3_ALTERNATE;
+    if (alternate)
+      asi = parseASI(address, _errors, _line);
+    parseAddress(address, &s1, &s2, &i, _errors, _line);
+    if (alternate && i == 1) {
+      // the ASI takes the place of the immediate
+      _errors.push_back(ASMError::WrongAddressFormatError(_line));
+    }
     instructions.push_back(Instruction::makeInstruction(
           INST_OP_MEM,
-          getRegister(argl[0], _errors, _line),
+          getRegister(reg, _errors, _line),
           oc.code,
           s1,
           i,
-          0,
+          asi,
           s2
           ));
   } else if (isArithLog(opcode)) {
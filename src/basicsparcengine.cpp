@@ -0,0 +1,12 @@
+/*
+ * basicsparcengine.cpp -- compile the usual configurations of BasicSparcEngine
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "basicsparcengine.h"
+
+template class BasicSparcEngine<SimpleMemory, SimpleALU, WindowRegisters>;
+template class BasicSparcEngine<PagedMemory, SimpleALU, WindowRegisters>;
+template class BasicSparcEngine<ReservedMemory, SimpleALU, WindowRegisters>;
+template class BasicSparcEngine<SrmmuMemory, SimpleALU, WindowRegisters>;
@@ -0,0 +1,402 @@
+/*
+ * basicsparcengine.h -- defines a sparc engine specialized at compile time for its components
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef BASICSPARCENGINE_H
+#define BASICSPARCENGINE_H
+
+#include "sparcengine.h"
+#include "simplememory.h"
+#include "pagedmemory.h"
+#include "reservedmemory.h"
+#include "srmmumemory.h"
+#include "simplealu.h"
+
+/**
+ * This engine executes the same instruction set as SparcEngine, with the same semantics, but knows
+ * the exact type of its memory, ALU and register file at compile time.
+ *
+ * SparcEngine reaches its components through AbstractMemory, AbstractALU and WindowRegisters
+ * pointers, so every memory access and every ALU operation is a virtual call that the compiler
+ * cannot see through. Here, the main loop calls the components with qualified names
+ * (Memory::read() rather than read()), so the calls are direct and, when the components define
+ * their hot functions in their headers (as SimpleMemory and WindowRegisters do), they are inlined
+ * into the loop.
+ *
+ * Requirements on the template parameters :
+ * - Memory derives from AbstractMemory (its load*(), store*(), read() and write() are called directly)
+ * - ALU derives from AbstractALU and defines calc(uint8_t, const Register*, uint32_t, Register*)
+ * - Registers derives from WindowRegisters
+ *
+ * As for ThreadedSparcEngine, only the frequent instructions are made in the loop; the others are
+ * given to SparcEngine::execute(), which stays the reference. SparcEngine remains the engine to use
+ * when the components are only known at run time.
+ *
+ * @see SparcEngine
+ * @see SimpleSparcEngine
+ */
+template <class Memory, class ALU, class Registers>
+class BasicSparcEngine : public SparcEngine {
+	public:
+    /**
+     * Constructor.
+     * @see AbstractSparcEngine::AbstractSparcEngine()
+     */
+		BasicSparcEngine(
+        Memory* mem,
+        ALU* alu,
+        AbstractFPU* fpu,
+        Registers* registers,
+        SpecialRegister* psr,
+        SpecialRegister* wim,
+        SpecialRegister* tbr,
+        SpecialRegister* y,
+        SpecialRegister* pc,
+        SpecialRegister* npc,
+        SpecialRegister* fsr
+    );
+    /**
+     * Destructor
+     */
+		~BasicSparcEngine();
+
+    /**
+     * Execute next instruction
+     * @see AbstractSparcEngine::next()
+     */
+    bool next();
+
+	protected:
+    /**
+     * Execute several instructions in a row, without any virtual call on the frequent instructions
+     * @see SparcEngine::runBatch()
+     */
+    uint32_t runBatch(uint64_t count, uint32_t breakpoint);
+
+	private:
+    /**
+     * Memory accesses, through the fast paths of the memory (see AbstractMemory::load32()); the stores are then
+     * reported with AbstractMemory::written()
+     */
+    uint8_t loadByte(uint32_t address) const;
+    uint16_t loadHalfword(uint32_t address) const;
+    uint32_t loadWord(uint32_t address) const;
+    void storeByte(uint32_t address, uint8_t value);
+    void storeHalfword(uint32_t address, uint16_t value);
+    void storeWord(uint32_t address, uint32_t value);
+
+    /**
+     * The components, with their real types
+     */
+    Memory* _mem;
+    ALU* _calc;
+    Registers* _regs;
+};
+
+/**
+ * The usual configuration of ksparc
+ */
+typedef BasicSparcEngine<SimpleMemory, SimpleALU, WindowRegisters> SimpleSparcEngine;
+/**
+ * The same, with the whole address space
+ */
+typedef BasicSparcEngine<PagedMemory, SimpleALU, WindowRegisters> PagedSparcEngine;
+/**
+ * The same, with guest addresses turned into host addresses by a single addition
+ */
+typedef BasicSparcEngine<ReservedMemory, SimpleALU, WindowRegisters> ReservedSparcEngine;
+/**
+ * The same, behind a SPARC reference MMU (the lookups of its translation cache are inline)
+ */
+typedef BasicSparcEngine<SrmmuMemory, SimpleALU, WindowRegisters> SrmmuSparcEngine;
+
+// Cstr
+template <class Memory, class ALU, class Registers>
+BasicSparcEngine<Memory, ALU, Registers>::BasicSparcEngine(
+    Memory* mem,
+    ALU* alu,
+    AbstractFPU* fpu,
+    Registers* registers,
+    SpecialRegister* psr,
+    SpecialRegister* wim,
+    SpecialRegister* tbr,
+    SpecialRegister* y,
+    SpecialRegister* pc,
+    SpecialRegister* npc,
+    SpecialRegister* fsr
+) : SparcEngine(mem, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr),
+    _mem(mem), _calc(alu), _regs(registers) {
+}
+
+// Dstr
+template <class Memory, class ALU, class Registers>
+BasicSparcEngine<Memory, ALU, Registers>::~BasicSparcEngine() {
+}
+
+// Execute next instruction
+template <class Memory, class ALU, class Registers>
+bool BasicSparcEngine<Memory, ALU, Registers>::next() {
+  bool executed = (runBatch(1, SE_NO_BREAKPOINT) == SE_STOP_BUDGET);
+  _calc->syncFlags();
+  return executed;
+}
+
+// Memory accesses
+template <class Memory, class ALU, class Registers>
+inline uint8_t BasicSparcEngine<Memory, ALU, Registers>::loadByte(uint32_t address) const {
+  uint8_t d[1];
+  _mem->Memory::read(address, 1, d);
+  return d[0];
+}
+
+template <class Memory, class ALU, class Registers>
+inline uint16_t BasicSparcEngine<Memory, ALU, Registers>::loadHalfword(uint32_t address) const {
+  if (!_mem->aligned(address, 2))
+    return 0;
+  return _mem->Memory::load16(address);
+}
+
+template <class Memory, class ALU, class Registers>
+inline uint32_t BasicSparcEngine<Memory, ALU, Registers>::loadWord(uint32_t address) const {
+  if (!_mem->aligned(address, 4))
+    return 0;
+  return _mem->Memory::load32(address);
+}
+
+template <class Memory, class ALU, class Registers>
+inline void BasicSparcEngine<Memory, ALU, Registers>::storeByte(uint32_t address, uint8_t value) {
+  uint8_t d[1] = { value };
+  _mem->Memory::write(address, d, 1);
+}
+
+template <class Memory, class ALU, class Registers>
+inline void BasicSparcEngine<Memory, ALU, Registers>::storeHalfword(uint32_t address, uint16_t value) {
+  if (_mem->aligned(address, 2))
+    _mem->Memory::store16(address, value);
+}
+
+template <class Memory, class ALU, class Registers>
+inline void BasicSparcEngine<Memory, ALU, Registers>::storeWord(uint32_t address, uint32_t value) {
+  if (_mem->aligned(address, 4))
+    _mem->Memory::store32(address, value);
+}
+
+// Main loop
+template <class Memory, class ALU, class Registers>
+uint32_t BasicSparcEngine<Memory, ALU, Registers>::runBatch(uint64_t count, uint32_t breakpoint) {
+  Registers* regs = _regs;
+  SpecialRegister* status = psr();
+  uint32_t reason = SE_STOP_BUDGET;
+  uint64_t done = 0;
+
+  // Local copies of the state
+  uint32_t pcv = pc()->read(), npcv = npc()->read();
+  bool branch = _branch, isdcti = _isdcti;
+  uint32_t dcti = _dcti;
+  _stop = SE_STOP_NONE;
+
+  for (; done < count; done++) {
+    if (npcv == breakpoint) {
+      reason = SE_STOP_BREAKPOINT;
+      break;
+    }
+
+    pcv = npcv;
+    const DecodedInstruction& di = fetch(pcv);
+    uint32_t addr = regs->Registers::read(di.rs1) + (di.i ? di.imm : regs->Registers::read(di.rs2));
+
+    switch (di.handler) {
+      // The null word : we stay here (as SparcEngine does)
+      case DI_HALT:
+        reason = SE_STOP_HALT;
+        goto out;
+
+      case DI_SETHI:
+        regs->Registers::write(di.rd, di.imm);
+        break;
+
+      case DI_BICC:
+        _calc->syncFlags();
+        branch = holds(di.cond, status->getField(PSR_ICC));
+        dcti = pcv + di.imm;
+        isdcti = (!di.a) || (branch && (di.cond & 0x07) != INST_COND_NEVER);
+        break;
+
+      case DI_CALL:
+        dcti = pcv + di.imm;
+        regs->Registers::write(15, pcv >> 2);
+        branch = true;
+        isdcti = false;
+        break;
+
+      case DI_JMPL:
+        dcti = addr << 2;
+        regs->Registers::write(di.rd, pcv >> 2);
+        branch = true;
+        isdcti = false;
+        break;
+
+      // operands are read in the old window, result written in the new one
+      case DI_SAVE:
+        if (!regs->Registers::canSave())
+          goto windows;
+        regs->Registers::save();
+        regs->Registers::write(di.rd, addr);
+        break;
+      case DI_RESTORE:
+        if (!regs->Registers::canRestore())
+          goto windows;
+        regs->Registers::restore();
+        regs->Registers::write(di.rd, addr);
+        break;
+
+      case DI_FLUSH:
+        invalidate(addr & 0xFFFFFFF8, 8);
+        break;
+
+      case DI_ALU: {
+          uint32_t a = regs->Registers::read(di.rs1);
+          uint32_t b = di.i ? di.imm : regs->Registers::read(di.rs2);
+          uint32_t res;
+
+          // Operations that do not touch the condition codes nor y are made here
+          switch (di.op3) {
+            case ALU_OP_ADD:  res = a + b;  break;
+            case ALU_OP_AND:  res = a & b;  break;
+            case ALU_OP_OR:   res = a | b;  break;
+            case ALU_OP_XOR:  res = a ^ b;  break;
+            case ALU_OP_SUB:  res = a - b;  break;
+            case ALU_OP_ANDN: res = a & ~b; break;
+            case ALU_OP_ORN:  res = a | ~b; break;
+            case ALU_OP_XNOR: res = a ^ ~b; break;
+            case ALU_OP_SLL:
+            case ALU_OP_SRL:
+            case ALU_OP_SRA:  res = AbstractALU::shift(di.op3, a, b); break;
+            default: {
+                // the others are left to the ALU
+                res = regs->Registers::read(di.rd);
+                Register rs1(&a), rd(&res);
+                _calc->ALU::calc(di.op3, &rs1, b, &rd);
+              }
+              break;
+          }
+          regs->Registers::write(di.rd, res);
+        }
+        break;
+
+      // Loads (a faulted access is not made again : the reference engine only raises the trap)
+      case DI_LDSB: {
+          uint32_t v = signext(loadByte(addr), 8);
+          if (_mem->hasFault())
+            goto faulted;
+          regs->Registers::write(di.rd, v);
+        }
+        break;
+      case DI_LDSH: {
+          uint32_t v = signext(loadHalfword(addr), 16);
+          if (_mem->hasFault())
+            goto faulted;
+          regs->Registers::write(di.rd, v);
+        }
+        break;
+      case DI_LDUB: {
+          uint32_t v = loadByte(addr);
+          if (_mem->hasFault())
+            goto faulted;
+          regs->Registers::write(di.rd, v);
+        }
+        break;
+      case DI_LDUH: {
+          uint32_t v = loadHalfword(addr);
+          if (_mem->hasFault())
+            goto faulted;
+          regs->Registers::write(di.rd, v);
+        }
+        break;
+      case DI_LD: {
+          uint32_t v = loadWord(addr);
+          if (_mem->hasFault())
+            goto faulted;
+          regs->Registers::write(di.rd, v);
+        }
+        break;
+
+      // Stores
+      case DI_STB:
+        storeByte(addr, (uint8_t)regs->Registers::read(di.rd));
+        if (_mem->hasFault())
+          goto faulted;
+        _mem->written(addr, 1);
+        break;
+      case DI_STH:
+        storeHalfword(addr, (uint16_t)regs->Registers::read(di.rd));
+        if (_mem->hasFault())
+          goto faulted;
+        _mem->written(addr, 2);
+        break;
+      case DI_ST:
+        storeWord(addr, regs->Registers::read(di.rd));
+        if (_mem->hasFault())
+          goto faulted;
+        _mem->written(addr, 4);
+        break;
+
+      // Everything else is done by the reference engine
+      faulted:
+      windows: // an invalid window : the reference spills, fills or traps
+      default:
+        pc()->write(pcv);
+        _branch = branch;
+        _isdcti = isdcti;
+        _dcti = dcti;
+        _trapped = false;
+        if (_mem->hasFault())
+          trap(faultTrap(_mem));
+        else
+          execute(di);
+        branch = _branch;
+        isdcti = _isdcti;
+        dcti = _dcti;
+        if (_stop != SE_STOP_NONE) {
+          // the engine stays on the instruction
+          reason = _stop;
+          npcv = pcv;
+          goto out;
+        }
+        break;
+    }
+
+    // Position the next pc (see SparcEngine::next())
+    if (branch) {
+      if (isdcti) {
+        npcv = pcv + 4;
+        isdcti = false;
+      } else {
+        npcv = dcti;
+        branch = false;
+      }
+    } else {
+      npcv = pcv + 4;
+    }
+  }
+
+out:
+  // Write back the state
+  pc()->write(pcv);
+  npc()->write(npcv);
+  _branch = branch;
+  _isdcti = isdcti;
+  _dcti = dcti;
+  _executed += done;
+  return reason;
+}
+
+// The usual configurations are compiled once, in basicsparcengine.cpp
+extern template class BasicSparcEngine<SimpleMemory, SimpleALU, WindowRegisters>;
+extern template class BasicSparcEngine<PagedMemory, SimpleALU, WindowRegisters>;
+extern template class BasicSparcEngine<ReservedMemory, SimpleALU, WindowRegisters>;
+extern template class BasicSparcEngine<SrmmuMemory, SimpleALU, WindowRegisters>;
+
+#endif // BASICSPARCENGINE_H
@@ -0,0 +1,176 @@
+/*
+ * blockcache.cpp -- implementation of the BasicBlock structure and of the BlockCache class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "blockcache.h"
+
+// BasicBlock
+// Cstr
+BasicBlock::BasicBlock(uint32_t addr) :
+  address(addr), length(0), hasdelay(false), taken(NULL), fallthrough(NULL), count(0) {
+}
+
+// End of the block
+uint32_t BasicBlock::end() const {
+  return address + 4 * length;
+}
+
+// BlockCache
+// Cstr
+BlockCache::BlockCache() : _generation(0) {
+  flush();
+  collect();
+  _rashits = 0;
+  _rasmisses = 0;
+}
+
+// Dstr
+BlockCache::~BlockCache() {
+  flush();
+  collect();
+}
+
+// Lookup
+BasicBlock* BlockCache::lookup(uint32_t address) {
+  auto it = _blocks.find(address);
+  return (it == _blocks.end() ? NULL : it->second);
+}
+
+// Insertion
+BasicBlock* BlockCache::insert(BasicBlock* block) {
+  _blocks[block->address] = block;
+
+  // Remember the pages covered by the block (delay slot included)
+  uint32_t last = block->end() + (block->hasdelay ? 4 : 0) - 1;
+  if (block->address < _low)
+    _low = block->address;
+  if (last > _high)
+    _high = last;
+  for (uint32_t page = block->address >> BC_PAGE_BITS; page <= (last >> BC_PAGE_BITS); page++)
+    _pages[page].push_back(block);
+
+  return block;
+}
+
+// Indirect branches
+BasicBlock* BlockCache::lookupTarget(uint32_t address) {
+  Target& t = _targets[(address >> 2) & (BC_TARGETS - 1)];
+  if (t.block != NULL && t.address == address)
+    return t.block;
+
+  BasicBlock* block = lookup(address);
+  if (block != NULL) {
+    t.address = address;
+    t.block = block;
+  }
+  return block;
+}
+
+void BlockCache::pushReturn(uint32_t address, BasicBlock* block) {
+  _rastop = (_rastop + 1) % BC_RAS_SIZE;
+  _ras[_rastop].address = address;
+  _ras[_rastop].block = block;
+  if (_rasdepth < BC_RAS_SIZE)
+    _rasdepth++;
+}
+
+BasicBlock* BlockCache::popReturn(uint32_t address) {
+  if (_rasdepth == 0) {
+    _rasmisses++;
+    return NULL;
+  }
+
+  Target& t = _ras[_rastop];
+  _rastop = (_rastop + BC_RAS_SIZE - 1) % BC_RAS_SIZE;
+  _rasdepth--;
+
+  if (t.address != address) {
+    _rasmisses++;
+    return NULL;
+  }
+
+  _rashits++;
+  if (t.block == NULL)
+    t.block = lookup(address);
+  return t.block;
+}
+
+// Invalidation
+bool BlockCache::invalidate(uint32_t address, uint32_t size) {
+  uint32_t last = address + size - 1;
+  if (size == 0 || address > _high || last < _low)
+    return false;
+
+  // Only the pages between the blocks are looked for; past the number of pages holding blocks, they are all tried
+  uint32_t first = (address > _low ? address : _low) >> BC_PAGE_BITS;
+  uint32_t end = (last < _high ? last : _high) >> BC_PAGE_BITS;
+  if (end - first >= _pages.size()) {
+    for (auto it = _pages.begin(); it != _pages.end(); it++) {
+      if (it->first >= first && it->first <= end && overlaps(it->second, address, last)) {
+        flush();
+        return true;
+      }
+    }
+  } else {
+    for (uint32_t page = first; page <= end; page++) {
+      auto it = _pages.find(page);
+      if (it != _pages.end() && overlaps(it->second, address, last)) {
+        flush();
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool BlockCache::overlaps(const std::vector<BasicBlock*>& blocks, uint32_t address, uint32_t last) {
+  for (auto b = blocks.begin(); b != blocks.end(); b++) {
+    uint32_t start = (*b)->address;
+    uint32_t stop = (*b)->end() + ((*b)->hasdelay ? 4 : 0);
+    if (address < stop && last >= start)
+      return true;
+  }
+  return false;
+}
+
+void BlockCache::flush() {
+  for (auto it = _blocks.begin(); it != _blocks.end(); it++)
+    _dropped.push_back(it->second);
+  _blocks.clear();
+  _pages.clear();
+  _low = 0xFFFFFFFF;
+  _high = 0;
+
+  _rastop = 0;
+  _rasdepth = 0;
+  for (uint32_t k = 0; k < BC_TARGETS; k++)
+    _targets[k].block = NULL;
+
+  _generation++;
+}
+
+void BlockCache::collect() {
+  for (auto it = _dropped.begin(); it != _dropped.end(); it++)
+    delete *it;
+  _dropped.clear();
+}
+
+// Statistics
+uint32_t BlockCache::getGeneration() const {
+  return _generation;
+}
+
+uint32_t BlockCache::getBlockCount() const {
+  return _blocks.size();
+}
+
+uint64_t BlockCache::getReturnHits() const {
+  return _rashits;
+}
+
+uint64_t BlockCache::getReturnMisses() const {
+  return _rasmisses;
+}
+
@@ -0,0 +1,200 @@
+/*
+ * blockcache.h -- defines the BasicBlock structure and the BlockCache class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "decodedinstruction.h"
+
+// Handler of the pseudo-instruction that ends the code of every block
+#define DI_BLOCKEXIT      DI_COUNT
+// Handler of the pseudo-instruction that runs a native segment (see NativeSegment)
+#define DI_NATIVE         (DI_COUNT + 1)
+
+// Maximum number of instructions of a block
+#define BC_MAX_LENGTH     64
+// Size of the return address stack
+#define BC_RAS_SIZE       16
+// Number of entries of the indirect branch target cache (must be a power of 2)
+#define BC_TARGETS        64
+// Size of the pages used for tracking which part of the memory holds translated code
+#define BC_PAGE_BITS      12
+
+/**
+ * A run of instructions of a block which has been compiled into host code (see JitCompiler).
+ * In the code of the block, its first instruction is replaced with a DI_NATIVE pseudo-instruction
+ * whose imm field is the index of the segment.
+ */
+struct NativeSegment {
+  uint32_t (*entry)(void* context);   //!< Host code; returns the number of instructions executed
+  uint32_t length;                    //!< Number of instructions
+  uint32_t live;                      //!< Registers read or written by the segment (bit n for register n)
+  uint32_t defined;                   //!< Registers written by the segment
+};
+
+/**
+ * A basic block is a sequence of instructions that are always executed in a row : it starts at a
+ * given address and ends with a control transfer instruction (Bicc, CALL or JMPL), or just before
+ * an instruction that cannot be part of a block.
+ *
+ * The code of the block holds the decoded instructions, then (if the block ends with a branch) a
+ * copy of the delay slot, then a DI_BLOCKEXIT pseudo-instruction.
+ *
+ * Blocks are chained : once the successor of a block has been found, it is remembered in the block
+ * itself so that the next transfer does not need any lookup.
+ */
+struct BasicBlock {
+  uint32_t address;                       //!< Address of the first instruction
+  uint32_t length;                        //!< Number of instructions, terminator included, delay slot excluded
+  bool hasdelay;                          //!< The code holds a copy of the delay slot of the terminating branch
+  std::vector<DecodedInstruction> code;   //!< Decoded instructions
+  BasicBlock* taken;                      //!< Block executed when the terminator transfers control (or NULL if not known yet)
+  BasicBlock* fallthrough;                //!< Block at address + 4 * length (or NULL if not known yet)
+  uint64_t count;                         //!< Number of executions of the block
+  std::vector<NativeSegment> native;      //!< Compiled parts of the block
+
+  /**
+   * Constructor
+   * @param addr address of the block
+   */
+  BasicBlock(uint32_t addr);
+
+  /**
+   * Address of the first instruction after the block (the delay slot for a branch)
+   * @returns the address
+   */
+  uint32_t end() const;
+};
+
+/**
+ * The BlockCache stores the basic blocks translated by an engine, keyed by their first address.
+ *
+ * Besides the blocks themselves, it gives two helpers for indirect branches (JMPL), whose target
+ * is only known at run time :
+ * - a return address stack : CALL pushes the address it will come back to, a returning JMPL pops
+ *   it and, if the prediction is right, gets the block without looking for it
+ * - a small direct-mapped target cache, tried before the main table
+ *
+ * When the memory holding a block is modified, every block is dropped (see invalidate()). As the
+ * engine may still be executing one of them, dropped blocks are only freed by collect(), which must
+ * be called when no block is in use. The generation number changes on each flush, so that pointers
+ * to blocks kept by the engine can be checked.
+ */
+class BlockCache {
+	public:
+    /**
+     * Constructor
+     */
+		BlockCache();
+    /**
+     * Destructor
+     */
+		~BlockCache();
+
+    /**
+     * Look for a block
+     * @param address address of the first instruction of the block
+     * @returns the block, or NULL if there is none
+     */
+    BasicBlock* lookup(uint32_t address);
+    /**
+     * Add a block to the cache; the cache now owns the block
+     * @param block the block
+     * @returns the block
+     */
+    BasicBlock* insert(BasicBlock* block);
+
+    /**
+     * Look for the block at the target of an indirect branch
+     * @param address target of the branch
+     * @returns the block, or NULL if there is none
+     */
+    BasicBlock* lookupTarget(uint32_t address);
+    /**
+     * Push a return address on the return address stack
+     * @param address address where the call will return
+     * @param block block at this address, if it is known (else NULL)
+     */
+    void pushReturn(uint32_t address, BasicBlock* block);
+    /**
+     * Pop the return address stack
+     * @param address actual target of the returning instruction
+     * @returns the block at this address if the prediction was right and the block is known, else NULL
+     */
+    BasicBlock* popReturn(uint32_t address);
+
+    /**
+     * Tell the cache that a range of memory has been modified; if a block overlaps it, the cache
+     * is flushed
+     * @param address beginning of the range
+     * @param size size of the range
+     * @returns true if the cache has been flushed
+     */
+    bool invalidate(uint32_t address, uint32_t size);
+    /**
+     * Drop every block
+     */
+    void flush();
+    /**
+     * Free the dropped blocks. No dropped block must be in use.
+     */
+    void collect();
+
+    /**
+     * Get the generation number, which changes each time the cache is flushed
+     * @returns the generation
+     */
+    uint32_t getGeneration() const;
+    /**
+     * Get the number of blocks in the cache
+     * @returns number of blocks
+     */
+    uint32_t getBlockCount() const;
+    /**
+     * Number of returns correctly predicted by the return address stack
+     * @returns hit count
+     */
+    uint64_t getReturnHits() const;
+    /**
+     * Number of returns that were not predicted by the return address stack
+     * @returns miss count
+     */
+    uint64_t getReturnMisses() const;
+
+	private:
+    /**
+     * An entry of the return address stack or of the target cache
+     */
+    struct Target {
+      uint32_t address;
+      BasicBlock* block;
+    };
+
+    /**
+     * Tells if one of the blocks of a page overlaps a range
+     * @param blocks the blocks of the page
+     * @param address beginning of the range
+     * @param last last byte of the range
+     * @returns true if a block overlaps it
+     */
+    static bool overlaps(const std::vector<BasicBlock*>& blocks, uint32_t address, uint32_t last);
+
+    std::unordered_map<uint32_t, BasicBlock*> _blocks;
+    std::unordered_map<uint32_t, std::vector<BasicBlock*> > _pages;
+    std::vector<BasicBlock*> _dropped;
+    uint32_t _low, _high;     // range covered by the blocks
+    Target _ras[BC_RAS_SIZE];
+    uint32_t _rastop, _rasdepth;
+    Target _targets[BC_TARGETS];
+    uint32_t _generation;
+    uint64_t _rashits, _rasmisses;
+};
+
+#endif // BLOCKCACHE_H
+
@@ -0,0 +1,89 @@
+/*
+ * decodecache.cpp -- implementation of the DecodeCache class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "decodecache.h"
+
+// Cstr
+DecodeCache::DecodeCache(uint32_t size) {
+  // Keep only the highest bit so the size is a power of 2
+  uint32_t n = 1;
+  while (size > 1 && n <= size / 2)
+    n <<= 1;
+
+  _entries = new Entry[n];
+  _mask = n - 1;
+  clear();
+}
+
+// Dstr
+DecodeCache::~DecodeCache() {
+  delete[] _entries;
+}
+
+// Size accessor
+uint32_t DecodeCache::getSize() const {
+  return _mask + 1;
+}
+
+// Lookup
+const DecodedInstruction* DecodeCache::lookup(uint32_t address) {
+  Entry& e = _entries[(address >> 2) & _mask];
+  if (e.valid && e.address == address) {
+    _hits++;
+    return &e.di;
+  }
+  _misses++;
+  return NULL;
+}
+
+// Insertion
+const DecodedInstruction* DecodeCache::insert(uint32_t address, const DecodedInstruction& di) {
+  Entry& e = _entries[(address >> 2) & _mask];
+  e.address = address;
+  e.valid = true;
+  e.di = di;
+  return &e.di;
+}
+
+// Invalidation of a range
+void DecodeCache::invalidate(uint32_t address, uint32_t size) {
+  // An instruction starting up to 3 bytes before the range still overlaps it
+  uint32_t first = address & 0xFFFFFFFC;
+  uint64_t count = ((uint64_t)(address - first) + size + 3) >> 2;
+
+  // Past the size of the cache, every entry is concerned anyway
+  if (count > _mask) {
+    for (uint32_t k = 0; k <= _mask; k++) {
+      if (_entries[k].valid && (uint64_t)(_entries[k].address - first) < count * 4)
+        _entries[k].valid = false;
+    }
+    return;
+  }
+
+  for (uint32_t k = 0; k < count; k++) {
+    Entry& e = _entries[((first >> 2) + k) & _mask];
+    if (e.valid && (uint64_t)(e.address - first) < count * 4)
+      e.valid = false;
+  }
+}
+
+// Clear the cache
+void DecodeCache::clear() {
+  for (uint32_t k = 0; k <= _mask; k++)
+    _entries[k].valid = false;
+  _hits = 0;
+  _misses = 0;
+}
+
+// Statistics
+uint64_t DecodeCache::getHits() const {
+  return _hits;
+}
+
+uint64_t DecodeCache::getMisses() const {
+  return _misses;
+}
+
@@ -0,0 +1,98 @@
+/*
+ * decodecache.h -- defines the DecodeCache class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef DECODECACHE_H
+#define DECODECACHE_H
+
+#include <stdint.h>
+#include "decodedinstruction.h"
+
+// Default number of entries of the cache (must be a power of 2)
+#define DC_DEFAULT_SIZE 4096
+
+/**
+ * The DecodeCache stores decoded instructions, keyed by their address.
+ *
+ * This is a direct-mapped cache : the entry of an instruction is given by the low bits of its
+ * word address, so a lookup costs a mask and a comparison. Two instructions mapping to the same
+ * entry just evict each other.
+ *
+ * The cache knows nothing about the memory : whoever modifies the memory (stores, FLUSH, loaders...)
+ * must call invalidate() on the modified range, or clear() the whole cache.
+ *
+ * @see DecodedInstruction
+ */
+class DecodeCache {
+	public:
+    /**
+     * Constructor
+     * @param size number of entries (rounded down to a power of 2)
+     */
+		DecodeCache(uint32_t size = DC_DEFAULT_SIZE);
+    /**
+     * Destructor
+     */
+		~DecodeCache();
+
+    /**
+     * Get the number of entries of the cache
+     * @returns number of entries
+     */
+    uint32_t getSize() const;
+
+    /**
+     * Look for the decoded instruction at a given address
+     * @param address address of the instruction
+     * @returns the decoded instruction, or NULL if it is not in the cache
+     */
+    const DecodedInstruction* lookup(uint32_t address);
+    /**
+     * Put a decoded instruction in the cache, evicting the previous one at the same entry
+     * @param address address of the instruction
+     * @param di the decoded instruction
+     * @returns the cached copy of the instruction
+     */
+    const DecodedInstruction* insert(uint32_t address, const DecodedInstruction& di);
+
+    /**
+     * Invalidate every cached instruction overlapping a memory range
+     * @param address beginning of the range
+     * @param size size of the range in bytes
+     */
+    void invalidate(uint32_t address, uint32_t size);
+    /**
+     * Invalidate every entry of the cache
+     */
+    void clear();
+
+    /**
+     * Number of successful lookups since the last clear()
+     * @returns hit count
+     */
+    uint64_t getHits() const;
+    /**
+     * Number of failed lookups since the last clear()
+     * @returns miss count
+     */
+    uint64_t getMisses() const;
+
+	private:
+    /**
+     * An entry of the cache
+     */
+    struct Entry {
+      uint32_t address;       //!< Address of the cached instruction
+      bool valid;             //!< Is the entry used ?
+      DecodedInstruction di;  //!< The instruction itself
+    };
+
+    Entry* _entries;
+    uint32_t _mask;
+    uint64_t _hits, _misses;
+};
+
+#endif // DECODECACHE_H
+
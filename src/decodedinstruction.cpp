@@ -0,0 +1,141 @@
+/*
+ * decodedinstruction.cpp -- implementation of the DecodedInstruction structure
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "decodedinstruction.h"
+#include "abstractalu.h"
+
+// Cstr
+DecodedInstruction::DecodedInstruction() :
+  word(0), imm(0), handler(DI_HALT), op3(0), rd(0), rs1(0), rs2(0), cond(0), i(false), a(false) {
+}
+
+// Decode an instruction
+DecodedInstruction DecodedInstruction::decode(const Instruction& inst) {
+  DecodedInstruction di;
+  di.word = inst.getContent();
+
+  // The null word is the basic state of the memory : there is nothing to decode
+  if (di.word == 0x00000000)
+    return di;
+
+  uint32_t op = inst.getField(INST_OP);
+
+  if (op == INST_OP_BR) {
+    // Branches and SETHI
+    uint32_t op2 = inst.getField(INST_OP2);
+    di.rd = inst.getField(INST_RD);
+    di.cond = inst.getField(INST_COND);
+    di.a = inst.getField(INST_A) == 1;
+
+    if (op2 == INST_OP2_SETHI) {
+      di.handler = DI_SETHI;
+      di.imm = inst.getField(INST_IMM22) << 10;
+    } else {
+      di.imm = signext(inst.getField(INST_DISP22), 22) << 2;
+      if (op2 == INST_OP2_BICC)
+        di.handler = DI_BICC;
+      else if (op2 == INST_OP2_FBFCC)
+        di.handler = DI_FBFCC;
+      else if (op2 == INST_OP2_CBCCC)
+        di.handler = DI_CBCCC;
+      else
+        di.handler = DI_UNKNOWN;
+    }
+  } else if (op == INST_OP_CALL) {
+    di.handler = DI_CALL;
+    di.imm = inst.getField(INST_DISP30) << 2;
+  } else {
+    // Format 3 : every field has the same place
+    di.op3 = inst.getField(INST_OP3);
+    di.rd = inst.getField(INST_RD);
+    di.rs1 = inst.getField(INST_RS1);
+    di.rs2 = inst.getField(INST_RS2);
+    di.i = inst.getField(INST_I) == 1;
+    di.imm = signext(inst.getField(INST_SIMM13), 13);
+    di.cond = inst.getField(INST_COND);
+
+    if (op == INST_OP_OTHER) {
+      switch (di.op3) {
+        case INST_OP3_RDY:    di.handler = DI_RDY;     break;
+        case INST_OP3_RDPSR:  di.handler = DI_RDPSR;   break;
+        case INST_OP3_RDWIM:  di.handler = DI_RDWIM;   break;
+        case INST_OP3_RDTBR:  di.handler = DI_RDTBR;   break;
+        case INST_OP3_WRY:    di.handler = DI_WRY;     break;
+        case INST_OP3_WRPSR:  di.handler = DI_WRPSR;   break;
+        case INST_OP3_WRWIM:  di.handler = DI_WRWIM;   break;
+        case INST_OP3_WRTBR:  di.handler = DI_WRTBR;   break;
+        case INST_OP3_FPOP1:
+        case INST_OP3_FPOP2:  di.handler = DI_FPOP;    break;
+        case INST_OP3_CPOP1:
+        case INST_OP3_CPOP2:  di.handler = DI_CPOP;    break;
+        case INST_OP3_JMPL:   di.handler = DI_JMPL;    break;
+        case INST_OP3_RETT:   di.handler = DI_RETT;    break;
+        case INST_OP3_TICC:   di.handler = DI_TICC;    break;
+        case INST_OP3_FLUSH:  di.handler = DI_FLUSH;   break;
+        case INST_OP3_SAVE:   di.handler = DI_SAVE;    break;
+        case INST_OP3_REST:   di.handler = DI_RESTORE; break;
+        // the operations of the ALU; the others (tagged, MULScc...) are not implemented
+        case ALU_OP_ADD:    case ALU_OP_AND:    case ALU_OP_OR:     case ALU_OP_XOR:    case ALU_OP_SUB:
+        case ALU_OP_ANDN:   case ALU_OP_ORN:    case ALU_OP_XNOR:   case ALU_OP_ADDX:   case ALU_OP_UMUL:
+        case ALU_OP_SMUL:   case ALU_OP_SUBX:   case ALU_OP_UDIV:   case ALU_OP_SDIV:   case ALU_OP_ADDcc:
+        case ALU_OP_ANDcc:  case ALU_OP_ORcc:   case ALU_OP_XORcc:  case ALU_OP_SUBcc:  case ALU_OP_ANDNcc:
+        case ALU_OP_ORNcc:  case ALU_OP_XNORcc: case ALU_OP_ADDXcc: case ALU_OP_UMULcc: case ALU_OP_SMULcc:
+        case ALU_OP_SUBXcc: case ALU_OP_UDIVcc: case ALU_OP_SDIVcc: case ALU_OP_SLL:    case ALU_OP_SRL:
+        case ALU_OP_SRA:
+                              di.handler = DI_ALU;     break;
+        default:              di.handler = DI_UNKNOWN;
+      }
+      if (di.handler == DI_FPOP)
+        di.imm = inst.getField(INST_OPF);
+    } else {
+      // alternate accesses are decoded as the normal ones, then marked
+      bool alternate = (di.op3 & 0x30) == INST_OP3_ALTERNATE;
+      switch (alternate ? di.op3 & ~INST_OP3_ALTERNATE : di.op3) {
+        case INST_OP3_LDSB:   di.handler = DI_LDSB;    break;
+        case INST_OP3_LDSH:   di.handler = DI_LDSH;    break;
+        case INST_OP3_LDUB:   di.handler = DI_LDUB;    break;
+        case INST_OP3_LDUH:   di.handler = DI_LDUH;    break;
+        case INST_OP3_LD:     di.handler = DI_LD;      break;
+        case INST_OP3_LDD:    di.handler = DI_LDD;     break;
+        case INST_OP3_STB:    di.handler = DI_STB;     break;
+        case INST_OP3_STH:    di.handler = DI_STH;     break;
+        case INST_OP3_ST:     di.handler = DI_ST;      break;
+        case INST_OP3_STD:    di.handler = DI_STD;     break;
+        case INST_OP3_LDF:    di.handler = DI_LDF;     break;
+        case INST_OP3_LDDF:   di.handler = DI_LDDF;    break;
+        case INST_OP3_LDFSR:  di.handler = DI_LDFSR;   break;
+        case INST_OP3_STF:    di.handler = DI_STF;     break;
+        case INST_OP3_STDF:   di.handler = DI_STDF;    break;
+        case INST_OP3_STFSR:  di.handler = DI_STFSR;   break;
+        default:              di.handler = DI_UNKNOWN;
+      }
+      if (alternate && di.handler != DI_UNKNOWN) {
+        di.op3 = di.handler;
+        di.handler = DI_ALTERNATE;
+        di.imm = inst.getField(INST_ASI);
+      }
+    }
+  }
+
+  return di;
+}
+
+// Is it a control transfer ?
+bool DecodedInstruction::isControlTransfer() const {
+  switch (handler) {
+    case DI_BICC:
+    case DI_FBFCC:
+    case DI_CBCCC:
+    case DI_CALL:
+    case DI_JMPL:
+    case DI_RETT:
+    case DI_TICC:
+      return true;
+    default:
+      return false;
+  }
+}
+
@@ -0,0 +1,101 @@
+/*
+ * decodedinstruction.h -- defines the DecodedInstruction structure
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef DECODEDINSTRUCTION_H
+#define DECODEDINSTRUCTION_H
+
+#include <stdint.h>
+#include "instruction.h"
+
+// Handler identifiers : what the engine has to do with a decoded instruction
+#define DI_HALT       0x00  // null word, basic state of the memory (engine stays in place)
+#define DI_UNKNOWN    0x01  // unknown or unimplemented instruction (illegal_instruction)
+#define DI_SETHI      0x02  // set high
+#define DI_BICC       0x03  // branch on integer condition codes
+#define DI_FBFCC      0x04  // branch on FPU condition codes
+#define DI_CBCCC      0x05  // branch on coprocessor condition codes
+#define DI_CALL       0x06  // call
+#define DI_RDY        0x07  // read special registers
+#define DI_RDPSR      0x08
+#define DI_RDWIM      0x09
+#define DI_RDTBR      0x0A
+#define DI_WRY        0x0B  // write special registers
+#define DI_WRPSR      0x0C
+#define DI_WRWIM      0x0D
+#define DI_WRTBR      0x0E
+#define DI_FPOP       0x0F  // FPU operation
+#define DI_CPOP       0x10  // coprocessor operation
+#define DI_JMPL       0x11  // jump and link
+#define DI_RETT       0x12  // return from trap
+#define DI_TICC       0x13  // trap on integer condition codes
+#define DI_FLUSH      0x14  // flush instruction memory
+#define DI_SAVE       0x15  // save context
+#define DI_RESTORE    0x16  // restore context
+#define DI_ALU        0x17  // arithmetic and logic (op3 is the ALU_OP_*)
+#define DI_LDSB       0x18  // loads
+#define DI_LDSH       0x19
+#define DI_LDUB       0x1A
+#define DI_LDUH       0x1B
+#define DI_LD         0x1C
+#define DI_LDD        0x1D
+#define DI_STB        0x1E  // stores
+#define DI_STH        0x1F
+#define DI_ST         0x20
+#define DI_STD        0x21
+#define DI_ALTERNATE  0x22  // loads and stores in an alternate space (op3 is the DI_* of the access, imm the ASI)
+#define DI_IFAULT     0x23  // the instruction could not be fetched (instruction access exception; made by the engine)
+#define DI_LDF        0x24  // floating-point loads (rd is an f register)
+#define DI_LDDF       0x25
+#define DI_LDFSR      0x26
+#define DI_STF        0x27  // floating-point stores
+#define DI_STDF       0x28
+#define DI_STFSR      0x29
+#define DI_COUNT      0x2A  // number of handlers
+
+/**
+ * A DecodedInstruction is an instruction whose fields have been extracted once and for all.
+ *
+ * Decoding an instruction with Instruction::getField() is cheap, but doing it several times per
+ * executed instruction (and again each time a loop comes back to the same address) is not.
+ * A DecodedInstruction keeps every operand an engine may need, already shifted, sign-extended and
+ * checked, plus a handler identifier (DI_*) that tells the engine which operation to execute
+ * without walking the op/op2/op3 tree again.
+ *
+ * @see DecodeCache
+ */
+struct DecodedInstruction {
+  uint32_t word;    //!< Raw instruction
+  uint32_t imm;     //!< Sign-extended simm13, shifted imm22 (SETHI), byte displacement (branches, call), ASI or opf (FPop)
+  uint8_t handler;  //!< What to do (DI_*)
+  uint8_t op3;      //!< Operation for format 3 instructions (ALU_OP_* for DI_ALU, DI_* of the access for DI_ALTERNATE)
+  uint8_t rd;       //!< Destination register
+  uint8_t rs1;      //!< Source register 1
+  uint8_t rs2;      //!< Source register 2 (only meaningful if i is false)
+  uint8_t cond;     //!< Branch/trap condition
+  bool i;           //!< Use imm instead of rs2 as second operand
+  bool a;           //!< Annulment bit of branches
+
+  /**
+   * Default constructor : builds a DI_HALT instruction
+   */
+  DecodedInstruction();
+
+  /**
+   * Decode an instruction
+   * @param inst instruction to decode
+   * @returns the decoded instruction
+   */
+  static DecodedInstruction decode(const Instruction& inst);
+
+  /**
+   * Determines if the instruction may change the control flow (branches, call, jmpl, rett, ticc)
+   * @returns true if the instruction is a control transfer instruction
+   */
+  bool isControlTransfer() const;
+};
+
+#endif // DECODEDINSTRUCTION_H
+
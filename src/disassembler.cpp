@@ -71,12 +71,9 @@ string cbranchname[] = {
 
 string meminstname[] = {
   "ld", "ldub", "lduh", "ldd", "st", "stb", "sth", "std", "", "ldsb", "ldsh", "", "", "", "", "", // 0x0B -> 0x0F
-  "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", // 0x10 -> 0x1F
-  "ldf", "ldfsr", "", "lddf", "", "", "", "", "", "", "", "", "", "", "", "",
-  "ldc", "ldcsr", "", "lddc", "", "", "", "", "", "", "", "", "", "", "", "",
-  "", "", "", "", "stf", "stfsr", "", "stdf", "", "", "", "", "", "", "", "",
-  "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "",
-  "", "", "", "", "stc", "stcsr", "", "stdc", "", "", "", "", "", "", "", ""
+  "lda", "lduba", "lduha", "ldda", "sta", "stba", "stha", "stda", "", "ldsba", "ldsha", "", "", "", "", "", // 0x10 -> 0x1F
+  "ldf", "ldfsr", "", "lddf", "stf", "stfsr", "", "stdf", "", "", "", "", "", "", "", "", // 0x20 -> 0x2F
+  "ldc", "ldcsr", "", "lddc", "stc", "stcsr", "", "stdc", "", "", "", "", "", "", "", ""  // 0x30 -> 0x3F
     // nothing beyond
 };
 
@@ -266,8 +263,13 @@ string disassemble(Instruction inst, uint32_t addr) {
     } else {
       res << "+" << registerName(rs2);
     }
+    res << "]";
+
+    // alternate space
+    if ((op3 & 0x30) == INST_OP3_ALTERNATE)
+      res << " 0x" << hex << setfill('0') << setw(2) << inst.getField(INST_ASI);
 
-    res << "], " << registerName(rd);
+    res << ", " << registerName(rd);
   }
 
   return res.str();
@@ -0,0 +1,144 @@
+/*
+ * dmadevice.cpp -- implement the DmaDevice class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "dmadevice.h"
+
+// Cstr
+DmaDevice::DmaDevice(AbstractMemory* memory) :
+    AbstractMemory(DMA_REG_SIZE), _memory(memory), _source(0), _dest(0), _length(0), _pattern(0),
+    _command(DMA_CMD_NONE), _status(0), _faultaddress(0), _transfers(0), _bytes(0) {
+  setTLB(false); // registers, not memory
+}
+
+// Dstr
+DmaDevice::~DmaDevice() {
+}
+
+// Counters
+uint64_t DmaDevice::getTransfers() const {
+  return _transfers;
+}
+
+uint64_t DmaDevice::getBytes() const {
+  return _bytes;
+}
+
+// Registers
+uint32_t DmaDevice::readRegister(uint32_t reg) const {
+  uint32_t value = 0;
+  switch (reg & DMA_REG_MASK) {
+    case DMA_REG_SOURCE:  value = _source;       break;
+    case DMA_REG_DEST:    value = _dest;         break;
+    case DMA_REG_LENGTH:  value = _length;       break;
+    case DMA_REG_PATTERN: value = _pattern;      break;
+    case DMA_REG_COMMAND: value = _command;      break;
+    case DMA_REG_STATUS:  value = _status;       break;
+    case DMA_REG_FAULT:   value = _faultaddress; break;
+  }
+  return value;
+}
+
+void DmaDevice::writeRegister(uint32_t reg, uint32_t value) {
+  switch (reg & DMA_REG_MASK) {
+    case DMA_REG_SOURCE:  _source = value;         break;
+    case DMA_REG_DEST:    _dest = value;           break;
+    case DMA_REG_LENGTH:  _length = value;         break;
+    case DMA_REG_PATTERN: _pattern = value & 0xFF; break;
+    case DMA_REG_COMMAND: start(value);            break;
+  }
+}
+
+// A word is read once, whatever the size of the access
+void DmaDevice::read(uint32_t address, uint32_t size, uint8_t* data) const {
+  uint32_t word = 0, current = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    uint32_t a = address + i;
+    if (i == 0 || (a & ~3) != current) {
+      current = a & ~3;
+      word = readRegister(current);
+    }
+    data[i] = (uint8_t)(word >> (8 * (3 - (a & 3))));
+  }
+}
+
+// Only whole words are written
+void DmaDevice::write(uint32_t address, uint8_t* data, uint32_t size) {
+  for (uint32_t i = (4 - (address & 3)) & 3; i + 4 <= size; i += 4) {
+    uint32_t value = ((uint32_t)data[i] << 24) | ((uint32_t)data[i+1] << 16) | ((uint32_t)data[i+2] << 8) | data[i+3];
+    writeRegister(address + i, value);
+  }
+}
+
+// Transfers
+void DmaDevice::start(uint32_t command) {
+  _command = command;
+  _status = 0;
+  bool done;
+  switch (command) {
+    case DMA_CMD_COPY:    done = runCopy();    break;
+    case DMA_CMD_FILL:    done = runFill();    break;
+    case DMA_CMD_COMPARE: done = runCompare(); break;
+    default:              done = false;        break;
+  }
+  _status |= DMA_STATUS_DONE | (done ? 0 : DMA_STATUS_ERROR);
+  _transfers++;
+}
+
+// A chunk at a time, from the end when the destination overlaps the end of the source
+bool DmaDevice::runCopy() {
+  uint8_t buffer[DMA_CHUNK_SIZE];
+  bool backward = (_dest > _source && _dest - _source < _length);
+  for (uint32_t done = 0; done < _length; ) {
+    uint32_t n = (_length - done < DMA_CHUNK_SIZE ? _length - done : DMA_CHUNK_SIZE);
+    uint32_t offset = (backward ? _length - done - n : done);
+    _memory->copyOut(_source + offset, buffer, n);
+    if (faulted())
+      return false;
+    _memory->copyIn(_dest + offset, buffer, n);
+    if (faulted())
+      return false;
+    done += n;
+    _bytes += n;
+  }
+  return true;
+}
+
+bool DmaDevice::runFill() {
+  _memory->fill(_dest, (uint8_t)_pattern, _length);
+  if (faulted())
+    return false;
+  _bytes += _length;
+  return true;
+}
+
+bool DmaDevice::runCompare() {
+  uint8_t buffer[DMA_CHUNK_SIZE];
+  for (uint32_t done = 0; done < _length; ) {
+    uint32_t n = (_length - done < DMA_CHUNK_SIZE ? _length - done : DMA_CHUNK_SIZE);
+    _memory->copyOut(_source + done, buffer, n);
+    if (faulted())
+      return false;
+    int diff = _memory->compare(_dest + done, buffer, n);
+    if (faulted())
+      return false;
+    _bytes += n;
+    if (diff != 0) {
+      _status |= DMA_STATUS_DIFFERENT;
+      break;
+    }
+    done += n;
+  }
+  return true;
+}
+
+// The fault is the device's, not the one of the store that has started the transfer
+bool DmaDevice::faulted() {
+  if (!_memory->hasFault())
+    return false;
+  _faultaddress = _memory->getFaultAddress();
+  _memory->clearFault();
+  return true;
+}
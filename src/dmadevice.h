@@ -0,0 +1,141 @@
+/*
+ * dmadevice.h -- a DMA engine moving blocks of a memory device
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef DMADEVICE_H
+#define DMADEVICE_H
+
+#include "abstractmemory.h"
+
+// Address space of the device in ksparc-run (see SparcEngine::setAddressSpace())
+#define DMA_ASI               0x21
+
+// Registers (words)
+#define DMA_REG_SOURCE        0x00
+#define DMA_REG_DEST          0x04
+#define DMA_REG_LENGTH        0x08  // in bytes
+#define DMA_REG_PATTERN       0x0C  // byte of the fills (low byte)
+#define DMA_REG_COMMAND       0x10  // a write starts the transfer, a read gives the last command
+#define DMA_REG_STATUS        0x14
+#define DMA_REG_FAULT         0x18  // address of the access that has faulted
+#define DMA_REG_MASK          0x1C
+#define DMA_REG_SIZE          0x20
+
+// Commands
+#define DMA_CMD_NONE          0
+#define DMA_CMD_COPY          1  // length bytes from source to destination (they may overlap)
+#define DMA_CMD_FILL          2  // length bytes of the pattern at destination
+#define DMA_CMD_COMPARE       3  // length bytes at source and destination
+
+// Status
+#define DMA_STATUS_DONE       0x00000001
+#define DMA_STATUS_ERROR      0x00000002  // unknown command, or an access has faulted (the transfer stops there)
+#define DMA_STATUS_DIFFERENT  0x00000004  // the blocks compared are not equal
+
+// Blocks are copied through a buffer of this size
+#define DMA_CHUNK_SIZE        4096
+
+/**
+ * This device is a DMA engine : the program writes the source, destination and length registers, then a command,
+ * and the device moves the block in the memory with the block transfers of the memory (see
+ * AbstractMemory::copyIn()), at the speed of the host. The transfer is over when the store of the command is :
+ * the status register tells if it has succeeded.
+ *
+ * The registers are an address space of their own, to route from an ASI of the alternate loads and stores
+ * (whole words only). The device works on the memory it is given : given the MMU, it takes the addresses of the
+ * program and its stores are seen by the engine (see AbstractMemory::FetchListener); given the memory behind it,
+ * physical addresses, and the engine does not see the instructions it overwrites.
+ * An access of the transfer that faults stops it : the fault is cleared in the memory (the store of the command
+ * does not trap) and reported in the status and fault registers.
+ */
+class DmaDevice : public AbstractMemory {
+	public:
+    /**
+     * Constructor
+     * @param memory the memory the blocks are moved in
+     */
+		DmaDevice(AbstractMemory* memory);
+    /**
+     * Destructor
+     */
+		~DmaDevice();
+
+    /**
+     * Read the registers
+     * @see AbstractMemory::read()
+     */
+    void read(uint32_t address, uint32_t size, uint8_t* data) const;
+    /**
+     * Write the registers (a whole word at a time)
+     * @see AbstractMemory::write()
+     */
+    void write(uint32_t address, uint8_t* data, uint32_t size);
+
+    /**
+     * Run a command on the registers, as a store of the command register does
+     * @param command DMA_CMD_*
+     */
+    void start(uint32_t command);
+
+    /**
+     * Number of transfers made
+     * @returns the count
+     */
+    uint64_t getTransfers() const;
+    /**
+     * Number of bytes moved (or filled, or compared)
+     * @returns the count
+     */
+    uint64_t getBytes() const;
+
+	private:
+    /**
+     * Read a register
+     * @param reg DMA_REG_*
+     * @returns its value
+     */
+    uint32_t readRegister(uint32_t reg) const;
+    /**
+     * Write a register
+     * @param reg DMA_REG_*
+     * @param value its value
+     */
+    void writeRegister(uint32_t reg, uint32_t value);
+
+    /**
+     * The commands
+     * @returns false if an access has faulted
+     */
+    bool runCopy();
+    bool runFill();
+    bool runCompare();
+    /**
+     * Take the fault of the memory, if there is one
+     * @returns true if an access has faulted
+     */
+    bool faulted();
+
+    /**
+     * The memory
+     */
+    AbstractMemory* _memory;
+    /**
+     * The registers
+     */
+    uint32_t _source;
+    uint32_t _dest;
+    uint32_t _length;
+    uint32_t _pattern;
+    uint32_t _command;
+    uint32_t _status;
+    uint32_t _faultaddress;
+    /**
+     * Counters
+     */
+    uint64_t _transfers;
+    uint64_t _bytes;
+};
+
+#endif // DMADEVICE_H
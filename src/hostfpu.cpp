@@ -0,0 +1,192 @@
+/*
+ * hostfpu.cpp -- implement the HostFPU class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "hostfpu.h"
+
+#include <cfenv>
+#include <cmath>
+#include <cstring>
+
+// Kind of the result of an operation
+#define HFPU_SINGLE   0
+#define HFPU_DOUBLE   1
+#define HFPU_INTEGER  2
+
+// Rounding directions of the host, by FPU_ROUND
+static const int HFPU_ROUNDINGS[4] = { FE_TONEAREST, FE_TOWARDZERO, FE_UPWARD, FE_DOWNWARD };
+
+// Cstr
+HostFPU::HostFPU(SpecialRegister* fsr) : AbstractFPU(fsr), _operations(0) {
+}
+
+// Dstr
+HostFPU::~HostFPU() {
+}
+
+// Counter
+uint64_t HostFPU::getOperations() const {
+  return _operations;
+}
+
+// Registers as host numbers
+float HostFPU::getSingle(uint32_t nb) const {
+  uint32_t bits = read(nb);
+  float value;
+  std::memcpy(&value, &bits, 4);
+  return value;
+}
+
+double HostFPU::getDouble(uint32_t nb) const {
+  uint64_t bits = readDouble(nb);
+  double value;
+  std::memcpy(&value, &bits, 8);
+  return value;
+}
+
+void HostFPU::setSingle(uint32_t nb, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, 4);
+  write(nb, bits);
+}
+
+void HostFPU::setDouble(uint32_t nb, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, 8);
+  writeDouble(nb, bits);
+}
+
+// Operations
+uint32_t HostFPU::execute(uint32_t opf, uint32_t rs1, uint32_t rs2, uint32_t rd) {
+  if (!isAligned(opf, rs1, rs2, rd))
+    return fail(FPU_FTT_INVALID_REGISTER);
+  _operations++;
+
+  // Moves and compares do not round
+  switch (opf) {
+    case FPU_OP_FMOVS:
+    case FPU_OP_FNEGS:
+    case FPU_OP_FABSS: {
+        uint32_t bits = read(rs2);
+        complete(0);
+        write(rd, opf == FPU_OP_FMOVS ? bits : opf == FPU_OP_FNEGS ? bits ^ 0x80000000 : bits & 0x7FFFFFFF);
+      }
+      return FPU_FTT_NONE;
+    case FPU_OP_FCMPS:
+    case FPU_OP_FCMPD:
+    case FPU_OP_FCMPES:
+    case FPU_OP_FCMPED:
+      return compare(opf, rs1, rs2);
+  }
+
+  // The results are volatile, so that the operation is made between the two calls on the flags of the host
+  volatile float s = 0;
+  volatile double d = 0;
+  volatile int32_t i = 0;
+  uint32_t kind, exceptions = 0, rounding = getRounding();
+  if (rounding != FPU_ROUND_NEAREST)
+    std::fesetround(HFPU_ROUNDINGS[rounding]);
+  std::feclearexcept(FE_ALL_EXCEPT);
+  switch (opf) {
+    case FPU_OP_FSQRTS: s = std::sqrt(getSingle(rs2));                   kind = HFPU_SINGLE;  break;
+    case FPU_OP_FSQRTD: d = std::sqrt(getDouble(rs2));                   kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FADDS:  s = getSingle(rs1) + getSingle(rs2);             kind = HFPU_SINGLE;  break;
+    case FPU_OP_FADDD:  d = getDouble(rs1) + getDouble(rs2);             kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FSUBS:  s = getSingle(rs1) - getSingle(rs2);             kind = HFPU_SINGLE;  break;
+    case FPU_OP_FSUBD:  d = getDouble(rs1) - getDouble(rs2);             kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FMULS:  s = getSingle(rs1) * getSingle(rs2);             kind = HFPU_SINGLE;  break;
+    case FPU_OP_FMULD:  d = getDouble(rs1) * getDouble(rs2);             kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FDIVS:  s = getSingle(rs1) / getSingle(rs2);             kind = HFPU_SINGLE;  break;
+    case FPU_OP_FDIVD:  d = getDouble(rs1) / getDouble(rs2);             kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FSMULD: d = (double)getSingle(rs1) * getSingle(rs2);     kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FITOS:  s = (float)(int32_t)read(rs2);                   kind = HFPU_SINGLE;  break;
+    case FPU_OP_FITOD:  d = (double)(int32_t)read(rs2);                  kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FSTOD:  d = (double)getSingle(rs2);                      kind = HFPU_DOUBLE;  break;
+    case FPU_OP_FDTOS:  s = (float)getDouble(rs2);                       kind = HFPU_SINGLE;  break;
+    case FPU_OP_FSTOI:  i = truncate(getSingle(rs2), exceptions);        kind = HFPU_INTEGER; break;
+    case FPU_OP_FDTOI:  i = truncate(getDouble(rs2), exceptions);        kind = HFPU_INTEGER; break;
+    default:
+      // quad precision, or not an operation
+      if (rounding != FPU_ROUND_NEAREST)
+        std::fesetround(FE_TONEAREST);
+      return fail(FPU_FTT_UNIMPLEMENTED);
+  }
+  int flags = std::fetestexcept(FE_ALL_EXCEPT);
+  if (rounding != FPU_ROUND_NEAREST)
+    std::fesetround(FE_TONEAREST);
+
+  // The conversions to integers have made their exceptions themselves
+  if (kind != HFPU_INTEGER) {
+    exceptions |= ((flags & FE_INVALID) != 0 ? FPU_EXC_NV : 0) | ((flags & FE_OVERFLOW) != 0 ? FPU_EXC_OF : 0)
+                | ((flags & FE_UNDERFLOW) != 0 ? FPU_EXC_UF : 0) | ((flags & FE_DIVBYZERO) != 0 ? FPU_EXC_DZ : 0)
+                | ((flags & FE_INEXACT) != 0 ? FPU_EXC_NX : 0);
+  }
+  if (!complete(exceptions))
+    return FPU_FTT_IEEE_EXCEPTION;
+
+  bool invalid = (exceptions & FPU_EXC_NV) != 0;
+  switch (kind) {
+    case HFPU_SINGLE:
+      if (invalid && std::isnan(s))
+        write(rd, HFPU_SINGLE_NAN);
+      else
+        setSingle(rd, s);
+      break;
+    case HFPU_DOUBLE:
+      if (invalid && std::isnan(d))
+        writeDouble(rd, HFPU_DOUBLE_NAN);
+      else
+        setDouble(rd, d);
+      break;
+    default:
+      write(rd, (uint32_t)i);
+      break;
+  }
+  return FPU_FTT_NONE;
+}
+
+// Compares : the NaN are found before the host compares, as some of its compares are invalid on any NaN
+uint32_t HostFPU::compare(uint32_t opf, uint32_t rs1, uint32_t rs2) {
+  double a, b;
+  uint32_t quiet; // quiet bit of the NaN, in the most significant word
+  if (opf == FPU_OP_FCMPS || opf == FPU_OP_FCMPES) {
+    a = getSingle(rs1);
+    b = getSingle(rs2);
+    quiet = 0x00400000;
+  } else {
+    a = getDouble(rs1);
+    b = getDouble(rs2);
+    quiet = 0x00080000;
+  }
+  bool signaling = (std::isnan(a) && (read(rs1) & quiet) == 0) || (std::isnan(b) && (read(rs2) & quiet) == 0);
+
+  uint32_t fcc, exceptions = 0;
+  if (std::isnan(a) || std::isnan(b)) {
+    fcc = FPU_FCC_UNORDERED;
+    if (signaling || opf == FPU_OP_FCMPES || opf == FPU_OP_FCMPED)
+      exceptions = FPU_EXC_NV;
+  } else if (a == b) {
+    fcc = FPU_FCC_EQUAL;
+  } else {
+    fcc = (a < b ? FPU_FCC_LESS : FPU_FCC_GREATER);
+  }
+
+  if (!complete(exceptions))
+    return FPU_FTT_IEEE_EXCEPTION;
+  setFCC(fcc);
+  return FPU_FTT_NONE;
+}
+
+// Conversions to integers
+int32_t HostFPU::truncate(double value, uint32_t& exceptions) {
+  if (std::isnan(value) || value >= 2147483648.0 || value <= -2147483649.0) {
+    exceptions |= FPU_EXC_NV;
+    return (!std::isnan(value) && value < 0 ? (int32_t)0x80000000 : 0x7FFFFFFF);
+  }
+  int32_t i = (int32_t)value;
+  if ((double)i != value)
+    exceptions |= FPU_EXC_NX;
+  return i;
+}
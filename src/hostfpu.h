@@ -0,0 +1,83 @@
+/*
+ * hostfpu.h -- defines a floating-point unit computing with the arithmetic of the host
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef HOSTFPU_H
+#define HOSTFPU_H
+
+#include "abstractfpu.h"
+
+// Default NaN of SPARC, the result of an invalid operation
+#define HFPU_SINGLE_NAN     0x7FFFFFFF
+#define HFPU_DOUBLE_NAN     0x7FFFFFFFFFFFFFFFull
+
+/**
+ * The HostFPU makes the operations with the IEEE 754 arithmetic of the host : a FADDs is a float addition and a
+ * FSQRTd a sqrt() of a double, which the compiler makes single instructions of the host (SSE2 on x86-64). As
+ * SPARC and the host compute the same correctly rounded results, only the edges are made by hand :
+ * - the rounding direction of the FSR is given to the host for the operation (fesetround()), and the exceptions
+ *   it raises are read from its flags (fetestexcept()) into CEXC and AEXC
+ * - the compares and the conversions to integers (always rounded toward zero) do not depend on the host
+ * - an invalid operation gives the default NaN of SPARC, which is not the one of every host
+ * The quad precision operations are not implemented (unimplemented_FPop), nor the non-standard mode (FPU_NS).
+ */
+class HostFPU : public AbstractFPU {
+	public:
+    /**
+     * Constructor
+     * @param fsr the FPU state register
+     */
+		HostFPU(SpecialRegister* fsr);
+    /**
+     * Destructor
+     */
+		~HostFPU();
+
+    /**
+     * Make an operation
+     * @see AbstractFPU::execute()
+     */
+    uint32_t execute(uint32_t opf, uint32_t rs1, uint32_t rs2, uint32_t rd);
+
+    /**
+     * Number of operations made
+     * @returns the count
+     */
+    uint64_t getOperations() const;
+
+	private:
+    /**
+     * Registers as host numbers
+     * @param nb number of the register (the even one of a double)
+     */
+    float getSingle(uint32_t nb) const;
+    double getDouble(uint32_t nb) const;
+    void setSingle(uint32_t nb, float value);
+    void setDouble(uint32_t nb, double value);
+
+    /**
+     * Compare two registers, for FCMP and FCMPE
+     * @param opf the compare
+     * @param rs1 first register
+     * @param rs2 second register
+     * @returns FPU_FTT_NONE, or the trap type
+     */
+    uint32_t compare(uint32_t opf, uint32_t rs1, uint32_t rs2);
+    /**
+     * Convert a number to an integer, rounding toward zero; a NaN or a number out of range is an invalid
+     * operation, and gives the largest integer of its sign
+     * @param value the number
+     * @param exceptions where the exceptions are added
+     * @returns the integer
+     */
+    static int32_t truncate(double value, uint32_t& exceptions);
+
+    /**
+     * Counter
+     */
+    uint64_t _operations;
+};
+
+#endif // HOSTFPU_H
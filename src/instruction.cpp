@@ -77,7 +77,7 @@ Instruction Instruction::makeInstruction(uint32_t op, uint32_t rd, uint32_t op3,
     inst |= rs2OrSimm13 & 0x00001FFF;
   } else {
     inst |=
-      ((asi & 0x0000007F) << 5) |
+      ((asi & 0x000000FF) << 5) |
        (rs2OrSimm13 & 0x0000001F);
   }
 
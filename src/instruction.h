@@ -76,12 +76,24 @@
 #define INST_OP3_STH    0x06  // store halfword
 #define INST_OP3_ST     0x04  // store word
 #define INST_OP3_STD    0x07  // store double word
-#define INST_OP3_STF    0x44  // store simple-precision floating point
-#define INST_OP3_STDF   0x47  // store double-precision floating point
-#define INST_OP3_STFSR  0x45  // store fsr
-#define INST_OP3_STC    0x64  // store coproc register
-#define INST_OP3_STDC   0x67  // store coproc double register
-#define INST_OP3_STCSR  0x65  // store csr
+#define INST_OP3_STF    0x24  // store simple-precision floating point
+#define INST_OP3_STDF   0x27  // store double-precision floating point
+#define INST_OP3_STFSR  0x25  // store fsr
+#define INST_OP3_STC    0x34  // store coproc register
+#define INST_OP3_STDC   0x37  // store coproc double register
+#define INST_OP3_STCSR  0x35  // store csr
+// Alternate space versions (privileged, the ASI is in the instruction and i must be 0)
+#define INST_OP3_ALTERNATE 0x10  // the bit that makes an integer load or store an alternate one
+#define INST_OP3_LDSBA  0x19  // load signed byte from alternate space
+#define INST_OP3_LDSHA  0x1A  // load signed halfword from alternate space
+#define INST_OP3_LDUBA  0x11  // load unsigned byte from alternate space
+#define INST_OP3_LDUHA  0x12  // load unsigned halfword from alternate space
+#define INST_OP3_LDA    0x10  // load a word from alternate space
+#define INST_OP3_LDDA   0x13  // load a double word from alternate space
+#define INST_OP3_STBA   0x15  // store byte into alternate space
+#define INST_OP3_STHA   0x16  // store halfword into alternate space
+#define INST_OP3_STA    0x14  // store word into alternate space
+#define INST_OP3_STDA   0x17  // store double word into alternate space
 
 // Conditions code for branches
 #define INST_COND_ALWAYS  0x8   // always
@@ -0,0 +1,487 @@
+/*
+ * jitcompiler.cpp -- implement the JitCompiler class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "jitcompiler.h"
+#include "abstractalu.h"
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#ifdef JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Host registers
+#define RAX   0
+#define RCX   1
+#define RDX   2
+#define RBX   3
+#define RSI   6
+#define RDI   7
+#define R8    8
+#define R12   12
+
+// Maximal size of the code of one instruction, and of the prologue and epilogue
+#define JIT_MAX_INSTRUCTION   160
+#define JIT_MAX_FRAME         128
+
+// Cstr
+JitCompiler::JitCompiler(const JitHelpers& helpers, uint32_t size) :
+  _helpers(helpers), _buffer(NULL), _size(0), _used(0), _pos(NULL), _segments(0), _perfmap(NULL) {
+#ifdef JIT_X86_64
+  // The buffer is never writable and executable at once : a host that forbids it to become executable has no JIT
+  void* buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer != MAP_FAILED) {
+    if (mprotect(buffer, size, PROT_READ | PROT_EXEC) == 0) {
+      _buffer = (uint8_t*)buffer;
+      _size = size;
+    } else {
+      munmap(buffer, size);
+    }
+  }
+#endif
+}
+
+// Dstr
+JitCompiler::~JitCompiler() {
+#ifdef JIT_X86_64
+  if (_buffer != NULL)
+    munmap(_buffer, _size);
+#endif
+  if (_perfmap != NULL)
+    fclose(_perfmap);
+}
+
+// Availability
+bool JitCompiler::isAvailable() const {
+  return _buffer != NULL;
+}
+
+// Statistics
+uint32_t JitCompiler::getUsed() const {
+  return _used;
+}
+
+uint64_t JitCompiler::getSegmentCount() const {
+  return _segments;
+}
+
+// Reset
+void JitCompiler::reset() {
+  _used = 0;
+}
+
+// Compilable instructions
+bool JitCompiler::isCompilable(const DecodedInstruction& di) {
+  switch (di.handler) {
+    case DI_SETHI:
+    case DI_ALU:
+    case DI_LDSB:
+    case DI_LDSH:
+    case DI_LDUB:
+    case DI_LDUH:
+    case DI_LD:
+    case DI_STB:
+    case DI_STH:
+    case DI_ST:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// ALU operations made by the compiled code itself
+bool JitCompiler::isInlineALU(uint8_t op3) {
+  return op3 <= ALU_OP_XNOR || (op3 >= ALU_OP_SLL && op3 <= ALU_OP_SRA);
+}
+
+// Compile a block
+bool JitCompiler::compile(BasicBlock* block) {
+  if (_buffer == NULL)
+    return true;
+
+  // The terminator and the delay slot are never compiled
+  uint32_t body = block->length;
+  if (body > 0 && block->code[body - 1].isControlTransfer())
+    body--;
+  uint32_t reserved = _used + body * JIT_MAX_INSTRUCTION + (body / JIT_MIN_SEGMENT + 1) * JIT_MAX_FRAME;
+  if (reserved > _size)
+    return false;
+
+  // The code is emitted in writable pages; the block only enters it once it is executable again
+  uint32_t first = _used;
+  if (!protect(first, reserved, false))
+    return true;
+  std::vector<std::pair<uint32_t, NativeSegment> > compiled;
+
+  uint32_t start = 0;
+  while (start < body) {
+    if (!isCompilable(block->code[start])) {
+      start++;
+      continue;
+    }
+    uint32_t end = start;
+    while (end < body && isCompilable(block->code[end]))
+      end++;
+
+    if (end - start >= JIT_MIN_SEGMENT) {
+      NativeSegment segment;
+      uint8_t* entry = _buffer + _used;
+      compileSegment(&block->code[start], end - start, segment);
+
+      if (_perfmap == NULL) {
+        char name[64];
+        snprintf(name, sizeof(name), "/tmp/perf-%d.map", (int)getpid());
+        _perfmap = fopen(name, "a");
+      }
+      if (_perfmap != NULL) {
+        fprintf(_perfmap, "%lx %lx ksparc_%08x\n", (unsigned long)entry, (unsigned long)(_pos - entry),
+                block->address + 4 * start);
+        fflush(_perfmap);
+      }
+
+      compiled.push_back(std::make_pair(start, segment));
+    }
+    start = end;
+  }
+
+  if (!protect(first, reserved, true)) {
+    _used = first;
+    return true;
+  }
+
+  // The first instruction of each run now enters its segment
+  for (auto it = compiled.begin(); it != compiled.end(); it++) {
+    DecodedInstruction native;
+    native.handler = DI_NATIVE;
+    native.imm = block->native.size();
+    block->native.push_back(it->second);
+    block->code[it->first] = native;
+    _segments++;
+  }
+  return true;
+}
+
+// Protection of the pages of a range of the buffer
+bool JitCompiler::protect(uint32_t from, uint32_t to, bool executable) {
+#ifdef JIT_X86_64
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t start = ((uintptr_t)_buffer + from) & ~(page - 1);
+  return mprotect((void*)start, (uintptr_t)_buffer + to - start,
+                  executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#else
+  return false;
+#endif
+}
+
+// Compile a run of instructions
+void JitCompiler::compileSegment(const DecodedInstruction* code, uint32_t length, NativeSegment& segment) {
+  // Registers read and written, and how often
+  uint32_t uses[32];
+  memset(uses, 0, sizeof(uses));
+  segment.length = length;
+  segment.live = 0;
+  segment.defined = 0;
+
+  for (uint32_t k = 0; k < length; k++) {
+    const DecodedInstruction& di = code[k];
+    uint32_t read = 0, written = 0;
+    switch (di.handler) {
+      case DI_SETHI:
+        written = 1 << di.rd;
+        break;
+      case DI_ALU:
+        read = (1 << di.rs1) | (di.i ? 0 : 1 << di.rs2);
+        written = 1 << di.rd;
+        if (!isInlineALU(di.op3))
+          read |= 1 << di.rd; // given to the helper
+        break;
+      case DI_STB:
+      case DI_STH:
+      case DI_ST:
+        read = (1 << di.rs1) | (di.i ? 0 : 1 << di.rs2) | (1 << di.rd);
+        break;
+      default: // loads
+        read = (1 << di.rs1) | (di.i ? 0 : 1 << di.rs2);
+        written = 1 << di.rd;
+        break;
+    }
+    segment.live |= read | written;
+    segment.defined |= written;
+    for (uint32_t n = 1; n < 32; n++)
+      if (((read | written) >> n) & 1)
+        uses[n]++;
+  }
+  segment.live &= ~1;
+  segment.defined &= ~1;
+
+  // The most used registers go to r12d..r15d
+  for (uint32_t n = 0; n < 32; n++)
+    _cached[n] = -1;
+  for (int host = R12; host < R12 + JIT_HOST_REGISTERS; host++) {
+    uint32_t best = 0;
+    for (uint32_t n = 1; n < 32; n++)
+      if (_cached[n] < 0 && uses[n] >= 2 && (best == 0 || uses[n] > uses[best]))
+        best = n;
+    if (best == 0)
+      break;
+    _cached[best] = host;
+  }
+
+  _pos = _buffer + _used;
+  segment.entry = (uint32_t (*)(void*))_pos;
+  emitPrologue();
+  for (uint32_t k = 0; k < length; k++)
+    compileInstruction(code[k], k + 1);
+  emitEpilogue(length);
+  _used = _pos - _buffer;
+}
+
+// Compile one instruction
+void JitCompiler::compileInstruction(const DecodedInstruction& di, uint32_t done) {
+  switch (di.handler) {
+    case DI_SETHI:
+      emitMovRI(RAX, di.imm);
+      storeGuest(di.rd, RAX);
+      break;
+
+    case DI_ALU: {
+        // group 1 digits and register forms of the simple operations
+        int digit = 0;
+        uint8_t op = 0;
+        bool invert = false;
+        switch (di.op3) {
+          case ALU_OP_ADD:  digit = 0; op = 0x01; break;
+          case ALU_OP_AND:  digit = 4; op = 0x21; break;
+          case ALU_OP_OR:   digit = 1; op = 0x09; break;
+          case ALU_OP_XOR:  digit = 6; op = 0x31; break;
+          case ALU_OP_SUB:  digit = 5; op = 0x29; break;
+          case ALU_OP_ANDN: digit = 4; op = 0x21; invert = true; break;
+          case ALU_OP_ORN:  digit = 1; op = 0x09; invert = true; break;
+          case ALU_OP_XNOR: digit = 6; op = 0x31; invert = true; break;
+          case ALU_OP_SLL:  digit = 4 | 0x10; break;
+          case ALU_OP_SRL:  digit = 5 | 0x10; break;
+          case ALU_OP_SRA:  digit = 7 | 0x10; break;
+          default: break;
+        }
+
+        if (!isInlineALU(di.op3)) {
+          // left to the ALU
+          loadGuest(RDX, di.rs1);
+          if (di.i)
+            emitMovRI(RCX, di.imm);
+          else
+            loadGuest(RCX, di.rs2);
+          loadGuest(R8, di.rd);
+          emitMovRI(RSI, di.op3);
+          emitCall((const void*)_helpers.alu);
+          storeGuest(di.rd, RAX);
+          break;
+        }
+
+        loadGuest(RAX, di.rs1);
+        if (digit & 0x10) {
+          // shifts : the 32-bit shifts of the host use the 5 low bits of the count, as AbstractALU::shift()
+          if (di.i) {
+            emitShift(digit & 0x07, RAX, false, di.imm & 0x1F);
+          } else {
+            loadGuest(RCX, di.rs2);
+            emitShift(digit & 0x07, RAX, true, 0);
+          }
+        } else if (di.i) {
+          emitRI(digit, RAX, invert ? ~di.imm : di.imm);
+        } else {
+          loadGuest(RCX, di.rs2);
+          if (invert) {
+            // not ecx
+            emitRex(false, 0, RCX);
+            emit8(0xF7);
+            emit8(0xC0 | (2 << 3) | RCX);
+          }
+          emitRR(op, RCX, RAX);
+        }
+        storeGuest(di.rd, RAX);
+      }
+      break;
+
+    case DI_STB:
+    case DI_STH:
+    case DI_ST:
+    case DI_LDSB:
+    case DI_LDSH:
+    case DI_LDUB:
+    case DI_LDUH:
+    case DI_LD: {
+        // address in edx, handler in esi
+        loadGuest(RDX, di.rs1);
+        if (di.i) {
+          if (di.imm != 0)
+            emitRI(0, RDX, di.imm);
+        } else {
+          loadGuest(RCX, di.rs2);
+          emitRR(0x01, RCX, RDX);
+        }
+        emitMovRI(RSI, di.handler);
+
+        if (di.handler < DI_STB) {
+          // a faulted load leaves its destination alone
+          emitCall((const void*)_helpers.load);
+          emitCheckStop(done);
+          storeGuest(di.rd, RAX);
+          break;
+        }
+
+        loadGuest(RCX, di.rd);
+        emitCall((const void*)_helpers.store);
+        emitCheckStop(done);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Prologue : save the registers we use, get the context, load the cached registers
+void JitCompiler::emitPrologue() {
+  emit8(0x53);                      // push rbx
+  for (int r = R12; r < R12 + 4; r++) {
+    emitRex(false, 0, r);           // push r12..r15
+    emit8(0x50 | (r & 7));
+  }
+  emitRex(true, RDI, RBX);          // mov rbx, rdi
+  emit8(0x89);
+  emit8(0xC0 | (RDI << 3) | RBX);
+
+  for (uint32_t n = 1; n < 32; n++)
+    if (_cached[n] >= 0)
+      emitRM(0x8B, _cached[n], 4 * n);
+}
+
+// Epilogue : write back the cached registers, restore the host registers, return the count
+void JitCompiler::emitEpilogue(uint32_t done) {
+  for (uint32_t n = 1; n < 32; n++)
+    if (_cached[n] >= 0)
+      emitRM(0x89, _cached[n], 4 * n);
+
+  emitMovRI(RAX, done);
+  for (int r = R12 + 3; r >= R12; r--) {
+    emitRex(false, 0, r);           // pop r15..r12
+    emit8(0x58 | (r & 7));
+  }
+  emit8(0x5B);                      // pop rbx
+  emit8(0xC3);                      // ret
+}
+
+// Leave the segment if a helper has asked for it
+void JitCompiler::emitCheckStop(uint32_t done) {
+  // cmp dword [rbx + stop], 0; je over the exit
+  emit8(0x83);
+  emit8(0x80 | (7 << 3) | RBX);
+  emit32(offsetof(JitContext, stop));
+  emit8(0);
+  emit8(0x74);
+  uint8_t* jump = _pos;
+  emit8(0);
+  emitEpilogue(done);
+  *jump = (uint8_t)(_pos - jump - 1);
+}
+
+// Guest registers
+void JitCompiler::loadGuest(int host, uint32_t guest) {
+  if (guest == 0)
+    emitRR(0x31, host, host);       // xor host, host
+  else if (_cached[guest] >= 0)
+    emitRR(0x89, _cached[guest], host);
+  else
+    emitRM(0x8B, host, 4 * guest);
+}
+
+void JitCompiler::storeGuest(uint32_t guest, int host) {
+  if (guest == 0)
+    return;
+  if (_cached[guest] >= 0)
+    emitRR(0x89, host, _cached[guest]);
+  else
+    emitRM(0x89, host, 4 * guest);
+}
+
+// Instructions
+void JitCompiler::emitRex(bool w, int reg, int rm) {
+  uint8_t rex = 0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((rm & 8) ? 0x01 : 0);
+  if (rex != 0x40)
+    emit8(rex);
+}
+
+void JitCompiler::emitRR(uint8_t op, int reg, int rm) {
+  emitRex(false, reg, rm);
+  emit8(op);
+  emit8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void JitCompiler::emitRM(uint8_t op, int reg, uint32_t disp) {
+  emitRex(false, reg, RBX);
+  emit8(op);
+  if (disp < 0x80) {
+    emit8(0x40 | ((reg & 7) << 3) | RBX);
+    emit8(disp);
+  } else {
+    emit8(0x80 | ((reg & 7) << 3) | RBX);
+    emit32(disp);
+  }
+}
+
+void JitCompiler::emitRI(uint8_t digit, int rm, uint32_t imm) {
+  emitRex(false, 0, rm);
+  emit8(0x81);
+  emit8(0xC0 | (digit << 3) | (rm & 7));
+  emit32(imm);
+}
+
+void JitCompiler::emitShift(uint8_t digit, int rm, bool byCl, uint8_t count) {
+  if (!byCl && count == 0)
+    return;
+  emitRex(false, 0, rm);
+  emit8(byCl ? 0xD3 : 0xC1);
+  emit8(0xC0 | (digit << 3) | (rm & 7));
+  if (!byCl)
+    emit8(count);
+}
+
+void JitCompiler::emitMovRI(int reg, uint32_t imm) {
+  emitRex(false, 0, reg);
+  emit8(0xB8 | (reg & 7));
+  emit32(imm);
+}
+
+// Call a helper, with the context as first argument
+void JitCompiler::emitCall(const void* function) {
+  emitRex(true, RBX, RDI);          // mov rdi, rbx
+  emit8(0x89);
+  emit8(0xC0 | (RBX << 3) | RDI);
+  emit8(0x48);                      // mov rax, function
+  emit8(0xB8);
+  emit64((uint64_t)function);
+  emit8(0xFF);                      // call rax
+  emit8(0xD0);
+}
+
+// Bytes
+void JitCompiler::emit8(uint8_t b) {
+  *_pos++ = b;
+}
+
+void JitCompiler::emit32(uint32_t w) {
+  memcpy(_pos, &w, 4);
+  _pos += 4;
+}
+
+void JitCompiler::emit64(uint64_t q) {
+  memcpy(_pos, &q, 8);
+  _pos += 8;
+}
+
@@ -0,0 +1,198 @@
+/*
+ * jitcompiler.h -- defines the JitCompiler class, which translates basic blocks into x86-64 code
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef JITCOMPILER_H
+#define JITCOMPILER_H
+
+#include <stdint.h>
+#include <cstdio>
+#include "blockcache.h"
+
+// The compiler only generates code for this host
+#if defined(__x86_64__) && defined(__GNUC__)
+#define JIT_X86_64
+#endif
+
+// Size of the executable buffer
+#define JIT_BUFFER_SIZE     (4 * 1024 * 1024)
+// Number of executions of a block before it is compiled
+#define JIT_THRESHOLD       64
+// Minimal number of instructions of a native segment
+#define JIT_MIN_SEGMENT     2
+// Number of guest registers which can live in host registers during a segment
+#define JIT_HOST_REGISTERS  4
+
+/**
+ * State shared between the engine and the compiled code
+ */
+struct JitContext {
+  uint32_t r[32];           //!< Registers of the current window (only the live ones are meaningful)
+  uint32_t stop;            //!< Set by the helpers when the segment must be left (the code has been modified, or the access has faulted)
+  void* engine;             //!< Engine, for the helpers
+};
+
+/**
+ * Functions called by the compiled code for what it does not do by itself
+ */
+struct JitHelpers {
+  /**
+   * Load from memory
+   * @param ctx context
+   * @param handler DI_LDSB, DI_LDSH, DI_LDUB, DI_LDUH or DI_LD
+   * @param address address
+   * @returns loaded value, extended to 32 bits
+   */
+  uint32_t (*load)(JitContext* ctx, uint32_t handler, uint32_t address);
+  /**
+   * Store to memory
+   * @param ctx context
+   * @param handler DI_STB, DI_STH or DI_ST
+   * @param address address
+   * @param value value
+   */
+  void (*store)(JitContext* ctx, uint32_t handler, uint32_t address, uint32_t value);
+  /**
+   * ALU operation
+   * @param ctx context
+   * @param op3 operation
+   * @param a first operand
+   * @param b second operand
+   * @param rd current value of the destination (kept if the operation does not write it)
+   * @returns value of the destination
+   */
+  uint32_t (*alu)(JitContext* ctx, uint32_t op3, uint32_t a, uint32_t b, uint32_t rd);
+};
+
+/**
+ * The JitCompiler translates the straight-line parts of basic blocks into x86-64 code.
+ *
+ * Only the simple instructions are compiled (SETHI, ALU operations, loads and stores); each run of
+ * such instructions becomes a NativeSegment of the block, and the rest of the block (control
+ * transfers, special registers, windows, FPop, CPop, Ticc, etc.) stays interpreted.
+ *
+ * In a segment, rbx holds the JitContext, and the guest registers used the most are kept in
+ * r12d..r15d (which the helpers preserve); the others are read and written in the context. The
+ * engine copies the live registers into the context before running the segment, and writes back
+ * the defined ones afterwards. Condition codes and y are handled by the ALU, through the alu helper.
+ *
+ * The buffer is never writable and executable at once (W^X) : the pages where a block is compiled are made
+ * writable, then executable again before the block enters its segments.
+ *
+ * Every compiled segment is declared in /tmp/perf-<pid>.map, so that perf can name them.
+ */
+class JitCompiler {
+	public:
+    /**
+     * Constructor
+     * @param helpers functions called by the compiled code
+     * @param size size of the executable buffer
+     */
+		JitCompiler(const JitHelpers& helpers, uint32_t size = JIT_BUFFER_SIZE);
+    /**
+     * Destructor
+     */
+		~JitCompiler();
+
+    /**
+     * Tells if the compiler can be used (right host, executable buffer allocated)
+     * @returns true if it can compile
+     */
+    bool isAvailable() const;
+
+    /**
+     * Compile the straight-line parts of a block
+     * @param block the block
+     * @returns false if the buffer is full (the block is left as it is); reset() must then be called
+     *          once no compiled code can be executed anymore
+     */
+    bool compile(BasicBlock* block);
+    /**
+     * Forget every compiled segment and reuse the whole buffer
+     */
+    void reset();
+
+    /**
+     * Get the number of bytes of code generated since the last reset
+     * @returns used size
+     */
+    uint32_t getUsed() const;
+    /**
+     * Get the number of segments compiled since the beginning
+     * @returns segment count
+     */
+    uint64_t getSegmentCount() const;
+
+	private:
+    /**
+     * Tells if an instruction can be part of a segment
+     * @param di the instruction
+     * @returns true if it can be compiled
+     */
+    static bool isCompilable(const DecodedInstruction& di);
+    /**
+     * Tells if an ALU operation is made by the compiled code (else, it is given to the alu helper)
+     * @param op3 the operation
+     * @returns true if it is made inline
+     */
+    static bool isInlineALU(uint8_t op3);
+    /**
+     * Compile a run of instructions
+     * @param code first instruction
+     * @param length number of instructions
+     * @param segment segment to fill
+     */
+    void compileSegment(const DecodedInstruction* code, uint32_t length, NativeSegment& segment);
+    /**
+     * Compile one instruction
+     * @param di the instruction
+     * @param done number of instructions executed once this one is done
+     */
+    void compileInstruction(const DecodedInstruction& di, uint32_t done);
+    /**
+     * Make the pages of a range of the buffer writable (while code is emitted in them) or executable
+     * @param from beginning of the range (offset in the buffer)
+     * @param to end of the range
+     * @param executable true for read and execute, false for read and write
+     * @returns false if the host has refused
+     */
+    bool protect(uint32_t from, uint32_t to, bool executable);
+
+    /**
+     * Emission of bytes
+     */
+    void emit8(uint8_t b);
+    void emit32(uint32_t w);
+    void emit64(uint64_t q);
+    /**
+     * Emission of instructions (host registers are numbered as in the x86-64 encoding)
+     */
+    void emitRex(bool w, int reg, int rm);
+    void emitRR(uint8_t op, int reg, int rm);           // op r/m32 (register), r32
+    void emitRM(uint8_t op, int reg, uint32_t disp);    // op r32, [rbx + disp]
+    void emitRI(uint8_t digit, int rm, uint32_t imm);   // group 1 operation with an immediate
+    void emitShift(uint8_t digit, int rm, bool byCl, uint8_t count);
+    void emitMovRI(int reg, uint32_t imm);
+    void emitCall(const void* function);
+    void emitPrologue();
+    void emitEpilogue(uint32_t done);
+    void emitCheckStop(uint32_t done);                  // leave the segment if the stop flag is set
+    /**
+     * Move a guest register to a host register, and back
+     */
+    void loadGuest(int host, uint32_t guest);
+    void storeGuest(uint32_t guest, int host);
+
+    JitHelpers _helpers;
+    uint8_t* _buffer;
+    uint32_t _size, _used;
+    uint8_t* _pos;
+    int _cached[32];                  // host register holding each guest register (or -1)
+    uint64_t _segments;
+    FILE* _perfmap;
+};
+
+#endif // JITCOMPILER_H
+
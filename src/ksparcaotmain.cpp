@@ -0,0 +1,49 @@
+/*
+ * ksparcaotmain.cpp -- ahead-of-time translator from kSparc programs to C++
+ * -----
+ * This tool translates a program assembled by kasm into a C++ source file. Once compiled and
+ * linked against the runtime (libksparcaot.a), it runs the program natively and prints the final
+ * state of the registers.
+ *
+ * Example :
+ *   ksparc-aot prog.kbin prog.cpp
+ *   g++ -O2 -I src prog.cpp bin/libksparcaot.a -o prog
+ *
+ * Author: krab
+ * Version: 0.1
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include "aottranslator.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    cerr << "Usage: ksparc-aot <input.kbin> <output.cpp> [memory size]" << endl;
+    return -1;
+  }
+
+  ifstream in(argv[1], ios::in | ios::binary);
+  if (!in) {
+    cerr << "Cannot open " << argv[1] << endl;
+    return -1;
+  }
+  vector<uint8_t> image((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+  ofstream out(argv[2]);
+  if (!out) {
+    cerr << "Cannot write " << argv[2] << endl;
+    return -1;
+  }
+
+  uint32_t memsize = (argc >= 4 ? strtoul(argv[3], NULL, 0) : 0);
+  AotTranslator translator(image);
+  translator.translate(out, 0, memsize);
+
+  cout << argv[1] << ": " << translator.getBlockCount() << " blocks translated into " << argv[2] << endl;
+  return 0;
+}
+
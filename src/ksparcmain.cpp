@@ -17,7 +17,10 @@
 #include <bitset>
 #include "simplememory.h"
 #include "simplealu.h"
+#include "hostfpu.h"
 #include "sparcengine.h"
+#include "basicsparcengine.h"
+#include "threadedsparcengine.h"
 #include "disassembler.h"
 
 #include <ncurses.h>
@@ -26,6 +29,10 @@
 #define CMDS_HEIGHT 3
 #define REG_HEIGHT  10
 
+// Maximum number of instructions executed by the "run" command, so that the interface comes back
+// even if the program never stops
+#define RUN_BUDGET  100000000
+
 // Predefined colorpairs : selected/not selected
 #define COL_SHALLOWSEL    2
 #define COL_DEFAULT       3
@@ -125,6 +132,11 @@ void printCommands(WINDOW* win, int starty, int startx) {
   mvwprintw(win, starty+1, startx+50, " - ");
   wattroff(win, COLOR_PAIR(COL_CMDHL));
   wprintw(win, "  Shrink selection size");
+
+  wattron(win, COLOR_PAIR(COL_CMDHL));
+  mvwprintw(win, starty+1, startx+100, " r ");
+  wattroff(win, COLOR_PAIR(COL_CMDHL));
+  wprintw(win, "  Run until halt");
 }
 
 /**
@@ -142,6 +154,7 @@ void printCommands(WINDOW* win, int starty, int startx) {
 void printMemory(WINDOW* win, AbstractMemory* mem, uint32_t from, uint32_t rows, uint32_t cols, int starty, int startx) {
   // Declarations
   uint32_t addr;
+  std::vector<uint8_t> row(cols);
 
   // Print first line : columns offset address
   wmove(win, starty, startx+12);
@@ -161,12 +174,17 @@ void printMemory(WINDOW* win, AbstractMemory* mem, uint32_t from, uint32_t rows,
     wprintw(win, "0x%08x  ", (from+i)*cols);
     wattroff(win, A_BOLD);
     
+    // The whole row at once
+    mem->copyOut((from+i)*cols, row.data(), cols);
+    if (mem->hasFault())
+      mem->clearFault();
+
     // Print *cols*xvalues from the mem
     for (uint32_t j = 0; j < cols; j++) {
       addr = (from+i)*cols+j; // effective address
       if (addr < mem->getSize()) {
-        Logger::log() << std::hex << std::setfill('0') << std::setw(8) << addr << ": " << mem->readByte(addr) << "\n";
-        wprintw(win, "%02x ", mem->readByte(addr)); // value is just in hex (XX)
+        Logger::log() << std::hex << std::setfill('0') << std::setw(8) << addr << ": " << row[j] << "\n";
+        wprintw(win, "%02x ", row[j]); // value is just in hex (XX)
       } else {
         wprintw(win, "## "); // if there is no value (memory size exceeded)
       }
@@ -178,7 +196,7 @@ void printMemory(WINDOW* win, AbstractMemory* mem, uint32_t from, uint32_t rows,
     for (uint32_t j = 0; j < cols; j++) {
       addr = (from+i)*cols+j;
       if (addr < mem->getSize()) {
-        uint8_t c = mem->readByte(addr);
+        uint8_t c = row[j];
         wprintw(win, "%c", (escape(c) ? '.' : c)); // if value = 0, by convention, we put '.'
       } else {
         wprintw(win, "#");
@@ -392,34 +410,6 @@ void highlightSelection(WINDOW* win, uint32_t addr, uint32_t size, uint32_t rows
   mvwchgat(win, _dlsy, _dlsx2, _dlsize, A_NORMAL, 2, NULL);
 }
 
-/**
- * loadFile -- load a file into memory
- * mem : the memory
- * filename : name of the file
- */
-void loadFile(AbstractMemory* mem, std::string filename, uint32_t baseaddr = 0) {
-  std::ifstream fs;
-  char ch;
-  uint32_t inst;
-  uint32_t addr = baseaddr;
-
-  try {
-    fs.open(filename, std::ios::in | std::ios::binary);
-  } catch (std::ifstream::failure e) {
-    Logger::log() << "Cannot open file " << filename << ": " << e.what() << "\n";
-  }
-
-  fs.seekg(0, std::ios::beg);
-  while (!fs.eof()) {
-    fs.read(&ch, sizeof(char));
-    Logger::log() << "Writing char " << std::hex << (int32_t)(ch) << " into memory\n";
-    mem->writeByte(addr, ch);
-    Logger::log() << "=> " << std::hex << std::setfill('0') << std::setw(8) << addr << " = " << (int32_t)(mem->readByte(addr)) << "\n";
-    addr++;
-  }
-  fs.close();
-}
-
 /**
  * main function
  */
@@ -430,8 +420,10 @@ int main(int argc, char* argv[]) {
   /// Parse inputs
   if (argc < 2) {
     std::cerr << "No file specified !" << std::endl;
+    std::cerr << "Usage: ksparc <file> [reference|basic|threaded|blocks|jit]" << std::endl;
     return -1;
   }
+  std::string enginename = (argc >= 3 ? argv[2] : "reference");
 
   /// Declarations
   // GUI related : sizes of the window, of some areas, etc.
@@ -450,6 +442,7 @@ int main(int argc, char* argv[]) {
   uint32_t selection = 0,     lastselection = 1;
   uint32_t selsize = 1,       lastselsize = 0;
   bool next = true;
+  uint32_t stop = SE_STOP_NONE;
   
   // User input character
   int ch = 0;
@@ -458,10 +451,26 @@ int main(int argc, char* argv[]) {
   SpecialRegister psr, wim, tbr, y, pc, npc, fsr;
   WindowRegisters* registers = new WindowRegisters(4, &psr, &wim);
   SimpleALU* alu = new SimpleALU(&psr, &y);
+  HostFPU* fpu = new HostFPU(&fsr);
   SimpleMemory* memory = new SimpleMemory(32768); // 32 ko
-  loadFile(memory, std::string(argv[1]));
+  try {
+    memory->loadFile(argv[1]);
+  } catch (std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
 
-  SparcEngine* engine = new SparcEngine(memory, alu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+  SparcEngine* engine;
+  if (enginename == "threaded" || enginename == "blocks" || enginename == "jit") {
+    ThreadedSparcEngine* threaded = new ThreadedSparcEngine(memory, alu, fpu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+    threaded->setBlockMode(enginename != "threaded");
+    if (enginename == "jit" && !threaded->setJit(true))
+      std::cerr << "The JIT is not available on this host, blocks are interpreted" << std::endl;
+    engine = threaded;
+  } else if (enginename == "basic")
+    engine = new SimpleSparcEngine(memory, alu, fpu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+  else
+    engine = new SparcEngine(memory, alu, fpu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
 
   /// Initialize GUI
   initscr();
@@ -573,7 +582,10 @@ int main(int argc, char* argv[]) {
           selection = (selection + selsize) % memory->getSize();
         else
           if (executionmode) {
-            engine->next();
+            // one instruction : only tell why the engine did not execute it
+            stop = engine->run(1);
+            if (stop == SE_STOP_BUDGET)
+              stop = SE_STOP_NONE;
             next = true;
           } else
             instr = (instr + 4) % memory->getSize();
@@ -584,9 +596,17 @@ int main(int argc, char* argv[]) {
           if (!executionmode)
             instr = (instr >= 4 ? instr - 4 : 0);
     }
+    // Run at full speed
+    else if (ch == 'r') {
+      if (executionmode) {
+        stop = engine->run(RUN_BUDGET);
+        next = true;
+      }
+    }
     // Switch modes
     else if (ch == KEY_F(1)) {
       engine->init();
+      stop = SE_STOP_NONE;
       executionmode = !executionmode;
       next = true;
     }
@@ -606,6 +626,7 @@ int main(int argc, char* argv[]) {
       mvwprintw(regw, 3, 46, "TBR: (TBA) 0x%06x", tbr.getField(TBR_TBA));
       mvwprintw(regw, 4, 46, "      (tt) 0x%02x", tbr.getField(TBR_TT));
       mvwprintw(regw, 5, 46, "  Y: 0x%08x", y.read());
+      mvwprintw(regw, 6, 46, "     %-20s", (stop == SE_STOP_NONE ? "" : stopReason(stop)));
 
       wrefresh(regw);
     }
@@ -729,6 +750,7 @@ int main(int argc, char* argv[]) {
   delete registers;
   delete memory;
   delete alu;
+  delete fpu;
 
   Logger::destroy();
 
@@ -0,0 +1,388 @@
+/*
+ * ksparcrunmain.cpp -- headless batch runner for kSparc programs
+ * -----
+ * This tool loads a program assembled by kasm, runs it at full speed without any terminal
+ * interface, then prints why it stopped, the final state of the registers, the requested memory
+ * ranges and the speed of the emulation.
+ *
+ * Usage: ksparc-run [options] <file.kbin>
+ *   -m <size>         memory size in bytes (default 32768)
+ *   -t <memory>       simple, paged for the whole 4 GB address space, or reserved for a direct
+ *                     mapping of the host (accesses beyond the size trap) (default simple)
+ *   -u <mmu>          none, or srmmu for a SPARC reference MMU in front of the memory, disabled until
+ *                     the program enables it (registers in ASI 4, flush in ASI 3, bypass in ASI 0x20);
+ *                     the program then starts in supervisor mode (default none)
+ *   -b <dma>          none, or dma for a DMA engine moving blocks of the memory (through the MMU, if
+ *                     any), with its registers in ASI 0x21 (default none)
+ *   -c <checks>       permissive, or strict for misaligned accesses and accesses beyond the memory to
+ *                     trap (default permissive)
+ *   -w <windows>      number of register windows (default 4)
+ *   -s <spill>        wrap for the windows to wrap around (no window is invalid), trap for the last one
+ *                     to be invalid, with window overflows and underflows handled by the program, host
+ *                     for them to be handled by the emulator, or unbounded for the windows to grow as deep
+ *                     as the calls go, without any (default wrap)
+ *   -e <address>      entry point (default 0)
+ *   -n <count>        maximum number of instructions (default: no limit)
+ *   -d <addr>:<size>  print a range of the memory at the end (can be repeated)
+ *   -x <engine>       reference, basic, threaded, blocks or jit (default blocks)
+ *   -a <muldiv>       multiplications and divisions : native or serial (default native)
+ *   -f <fpu>          none for the floating-point instructions to trap (fp_disabled), or host for the FPU to be
+ *                     enabled, computing with the IEEE arithmetic of the host (default none)
+ *   -l <file>         log file of the engine (default /dev/null)
+ *
+ * The exit status is 0 if the program has reached the null word, 1 otherwise.
+ *
+ * Author: krab
+ * Version: 0.1
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "simplememory.h"
+#include "pagedmemory.h"
+#include "reservedmemory.h"
+#include "dmadevice.h"
+#include "simplealu.h"
+#include "hostfpu.h"
+#include "basicsparcengine.h"
+#include "windowregisterfile.h"
+#include "threadedsparcengine.h"
+
+// Default machine : same as ksparc
+#define RUN_MEMORY_SIZE   32768
+#define RUN_WINDOWS       4
+
+using namespace std;
+
+/*
+ * usage -- print the usage of the tool
+ */
+void usage() {
+  cerr << "Usage: ksparc-run [options] <file.kbin>" << endl
+       << "  -m <size>         memory size in bytes (default " << RUN_MEMORY_SIZE << ")" << endl
+       << "  -t <memory>       simple, paged for the whole 4 GB address space, or reserved for a direct" << endl
+       << "                    mapping of the host (accesses beyond the size trap) (default simple)" << endl
+       << "  -u <mmu>          none, or srmmu for a SPARC reference MMU in front of the memory, disabled until" << endl
+       << "                    the program enables it (registers in ASI 4, flush in ASI 3, bypass in ASI 0x20);" << endl
+       << "                    the program then starts in supervisor mode (default none)" << endl
+       << "  -b <dma>          none, or dma for a DMA engine moving blocks of the memory (through the MMU, if" << endl
+       << "                    any), with its registers in ASI 0x21 (default none)" << endl
+       << "  -c <checks>       permissive, or strict for misaligned accesses and accesses beyond the memory to" << endl
+       << "                    trap (default permissive)" << endl
+       << "  -w <windows>      number of register windows (default " << RUN_WINDOWS << ")" << endl
+       << "  -s <spill>        wrap for the windows to wrap around (no window is invalid), trap for the last one" << endl
+       << "                    to be invalid, with window overflows and underflows handled by the program, host" << endl
+       << "                    for them to be handled by the emulator, or unbounded for the windows to grow as deep" << endl
+       << "                    as the calls go, without any (default wrap)" << endl
+       << "  -e <address>      entry point (default 0)" << endl
+       << "  -n <count>        maximum number of instructions (default: no limit)" << endl
+       << "  -d <addr>:<size>  print a range of the memory at the end (can be repeated)" << endl
+       << "  -x <engine>       reference, basic, threaded, blocks or jit (default blocks)" << endl
+       << "  -a <muldiv>       multiplications and divisions : native or serial (default native)" << endl
+       << "  -f <fpu>          none for the floating-point instructions to trap (fp_disabled), or host for the FPU to be" << endl
+       << "                    enabled, computing with the IEEE arithmetic of the host (default none)" << endl
+       << "  -l <file>         log file of the engine (default /dev/null)" << endl;
+}
+
+/*
+ * parseNumber -- parse a decimal, hexadecimal (0x) or octal (0) number
+ * str : the string
+ * value : the result
+ *
+ * returns false if str is not a number
+ */
+bool parseNumber(const string& str, uint64_t& value) {
+  char* end;
+  if (str.empty())
+    return false;
+  value = strtoull(str.c_str(), &end, 0);
+  return *end == '\0';
+}
+
+/*
+ * dumpMemory -- print a range of the memory, 16 bytes per line
+ * mem : the memory
+ * from, size : the range
+ */
+void dumpMemory(AbstractMemory* mem, uint32_t from, uint32_t size) {
+  uint8_t bytes[16];
+  cout << hex << setfill('0');
+  for (uint32_t line = 0; line < size; line += 16) {
+    cout << "0x" << setw(8) << from + line << " ";
+    mem->copyOut(from + line, bytes, (size - line < 16 ? size - line : 16));
+    if (mem->hasFault())
+      mem->clearFault();
+    for (uint32_t k = line; k < line + 16 && k < size; k++) {
+      if (from + k < mem->getSize())
+        cout << " " << setw(2) << (uint32_t)bytes[k - line];
+      else
+        cout << " ##";
+    }
+    cout << endl;
+  }
+  cout << dec;
+}
+
+/*
+ * newRegisters -- the register file : one of its own for the usual numbers of windows (see WindowRegisterFile)
+ * windows : number of windows
+ * unbounded : true for the windows to grow instead of wrapping
+ * psr, wim : the registers it works with
+ *
+ * returns the register file
+ */
+WindowRegisters* newRegisters(uint32_t windows, bool unbounded, SpecialRegister* psr, SpecialRegister* wim) {
+  if (!unbounded) {
+    switch (windows) {
+      case 4:  return new WindowRegisterFile<4>(psr, wim);
+      case 7:  return new WindowRegisterFile<7>(psr, wim);
+      case 8:  return new WindowRegisterFile<8>(psr, wim);
+      case 16: return new WindowRegisterFile<16>(psr, wim);
+      case 32: return new WindowRegisterFile<32>(psr, wim);
+    }
+  }
+  return new WindowRegisters(windows, psr, wim, unbounded);
+}
+
+/*
+ * newBasicEngine -- a BasicSparcEngine for the type of the memory and the one of the register file
+ * memory : the memory (the MMU if there is one)
+ * alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr : the other components
+ *
+ * returns the engine
+ */
+template <class Registers>
+SparcEngine* newBasicEngine(AbstractMemory* memory, SimpleALU* alu, AbstractFPU* fpu, Registers* registers,
+                            SpecialRegister* psr, SpecialRegister* wim, SpecialRegister* tbr, SpecialRegister* y,
+                            SpecialRegister* pc, SpecialRegister* npc, SpecialRegister* fsr) {
+  if (SrmmuMemory* mmu = dynamic_cast<SrmmuMemory*>(memory))
+    return new BasicSparcEngine<SrmmuMemory, SimpleALU, Registers>(mmu, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr);
+  if (PagedMemory* pages = dynamic_cast<PagedMemory*>(memory))
+    return new BasicSparcEngine<PagedMemory, SimpleALU, Registers>(pages, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr);
+  if (ReservedMemory* reserved = dynamic_cast<ReservedMemory*>(memory))
+    return new BasicSparcEngine<ReservedMemory, SimpleALU, Registers>(reserved, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr);
+  return new BasicSparcEngine<SimpleMemory, SimpleALU, Registers>(static_cast<SimpleMemory*>(memory), alu, fpu, registers,
+                                                                  psr, wim, tbr, y, pc, npc, fsr);
+}
+
+/**
+ * main function
+ */
+int main(int argc, char* argv[]) {
+  uint64_t memsize = RUN_MEMORY_SIZE, windows = RUN_WINDOWS, entry = 0, budget = SE_UNLIMITED;
+  vector<pair<uint32_t, uint32_t> > ranges;
+  string enginename = "blocks", memoryname = "simple", spill = "wrap", logfile = "/dev/null", filename;
+  bool serial = false, srmmu = false, strict = false, dma = false, hostfpu = false;
+
+  /// Parse inputs
+  for (int k = 1; k < argc; k++) {
+    string arg = argv[k];
+    if (arg.size() == 2 && arg[0] == '-' && k + 1 < argc) {
+      string value = argv[++k];
+      bool valid = true;
+      switch (arg[1]) {
+        case 'm': valid = parseNumber(value, memsize) && memsize > 0 && memsize <= 0xFFFFFFFF; break;
+        case 'w': valid = parseNumber(value, windows) && windows >= 2 && windows <= 32; break;
+        case 'e': valid = parseNumber(value, entry) && entry <= 0xFFFFFFFF && entry % 4 == 0; break;
+        case 'n': valid = parseNumber(value, budget); break;
+        case 'x': enginename = value; break;
+        case 't': valid = (value == "simple" || value == "paged" || value == "reserved"); memoryname = value; break;
+        case 'u': valid = (value == "none" || value == "srmmu"); srmmu = (value == "srmmu"); break;
+        case 'b': valid = (value == "none" || value == "dma"); dma = (value == "dma"); break;
+        case 's': valid = (value == "wrap" || value == "trap" || value == "host" || value == "unbounded"); spill = value; break;
+        case 'c': valid = (value == "permissive" || value == "strict"); strict = (value == "strict"); break;
+        case 'a': valid = (value == "native" || value == "serial"); serial = (value == "serial"); break;
+        case 'f': valid = (value == "none" || value == "host"); hostfpu = (value == "host"); break;
+        case 'l': logfile = value; break;
+        case 'd': {
+            uint64_t from, size;
+            size_t colon = value.find(':');
+            valid = colon != string::npos && parseNumber(value.substr(0, colon), from)
+                 && parseNumber(value.substr(colon + 1), size) && from <= 0xFFFFFFFF && size <= 0xFFFFFFFF;
+            if (valid)
+              ranges.push_back(make_pair((uint32_t)from, (uint32_t)size));
+          }
+          break;
+        default:
+          valid = false;
+      }
+      if (!valid) {
+        cerr << "Invalid value for " << arg << ": " << value << endl;
+        usage();
+        return -1;
+      }
+    } else if (filename.empty() && arg[0] != '-') {
+      filename = arg;
+    } else {
+      usage();
+      return -1;
+    }
+  }
+  if (filename.empty()) {
+    usage();
+    return -1;
+  }
+  if (enginename != "reference" && enginename != "basic" && enginename != "threaded" && enginename != "blocks" && enginename != "jit") {
+    cerr << "Unknown engine " << enginename << endl;
+    usage();
+    return -1;
+  }
+
+  Logger::init(logfile);
+
+  /// The machine
+  SpecialRegister psr, wim, tbr, y, pc, npc, fsr;
+  WindowRegisters* registers = newRegisters(windows, spill == "unbounded", &psr, &wim);
+  SimpleALU* alu = new SimpleALU(&psr, &y);
+  alu->setLazyFlags(true); // the engine makes the PSR up to date when it stops
+  alu->setSerialMulDiv(serial);
+  HostFPU* fpu = new HostFPU(&fsr);
+  PagedMemory* pages = NULL;
+  ReservedMemory* reserved = NULL;
+  SrmmuMemory* mmu = NULL;
+  DmaDevice* dmadevice = NULL;
+  AbstractMemory* memory;
+  try {
+    if (memoryname == "paged")
+      memory = pages = new PagedMemory();
+    else if (memoryname == "reserved")
+      memory = reserved = new ReservedMemory(memsize);
+    else
+      memory = new SimpleMemory(memsize);
+    memory->loadFile(filename);
+    memory->setStrict(strict);
+    if (srmmu) {
+      memory = mmu = new SrmmuMemory(memory, &psr);
+      memory->setStrict(strict);
+    }
+    if (dma)
+      dmadevice = new DmaDevice(memory); // the addresses of the program, so the engine sees its stores
+  } catch (runtime_error& e) {
+    cerr << e.what() << endl;
+    return -1;
+  }
+
+  // Start from a known state
+  psr.write(0);
+  for (uint32_t w = 0; w < windows; w++) {
+    psr.setField(PSR_CWP, w);
+    registers->update();
+    for (uint32_t nb = 1; nb < 32; nb++)
+      registers->write(nb, 0);
+  }
+  y.write(0);
+  fsr.write(0);
+
+  SparcEngine* engine;
+  if (enginename == "reference") {
+    engine = new SparcEngine(memory, alu, fpu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+  } else if (enginename == "basic") {
+    // the register files made by newRegisters()
+    switch (registers->isUnbounded() ? 0 : windows) {
+      case 4:
+        engine = newBasicEngine(memory, alu, fpu, static_cast<WindowRegisterFile<4>*>(registers), &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+        break;
+      case 7:
+        engine = newBasicEngine(memory, alu, fpu, static_cast<WindowRegisterFile<7>*>(registers), &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+        break;
+      case 8:
+        engine = newBasicEngine(memory, alu, fpu, static_cast<WindowRegisterFile<8>*>(registers), &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+        break;
+      case 16:
+        engine = newBasicEngine(memory, alu, fpu, static_cast<WindowRegisterFile<16>*>(registers), &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+        break;
+      case 32:
+        engine = newBasicEngine(memory, alu, fpu, static_cast<WindowRegisterFile<32>*>(registers), &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+        break;
+      default:
+        engine = newBasicEngine(memory, alu, fpu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+        break;
+    }
+  } else {
+    ThreadedSparcEngine* threaded = new ThreadedSparcEngine(memory, alu, fpu, registers, &psr, &wim, &tbr, &y, &pc, &npc, &fsr);
+    threaded->setBlockMode(enginename != "threaded");
+    if (enginename == "jit" && !threaded->setJit(true))
+      cerr << "The JIT is not available on this host, blocks are interpreted" << endl;
+    engine = threaded;
+  }
+  if (mmu != NULL) {
+    engine->setAddressSpace(SRMMU_ASI_FLUSH, mmu->flushSpace());
+    engine->setAddressSpace(SRMMU_ASI_REGISTERS, mmu->registerSpace());
+    engine->setAddressSpace(SRMMU_ASI_BYPASS, mmu->physical());
+  }
+  if (dmadevice != NULL)
+    engine->setAddressSpace(DMA_ASI, dmadevice);
+  engine->setWindowSpill(spill == "host");
+  engine->init();
+  if (spill != "wrap")
+    wim.write(1u << (windows - 1)); // the window before the first one, in the order of the saves
+  if (hostfpu)
+    psr.setField(PSR_EF, 1);
+  if (mmu != NULL)
+    psr.setField(PSR_S, 1); // a program that drives the MMU is a system : it starts in supervisor mode, as on reset
+  npc.write(entry);
+
+  /// Run
+  auto start = chrono::steady_clock::now();
+  uint32_t reason = engine->run(budget);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  uint64_t count = engine->getInstructionCount();
+
+  /// Report
+  cout << filename << ": " << stopReason(reason) << " after " << count << " instructions in "
+       << fixed << setprecision(3) << seconds << " s";
+  if (seconds > 0)
+    cout << " (" << setprecision(0) << count / seconds << " instructions/s)";
+  cout << endl;
+
+  cout << hex << setfill('0');
+  cout << "pc=" << setw(8) << pc.read() << " npc=" << setw(8) << npc.read()
+       << " psr=" << setw(8) << psr.read() << " wim=" << setw(8) << wim.read()
+       << " tbr=" << setw(8) << tbr.read() << " y=" << setw(8) << y.read() << endl;
+  for (uint32_t nb = 0; nb < 32; nb++)
+    cout << "r" << dec << nb << "=" << hex << setw(8) << registers->read(nb) << (nb % 8 == 7 ? "\n" : " ");
+  if (hostfpu) {
+    cout << "fsr=" << setw(8) << fsr.read() << endl;
+    for (uint32_t nb = 0; nb < FPU_REGISTERS; nb++)
+      cout << "f" << dec << nb << "=" << hex << setw(8) << fpu->read(nb) << (nb % 8 == 7 ? "\n" : " ");
+  }
+  cout << dec;
+
+  for (auto it = ranges.begin(); it != ranges.end(); it++)
+    dumpMemory(memory, it->first, it->second);
+
+  if (pages != NULL)
+    cout << "resident: " << pages->getResidentPages() << " pages, " << pages->getResidentSize() << " bytes" << endl;
+  if (reserved != NULL)
+    cout << "resident: " << reserved->getResidentPages() << " host pages, " << reserved->getResidentSize() << " bytes" << endl;
+  if (spill == "host")
+    cout << "windows: " << engine->getWindowSpills() << " spills, " << engine->getWindowFills() << " fills" << endl;
+  if (spill == "unbounded")
+    cout << "windows: " << registers->getAllocatedWindows() << " allocated" << endl;
+  if (hostfpu)
+    cout << "fpu: " << fpu->getOperations() << " operations" << endl;
+  if (dmadevice != NULL)
+    cout << "dma: " << dmadevice->getTransfers() << " transfers, " << dmadevice->getBytes() << " bytes" << endl;
+  if (mmu != NULL) {
+    cout << "mmu: " << mmu->getHits() << " hits " << mmu->getMisses() << " misses" << endl;
+    memory = mmu->physical();
+  }
+  cout << "tlb: instructions " << memory->instructionTLB().getHits() << " hits " << memory->instructionTLB().getMisses()
+       << " misses, data " << memory->dataTLB().getHits() << " hits " << memory->dataTLB().getMisses() << " misses" << endl;
+
+  delete engine;
+  delete registers;
+  delete dmadevice;
+  delete mmu;
+  delete memory;
+  delete alu;
+  delete fpu;
+
+  Logger::destroy();
+
+  return reason == SE_STOP_HALT ? 0 : 1;
+}
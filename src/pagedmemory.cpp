@@ -0,0 +1,103 @@
+/*
+ * pagedmemory.cpp -- implement the PagedMemory class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "pagedmemory.h"
+
+// Cstr
+PagedMemory::PagedMemory(uint32_t size) : AbstractMemory(size), _pages(0), _tables(0) {
+  _zeropage = new uint8_t[PM_PAGE_SIZE](); // zeroed : the null word stops the engine
+  _zerotable = new uint8_t*[PM_TABLE_SIZE];
+  for (uint32_t k = 0; k < PM_TABLE_SIZE; k++)
+    _zerotable[k] = _zeropage;
+  for (uint32_t k = 0; k < PM_DIR_SIZE; k++)
+    _dir[k] = _zerotable;
+}
+
+// Dstr
+PagedMemory::~PagedMemory() {
+  for (uint32_t t = 0; t < PM_DIR_SIZE; t++) {
+    if (_dir[t] == _zerotable)
+      continue;
+    for (uint32_t p = 0; p < PM_TABLE_SIZE; p++)
+      if (_dir[t][p] != _zeropage)
+        delete[] _dir[t][p];
+    delete[] _dir[t];
+  }
+  delete[] _zerotable;
+  delete[] _zeropage;
+}
+
+// Resident set
+uint32_t PagedMemory::getResidentPages() const {
+  return _pages;
+}
+
+uint64_t PagedMemory::getResidentSize() const {
+  return (uint64_t)_pages * PM_PAGE_SIZE + (uint64_t)_tables * PM_TABLE_SIZE * sizeof(uint8_t*);
+}
+
+// Pages for the TLB
+const uint8_t* PagedMemory::readablePage(uint32_t address) const {
+  return _dir[address >> (PM_PAGE_BITS + PM_TABLE_BITS)][(address >> PM_PAGE_BITS) & PM_TABLE_MASK];
+}
+
+// Allocate a page on its first write
+uint8_t* PagedMemory::writablePage(uint32_t address) {
+  uint8_t**& table = _dir[address >> (PM_PAGE_BITS + PM_TABLE_BITS)];
+  if (table == _zerotable) {
+    table = new uint8_t*[PM_TABLE_SIZE];
+    for (uint32_t k = 0; k < PM_TABLE_SIZE; k++)
+      table[k] = _zeropage;
+    _tables++;
+  }
+
+  uint8_t*& page = table[(address >> PM_PAGE_BITS) & PM_TABLE_MASK];
+  if (page == _zeropage) {
+    page = new uint8_t[PM_PAGE_SIZE]();
+    _pages++;
+    remap(address); // the TLB may still have the zero page
+  }
+  return page;
+}
+
+// Block transfers (copyIn() is write(), which already copies page by page)
+void PagedMemory::copyOut(uint32_t address, uint8_t* data, uint32_t size) const {
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t a = address + i;
+    uint32_t n = PM_PAGE_SIZE - (a & PM_PAGE_MASK);
+    if (n > size - i)
+      n = size - i;
+    std::memcpy(data + i, readablePage(a) + (a & PM_PAGE_MASK), n);
+    i += n;
+  }
+}
+
+void PagedMemory::fill(uint32_t address, uint8_t value, uint32_t size) {
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t a = address + i;
+    uint32_t n = PM_PAGE_SIZE - (a & PM_PAGE_MASK);
+    if (n > size - i)
+      n = size - i;
+    if (value != 0 || readablePage(a) != _zeropage)
+      std::memset(writablePage(a) + (a & PM_PAGE_MASK), value, n);
+    i += n;
+  }
+  writtenBlock(address, size);
+}
+
+int PagedMemory::compare(uint32_t address, const uint8_t* data, uint32_t size) const {
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t a = address + i;
+    uint32_t n = PM_PAGE_SIZE - (a & PM_PAGE_MASK);
+    if (n > size - i)
+      n = size - i;
+    int diff = std::memcmp(readablePage(a) + (a & PM_PAGE_MASK), data + i, n);
+    if (diff != 0)
+      return diff;
+    i += n;
+  }
+  return 0;
+}
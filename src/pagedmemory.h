@@ -0,0 +1,163 @@
+/*
+ * pagedmemory.h -- a sparse memory device covering the whole 32-bit address space
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef PAGEDMEMORY_H
+#define PAGEDMEMORY_H
+
+#include <cstring>
+
+#include "abstractmemory.h"
+
+// Pages (the ones of the TLB)
+#define PM_PAGE_BITS    TLB_PAGE_BITS               // 4 KB pages
+#define PM_PAGE_SIZE    (1 << PM_PAGE_BITS)
+#define PM_PAGE_MASK    (PM_PAGE_SIZE - 1)
+
+// Two levels of tables : 1024 tables of 1024 pages
+#define PM_TABLE_BITS   10
+#define PM_TABLE_SIZE   (1 << PM_TABLE_BITS)
+#define PM_TABLE_MASK   (PM_TABLE_SIZE - 1)
+#define PM_DIR_SIZE     (1 << (32 - PM_PAGE_BITS - PM_TABLE_BITS))
+
+// The whole address space (getSize() cannot tell 4 GB, so it tells 4 GB - 1)
+#define PM_FULL_SIZE    0xFFFFFFFF
+
+/**
+ * This memory device gives the whole 4 GB address space to the program, but only takes host memory for the
+ * pages it has written : a program with its code near 0 and its stack near 0xFFFFxxxx only takes a few pages.
+ *
+ * The memory is divided into 4 KB pages, found through a directory of 1024 tables of 1024 pages. A page is
+ * allocated the first time something else than zeros is written in it; until then, it is the shared zero page,
+ * which reads as zeros (the null word, as in SimpleMemory). Untouched tables are the shared zero table, whose
+ * pages are all the zero page, so reading never has to test anything.
+ *
+ * As in SimpleMemory, there is no alignment verification; accesses may cross pages.
+ */
+class PagedMemory : public AbstractMemory {
+	public:
+    /**
+     * Constructor
+     * @param size size reported by getSize() (the whole address space is usable anyway)
+     */
+		PagedMemory(uint32_t size = PM_FULL_SIZE);
+    /**
+     * Destructor
+     */
+		~PagedMemory();
+
+    /**
+     * Read function
+     * @see AbstractMemory::read()
+     */
+    void read(uint32_t address, uint32_t size, uint8_t* data) const;
+    /**
+     * Write function
+     * @see AbstractMemory::write()
+     */
+    void write(uint32_t address, uint8_t* data, uint32_t size);
+
+    /**
+     * Number of pages that have been allocated (the resident set)
+     * @returns the number of pages
+     */
+    uint32_t getResidentPages() const;
+    /**
+     * Host memory taken by the allocated pages and tables
+     * @returns the size in bytes
+     */
+    uint64_t getResidentSize() const;
+
+    /**
+     * The page, or the zero page if it has not been written yet
+     * @see AbstractMemory::readablePage()
+     */
+    const uint8_t* readablePage(uint32_t address) const;
+    /**
+     * The page, allocated (and its table) if it is still the zero page
+     * @see AbstractMemory::writablePage()
+     */
+    uint8_t* writablePage(uint32_t address);
+
+    /**
+     * Block transfers, page by page : zeros are still not written in the zero page
+     * @see AbstractMemory::copyOut()
+     */
+    void copyOut(uint32_t address, uint8_t* data, uint32_t size) const;
+    void fill(uint32_t address, uint8_t value, uint32_t size);
+    int compare(uint32_t address, const uint8_t* data, uint32_t size) const;
+
+	private:
+    /**
+     * Write in a single page
+     * @param address where to write
+     * @param data data to write
+     * @param size size of the data (must not cross the page)
+     */
+    void writeInPage(uint32_t address, const uint8_t* data, uint32_t size);
+
+    /**
+     * Directory of the tables of pages
+     */
+    uint8_t** _dir[PM_DIR_SIZE];
+    /**
+     * Shared zero page and zero table
+     */
+    uint8_t* _zeropage;
+    uint8_t** _zerotable;
+    /**
+     * Allocated pages and tables
+     */
+    uint32_t _pages;
+    uint32_t _tables;
+};
+
+// Read and write are inline, so that BasicSparcEngine<PagedMemory, ...> accesses the pages directly
+inline void PagedMemory::read(uint32_t address, uint32_t size, uint8_t* data) const {
+  uint32_t offset = address & PM_PAGE_MASK;
+  if (offset + size <= PM_PAGE_SIZE) {
+    const uint8_t* page = _dir[address >> (PM_PAGE_BITS + PM_TABLE_BITS)][(address >> PM_PAGE_BITS) & PM_TABLE_MASK];
+    for (uint32_t i = 0; i < size; i++)
+      data[i] = page[offset+i];
+  } else {
+    // across two pages (or around the end of the address space)
+    for (uint32_t i = 0; i < size; i++) {
+      uint32_t a = address + i;
+      data[i] = _dir[a >> (PM_PAGE_BITS + PM_TABLE_BITS)][(a >> PM_PAGE_BITS) & PM_TABLE_MASK][a & PM_PAGE_MASK];
+    }
+  }
+}
+
+inline void PagedMemory::write(uint32_t address, uint8_t* data, uint32_t size) {
+  uint32_t offset = address & PM_PAGE_MASK;
+  if (offset + size <= PM_PAGE_SIZE) {
+    writeInPage(address, data, size);
+  } else {
+    for (uint32_t i = 0; i < size; ) {
+      uint32_t a = address + i;
+      uint32_t n = PM_PAGE_SIZE - (a & PM_PAGE_MASK);
+      if (n > size - i)
+        n = size - i;
+      writeInPage(a, data + i, n);
+      i += n;
+    }
+  }
+}
+
+inline void PagedMemory::writeInPage(uint32_t address, const uint8_t* data, uint32_t size) {
+  uint8_t* page = _dir[address >> (PM_PAGE_BITS + PM_TABLE_BITS)][(address >> PM_PAGE_BITS) & PM_TABLE_MASK];
+  if (page == _zeropage) {
+    // zeros do not need a page
+    bool zeros = true;
+    for (uint32_t i = 0; i < size && zeros; i++)
+      zeros = (data[i] == 0);
+    if (zeros)
+      return;
+    page = writablePage(address);
+  }
+  std::memcpy(page + (address & PM_PAGE_MASK), data, size);
+}
+
+#endif // PAGEDMEMORY_H
@@ -7,28 +7,24 @@
 #include "register.h"
 
 // Default cstr
-Register::Register() {
-  _content = new uint32_t;
+Register::Register() : _content(&_value), _value(0) {
 }
 
 // Cstr
-Register::Register(uint32_t* content) {
-  _content = content;
+Register::Register(uint32_t* content) : _content(content), _value(0) {
 }
 
-// Dstr
-Register::~Register() {
+// Copy cstr
+Register::Register(const Register& other) : _value(other._value) {
+  _content = (other._content == &other._value ? &_value : other._content);
 }
 
-// Acessor
-uint32_t Register::read() const {
-  return *_content;
+Register& Register::operator=(const Register& other) {
+  _value = other._value;
+  _content = (other._content == &other._value ? &_value : other._content);
+  return *this;
 }
 
-// Mutator
-void Register::write(const uint32_t value) {
-  *_content = value;
+// Dstr
+Register::~Register() {
 }
-
-
-
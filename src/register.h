@@ -14,7 +14,7 @@
 class Register {
 	public:
     /**
-     * Default constructor. Build a register with an internal content.
+     * Default constructor. Build a register with an internal content (zero).
      */
     Register();
     /**
@@ -22,6 +22,18 @@ class Register {
      * @param content pointer to the content of the register
      */
 		Register(uint32_t* content);
+    /**
+     * Copy constructor : a copy of a register with an internal content has its own, a copy of a register built
+     * from an existing content shares it
+     * @param other the register
+     */
+    Register(const Register& other);
+    /**
+     * Assignment : the same as the copy
+     * @param other the register
+     * @returns this register
+     */
+    Register& operator=(const Register& other);
     /**
      * Destructor
      */
@@ -42,7 +54,17 @@ class Register {
 
 	private:
     uint32_t* _content;
+    uint32_t _value;
 };
 
+// Accessors are inline : registers are read and written several times per instruction
+inline uint32_t Register::read() const {
+  return *_content;
+}
+
+inline void Register::write(const uint32_t value) {
+  *_content = value;
+}
+
 #endif // SPECIALREGISTER_H
 
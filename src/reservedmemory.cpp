@@ -0,0 +1,234 @@
+/*
+ * reservedmemory.cpp -- implement the ReservedMemory class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "reservedmemory.h"
+
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ReservedMemory* volatile ReservedMemory::_instances[RM_INSTANCES];
+struct sigaction ReservedMemory::_previous;
+
+// Cstr
+ReservedMemory::ReservedMemory(uint32_t size) : AbstractMemory(size), _scratches(0) {
+  _hostpage = sysconf(_SC_PAGESIZE);
+  void* base = mmap(NULL, RM_SPACE_SIZE + RM_GUARD_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED)
+    throw std::runtime_error("Cannot reserve the address space of the memory");
+  _base = (uint8_t*)base;
+
+  // Register the memory, and install the handler with the first one
+  bool first = true;
+  int slot = -1;
+  for (int k = 0; k < RM_INSTANCES; k++) {
+    if (_instances[k] != NULL)
+      first = false;
+    else if (slot < 0)
+      slot = k;
+  }
+  if (slot < 0) {
+    munmap(_base, RM_SPACE_SIZE + RM_GUARD_SIZE);
+    throw std::runtime_error("Too many reserved memories");
+  }
+  if (first) {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &_previous);
+  }
+  _instances[slot] = this;
+
+  map(0, (size == RM_FULL_SIZE ? RM_SPACE_SIZE : size));
+}
+
+// Dstr
+ReservedMemory::~ReservedMemory() {
+  bool last = true;
+  for (int k = 0; k < RM_INSTANCES; k++) {
+    if (_instances[k] == this)
+      _instances[k] = NULL;
+    else if (_instances[k] != NULL)
+      last = false;
+  }
+  if (last)
+    sigaction(SIGSEGV, &_previous, NULL);
+  munmap(_base, RM_SPACE_SIZE + RM_GUARD_SIZE);
+}
+
+// Mapping
+void ReservedMemory::map(uint32_t address, uint64_t size) {
+  uint64_t from = address & ~(_hostpage - 1);
+  uint64_t to = (address + size + _hostpage - 1) & ~(_hostpage - 1);
+  if (to > RM_SPACE_SIZE)
+    to = RM_SPACE_SIZE;
+  if (to > from)
+    mprotect(_base + from, to - from, PROT_READ | PROT_WRITE);
+}
+
+void ReservedMemory::unmap(uint32_t address, uint64_t size) {
+  uint64_t from = address & ~(_hostpage - 1);
+  uint64_t to = (address + size + _hostpage - 1) & ~(_hostpage - 1);
+  if (to > RM_SPACE_SIZE)
+    to = RM_SPACE_SIZE;
+  if (to > from) {
+    // a new anonymous mapping gives the pages back to the host
+    mmap(_base + from, to - from, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    remapAll();
+  }
+}
+
+// Map a program image
+uint32_t ReservedMemory::loadFile(const std::string& filename, uint32_t baseaddr) {
+  if ((baseaddr & (_hostpage - 1)) != 0)
+    return AbstractMemory::loadFile(filename, baseaddr);
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    if (fd >= 0)
+      close(fd);
+    throw std::runtime_error("Cannot open file " + filename);
+  }
+
+  // only what fits is mapped (and the rest of its last page, which the file fills or the host zeroes)
+  uint32_t size = (baseaddr >= getSize() ? 0 : getSize() - baseaddr);
+  if ((uint64_t)st.st_size < size)
+    size = st.st_size;
+  if (size > 0) {
+    uint64_t length = (size + _hostpage - 1) & ~(_hostpage - 1);
+    void* image = mmap(_base + baseaddr, length, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, fd, 0);
+    if (image == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Cannot map file " + filename);
+    }
+    remapAll();
+  }
+  close(fd);
+  return size;
+}
+
+// Resident set
+uint32_t ReservedMemory::getResidentPages() const {
+  uint64_t pages = RM_SPACE_SIZE / _hostpage;
+  std::vector<unsigned char> resident(pages);
+  if (mincore(_base, RM_SPACE_SIZE, resident.data()) != 0)
+    return 0;
+
+  uint32_t count = 0;
+  for (uint64_t k = 0; k < pages; k++)
+    count += resident[k] & 1;
+  return count;
+}
+
+uint64_t ReservedMemory::getResidentSize() const {
+  return (uint64_t)getResidentPages() * _hostpage;
+}
+
+// Pages for the TLB
+const uint8_t* ReservedMemory::readablePage(uint32_t address) const {
+  return _base + (address & ~TLB_PAGE_MASK);
+}
+
+uint8_t* ReservedMemory::writablePage(uint32_t address) {
+  return _base + (address & ~TLB_PAGE_MASK);
+}
+
+// Block transfers
+uint32_t ReservedMemory::chunk(uint32_t address, uint32_t size) const {
+  uint64_t n = _hostpage - (address & (_hostpage - 1));
+  return (n < size ? (uint32_t)n : size);
+}
+
+void ReservedMemory::copyIn(uint32_t address, const uint8_t* data, uint32_t size) {
+  uint32_t i = 0;
+  while (i < size && !hasFault()) {
+    uint32_t n = chunk(address + i, size - i);
+    std::memcpy(_base + (uint32_t)(address + i), data + i, n);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    i += n;
+  }
+  writtenBlock(address, size);
+}
+
+void ReservedMemory::copyOut(uint32_t address, uint8_t* data, uint32_t size) const {
+  uint32_t i = 0;
+  while (i < size && !hasFault()) {
+    uint32_t n = chunk(address + i, size - i);
+    std::memcpy(data + i, _base + (uint32_t)(address + i), n);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    i += n;
+  }
+  if (i < size)
+    std::memset(data + i, 0, size - i);
+}
+
+void ReservedMemory::fill(uint32_t address, uint8_t value, uint32_t size) {
+  uint32_t i = 0;
+  while (i < size && !hasFault()) {
+    uint32_t n = chunk(address + i, size - i);
+    std::memset(_base + (uint32_t)(address + i), value, n);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    i += n;
+  }
+  writtenBlock(address, size);
+}
+
+int ReservedMemory::compare(uint32_t address, const uint8_t* data, uint32_t size) const {
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t n = chunk(address + i, size - i);
+    int diff = std::memcmp(_base + (uint32_t)(address + i), data + i, n);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if (diff != 0 || hasFault())
+      return diff;
+    i += n;
+  }
+  return 0;
+}
+
+// Faults : the scratch pages become inaccessible again, and lose their content
+void ReservedMemory::clearFault() {
+  for (uint32_t k = 0; k < _scratches && k < RM_SCRATCH_PAGES; k++)
+    mmap(_scratch[k], _hostpage, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  _scratches = 0;
+  AbstractMemory::clearFault();
+}
+
+// The handler
+void ReservedMemory::handler(int sig, siginfo_t* info, void* context) {
+  uint8_t* host = (uint8_t*)info->si_addr;
+  for (int k = 0; k < RM_INSTANCES; k++) {
+    ReservedMemory* mem = _instances[k];
+    if (mem != NULL && host >= mem->_base && host < mem->_base + RM_SPACE_SIZE + RM_GUARD_SIZE && mem->handle(host))
+      return;
+  }
+
+  // Not ours : the previous handler, or the default action when the instruction faults again
+  if ((_previous.sa_flags & SA_SIGINFO) != 0 && _previous.sa_sigaction != NULL) {
+    _previous.sa_sigaction(sig, info, context);
+  } else if (_previous.sa_handler != SIG_DFL && _previous.sa_handler != SIG_IGN) {
+    _previous.sa_handler(sig);
+  } else {
+    signal(SIGSEGV, SIG_DFL);
+  }
+}
+
+// A fault in the reservation (called by the handler, so only async-signal-safe calls)
+bool ReservedMemory::handle(uint8_t* host) {
+  uint8_t* page = (uint8_t*)((uintptr_t)host & ~(uintptr_t)(_hostpage - 1));
+  if (mmap(page, _hostpage, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
+    return false;
+  // when the engine does not clear the faults, the scratch pages beyond the table stay mapped
+  if (_scratches < RM_SCRATCH_PAGES)
+    _scratch[_scratches] = page;
+  _scratches = _scratches + 1;
+  fault((uint32_t)(host - _base));
+  return true;
+}
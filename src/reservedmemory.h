@@ -0,0 +1,243 @@
+/*
+ * reservedmemory.h -- a memory device directly mapped on a reservation of the host address space
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef RESERVEDMEMORY_H
+#define RESERVEDMEMORY_H
+
+#include <atomic>
+#include <csignal>
+#include <cstring>
+
+#include "abstractmemory.h"
+
+// The whole guest address space, then guard pages for the accesses crossing its end
+#define RM_SPACE_SIZE     0x100000000ULL
+#define RM_GUARD_SIZE     (64 * 1024)
+
+// The whole address space (getSize() cannot tell 4 GB, so it tells 4 GB - 1)
+#define RM_FULL_SIZE      0xFFFFFFFF
+
+// Number of memories that can exist at the same time (the signal handler looks for the faults in them)
+#define RM_INSTANCES      8
+// Number of scratch pages between two calls to clearFault() (an instruction touches two pages at most)
+#define RM_SCRATCH_PAGES  8
+
+/**
+ * This memory device reserves 4 GB of the host address space (plus guard pages) when it is created, so that a
+ * guest address becomes a host address with a single addition : there is no bound nor page verification on the
+ * accesses, and an engine may read and write guest memory with plain host loads and stores at getBase() + address.
+ *
+ * The reservation is not accessible (PROT_NONE) and takes no memory. The ranges given to map() are made readable
+ * and writable; the host allocates their pages on the first access (lazily) and the pages that are only read share
+ * the zero page of the host, so a large, sparse memory only costs the pages really used.
+ *
+ * Program images are mapped from their files (see loadFile()), so loading costs nothing whatever their size, and
+ * only the pages the program touches are read.
+ *
+ * An access outside the mapped ranges raises a SIGSEGV, caught by a handler shared by every ReservedMemory : it
+ * maps a scratch page where the access has faulted and records the fault (see AbstractMemory::hasFault()). The
+ * access then completes on the scratch page (reads give zeros) and the engine raises a data access exception;
+ * clearFault() makes the scratch pages inaccessible again and drops what has been written in them. The other
+ * SIGSEGV are given to the handler that was installed before.
+ *
+ * This device needs a 64-bit POSIX host (mmap, mprotect, sigaction).
+ */
+class ReservedMemory : public AbstractMemory {
+	public:
+    /**
+     * Constructor : reserve the address space and map its beginning
+     * @param size size of the memory mapped from address 0 (RM_FULL_SIZE for the whole address space)
+     * @throws std::runtime_error if the host cannot reserve the address space
+     */
+		ReservedMemory(uint32_t size = RM_FULL_SIZE);
+    /**
+     * Destructor
+     */
+		~ReservedMemory();
+
+    /**
+     * Make a range of the memory accessible
+     * @param address beginning of the range (rounded down to a host page)
+     * @param size size of the range (rounded up to host pages)
+     */
+    void map(uint32_t address, uint64_t size);
+    /**
+     * Make a range of the memory inaccessible again; its content is lost
+     * @param address beginning of the range (rounded down to a host page)
+     * @param size size of the range (rounded up to host pages)
+     */
+    void unmap(uint32_t address, uint64_t size);
+
+    /**
+     * Map a file (a program image) in the memory, copy-on-write : nothing is read until the program touches a
+     * page, and a page is copied when the program writes it (the file is never modified). When the base address
+     * is not at the beginning of a host page, the file is copied as by AbstractMemory.
+     * @see AbstractMemory::loadFile()
+     */
+    uint32_t loadFile(const std::string& filename, uint32_t baseaddr = 0);
+
+    /**
+     * Where the guest memory begins in the host address space
+     * @returns host address of the guest address 0
+     */
+    uint8_t* getBase() const;
+
+    /**
+     * Number of host pages that are in the host memory (the resident set; the pages of a mapped file count as soon
+     * as the host has them in its cache)
+     * @returns the number of pages
+     */
+    uint32_t getResidentPages() const;
+    /**
+     * Host memory taken by the allocated pages
+     * @returns the size in bytes
+     */
+    uint64_t getResidentSize() const;
+
+    /**
+     * Read function
+     * @see AbstractMemory::read()
+     */
+    void read(uint32_t address, uint32_t size, uint8_t* data) const;
+    /**
+     * Write function
+     * @see AbstractMemory::write()
+     */
+    void write(uint32_t address, uint8_t* data, uint32_t size);
+
+    /**
+     * Every page is in the reservation (it faults if it is not mapped)
+     * @see AbstractMemory::readablePage()
+     */
+    const uint8_t* readablePage(uint32_t address) const;
+    /**
+     * @see AbstractMemory::writablePage()
+     */
+    uint8_t* writablePage(uint32_t address);
+
+    /**
+     * Fast paths : a single addition and a byte swap
+     * @see AbstractMemory::load32()
+     */
+    uint32_t load32(uint32_t address) const;
+    uint16_t load16(uint32_t address) const;
+    uint64_t load64(uint32_t address) const;
+    uint32_t fetch32(uint32_t address) const;
+    void store32(uint32_t address, uint32_t data);
+    void store16(uint32_t address, uint16_t data);
+
+    /**
+     * Block transfers : memcpy(), memset() and memcmp() a host page at a time, up to the first fault (the rest reads
+     * zeros and is not written), so that a block in an unmapped range takes a single scratch page
+     * @see AbstractMemory::copyIn()
+     */
+    void copyIn(uint32_t address, const uint8_t* data, uint32_t size);
+    void copyOut(uint32_t address, uint8_t* data, uint32_t size) const;
+    void fill(uint32_t address, uint8_t value, uint32_t size);
+    int compare(uint32_t address, const uint8_t* data, uint32_t size) const;
+
+    /**
+     * Drop the scratch pages
+     * @see AbstractMemory::clearFault()
+     */
+    void clearFault();
+
+	private:
+    /**
+     * The SIGSEGV handler
+     * @param sig the signal
+     * @param info where the fault is
+     * @param context context of the thread
+     */
+    static void handler(int sig, siginfo_t* info, void* context);
+    /**
+     * Handle a fault in the reservation of this memory
+     * @param host host address of the fault
+     * @returns false if the scratch page cannot be mapped
+     */
+    bool handle(uint8_t* host);
+    /**
+     * Size of the part of a block in the host page of its beginning
+     * @param address beginning of the block
+     * @param size size of the block
+     * @returns the size of the part
+     */
+    uint32_t chunk(uint32_t address, uint32_t size) const;
+
+    /**
+     * Host address of the guest address 0 (the reservation)
+     */
+    uint8_t* _base;
+    /**
+     * Size of the host pages
+     */
+    uint64_t _hostpage;
+    /**
+     * Scratch pages mapped since the last clearFault()
+     */
+    uint8_t* _scratch[RM_SCRATCH_PAGES];
+    volatile uint32_t _scratches;
+
+    /**
+     * Every memory, for the handler, and the handler that was installed before the first one
+     */
+    static ReservedMemory* volatile _instances[RM_INSTANCES];
+    static struct sigaction _previous;
+};
+
+/*
+ * Accesses are inline, so that BasicSparcEngine<ReservedMemory, ...> makes host loads and stores. The signal fence
+ * keeps the compiler from reading the fault flag before the access that may set it.
+ */
+inline void ReservedMemory::read(uint32_t address, uint32_t size, uint8_t* data) const {
+  std::memcpy(data, _base + address, size);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline void ReservedMemory::write(uint32_t address, uint8_t* data, uint32_t size) {
+  std::memcpy(_base + address, data, size);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline uint32_t ReservedMemory::load32(uint32_t address) const {
+  uint32_t data;
+  std::memcpy(&data, _base + address, 4);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  return bigEndian32(data);
+}
+
+inline uint16_t ReservedMemory::load16(uint32_t address) const {
+  uint16_t data;
+  std::memcpy(&data, _base + address, 2);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  return littleEndian16(data); // see AbstractMemory::readHalfword()
+}
+
+inline uint64_t ReservedMemory::load64(uint32_t address) const {
+  return ((uint64_t)load32(address) << 32) | (uint64_t)load32(address + 4);
+}
+
+inline uint32_t ReservedMemory::fetch32(uint32_t address) const {
+  return load32(address);
+}
+
+inline void ReservedMemory::store32(uint32_t address, uint32_t data) {
+  data = bigEndian32(data);
+  std::memcpy(_base + address, &data, 4);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline void ReservedMemory::store16(uint32_t address, uint16_t data) {
+  data = bigEndian16(data);
+  std::memcpy(_base + address, &data, 2);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline uint8_t* ReservedMemory::getBase() const {
+  return _base;
+}
+
+#endif // RESERVEDMEMORY_H
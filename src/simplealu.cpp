@@ -4,13 +4,22 @@
 #include "simplealu.h"
 
 // Cstr
-SimpleALU::SimpleALU(SpecialRegister* psr, Register* y) : AbstractALU(psr, y) {
+SimpleALU::SimpleALU(SpecialRegister* psr, Register* y) : AbstractALU(psr, y), _serial(false) {
 }
 
 // Dstr
 SimpleALU::~SimpleALU() {
 }
 
+// Multiplication and division mode
+void SimpleALU::setSerialMulDiv(bool serial) {
+  _serial = serial;
+}
+
+bool SimpleALU::isSerialMulDiv() const {
+  return _serial;
+}
+
 // Shift left for two registers
 void SimpleALU::shiftLeftDual(uint32_t nb, Register* reven, Register* rodd) {
   uint32_t re = reven->read();
@@ -67,32 +76,54 @@ void SimpleALU::umult(uint32_t multiplicand, uint32_t multiplier, Register* rd)
   rd->write(0);
   writeY(multiplier);
   for (uint32_t i = 0; i < 32; i++) {
-    if (readY() & 0x00000001 == 1) {
-      rd->write(multiplicand + rd->read());
+    bool carry = false;
+    if ((readY() & 0x00000001) == 1) {
+      uint32_t sum = multiplicand + rd->read();
+      carry = (sum < multiplicand); // 33rd bit of the partial product
+      rd->write(sum);
     }
     shiftRightDual(1, rd, getY());
+    if (carry)
+      rd->write(rd->read() | 0x80000000);
   }
 }
 
-// Unsigned division algorithm
+// Unsigned division algorithm (restoring)
 void SimpleALU::udiv(uint32_t dividend, uint32_t divisor, Register* rd) {
   writeY(0);
   rd->write(dividend);
 
   for (uint32_t i = 0; i < 32; i++) {
-    if (ISNEG(readY())) {
-      shiftLeftDual(1, getY(), rd);
-      writeY(readY() + divisor);
-    } else {
-      shiftLeftDual(1, getY(), rd);
+    // the partial rest takes 33 bits : the one shifted out of y is its most significant bit
+    bool high = ISNEG(readY());
+    shiftLeftDual(1, getY(), rd);
+
+    if (high || readY() >= divisor) {
       writeY(readY() - divisor);
+      rd->write(rd->read() | 0x00000001);
     }
-
-    rd->write(rd->read() + (ISNEG(readY()) ? 0 : 1));
   }
+}
 
-  if (ISNEG(readY())) {
-    writeY(readY() + divisor);
+// Multiplication by the host
+void SimpleALU::nativeMult(uint32_t multiplicand, uint32_t multiplier, bool sign, Register* rd) {
+  uint64_t res;
+  if (sign)
+    res = (uint64_t)((int64_t)(int32_t)multiplicand * (int64_t)(int32_t)multiplier);
+  else
+    res = (uint64_t)multiplicand * (uint64_t)multiplier;
+  rd->write((uint32_t)(res >> 32));
+  writeY((uint32_t)res);
+}
+
+// Division by the host
+void SimpleALU::nativeDiv(uint32_t dividend, uint32_t divisor, Register* rd) {
+  if (divisor == 0) {
+    rd->write(0xFFFFFFFF);
+    writeY(dividend);
+  } else {
+    rd->write(dividend / divisor);
+    writeY(dividend % divisor);
   }
 }
 
@@ -108,18 +139,7 @@ void SimpleALU::calc(uint8_t op, const Register* rs1, uint32_t simm, Register* r
 
   // Shift operation
   if (optype == 2) {
-    uint32_t value = rs1->read();
-    
-    if (op == ALU_OP_SLL) { // shift left
-      rd->write(value << simm);
-    } else { // shift right
-      uint32_t res = value >> simm;
-
-      if (op == ALU_OP_SRA) // artihmetic shift (extends sign if needed)
-        res = signext(res, 32 - simm);
-
-      rd->write(res);
-    }
+    rd->write(shift(op, rs1->read(), simm));
   }
   // Any other operation (because they came in two versions, which is not the cas of shifts)
   else {
@@ -128,7 +148,9 @@ void SimpleALU::calc(uint8_t op, const Register* rs1, uint32_t simm, Register* r
       uint32_t value = rs1->read();
       
       // If a signed multiplication is asked, we just unsignedly multiply magnitudes, and then apply the sign rule
-      if (mainop == ALU_OP_SMUL) {
+      if (!_serial) {
+        nativeMult(value, simm, mainop == ALU_OP_SMUL, rd);
+      } else if (mainop == ALU_OP_SMUL) {
         umult(ISNEG(value) ? COMPL32(value) : value,
               ISNEG(simm) ? COMPL32(simm) : simm,
               rd);
@@ -150,7 +172,9 @@ void SimpleALU::calc(uint8_t op, const Register* rs1, uint32_t simm, Register* r
       uint32_t value = rs1->read();
       
       // If a signed division is asked, we just unsignedly divide magnitudes, and then apply the sign rule
-      if (mainop == ALU_OP_SMUL) {
+      if (!_serial) {
+        nativeDiv(value, simm, rd); // as the algorithm below, SDIV is unsigned for now
+      } else if (mainop == ALU_OP_SMUL) {
         udiv(ISNEG(value) ? COMPL32(value) : value,
              ISNEG(simm) ? COMPL32(simm) : simm,
              rd);
@@ -171,32 +195,19 @@ void SimpleALU::calc(uint8_t op, const Register* rs1, uint32_t simm, Register* r
       // every other cases : standard, non-algorithmics operations
       uint32_t value = rs1->read();
       uint32_t res;
+      uint8_t kind = ALU_CC_LOGIC;
 
       switch (mainop) {
         // Arithmetics
         case ALU_OP_ADD:
         case ALU_OP_ADDX: // ADDX is extended add : it adds to the result the carry condition flag
           res = value + simm + (mainop == ALU_OP_ADDX ? (getC() ? 1 : 0) : 0);
-          if (optype == 1) { // modify ICC
-            if (sub(value, 31, 1) == sub(simm, 31, 1))
-              setV(sub(res, 31, 1) != sub(value, 31, 1));
-            else
-              setV(false);
-
-            setC(res < value || res < simm);
-          }
+          kind = ALU_CC_ADD;
           break;
         case ALU_OP_SUB:
         case ALU_OP_SUBX: // SUBX is extend sub : it subs from the result the carry condition flag
           res = value - simm - (mainop == ALU_OP_SUBX ? (getC() ? 1 : 0) : 0);
-          if (optype == 1) { // modify ICC
-            if (sub(value, 31, 1) != sub(simm, 31, 1))
-              setV(sub(res, 31, 1) != sub(value, 31, 1));
-            else
-              setV(false);
-
-            setC(res > value || res > simm);
-          }
+          kind = ALU_CC_SUB;
           break;
         // Logical
         case ALU_OP_AND:
@@ -213,15 +224,8 @@ void SimpleALU::calc(uint8_t op, const Register* rs1, uint32_t simm, Register* r
           break;
       }
 
-      if (optype == 1) { // modify ICC
-        setZ(res == 0);
-        setN(ISNEG(res));
-        if (mainop != ALU_OP_ADD && mainop != ALU_OP_SUB &&
-            mainop != ALU_OP_ADDX && mainop != ALU_OP_SUBX) {
-          setC(false);
-          setV(false);
-        }
-      }
+      if (optype == 1) // modify ICC (maybe lazily, see AbstractALU)
+        setFlags(kind, value, simm, res);
       rd->write(res);
     }
   }
@@ -10,6 +10,11 @@
  * The SimpleALU class defines a simple arithmetic and logic unit for use in the SPARC engine.
  * It is simple as it is not quite reallisic; reals algorithms are used for multiplication and division, but not for any other operation. Plus, every operations are done in 1 cycle, which is wrong !
  * It is a good base though.
+ *
+ * Multiplications and divisions are made either by the host (native mode, the default), which computes the 64-bit
+ * result at once, or by the shift-and-add and shift-and-subtract algorithms (serial mode), one bit per step, for
+ * teaching and verification. Both modes give the same results : rd gets the most significant word of a product and
+ * Y the least significant one; rd gets the quotient of a division and Y the rest.
  */
 class SimpleALU : public AbstractALU {
 	public:
@@ -35,6 +40,17 @@ class SimpleALU : public AbstractALU {
      */
     void calc(uint8_t op, const Register* rs1, uint32_t simm, Register* rd);
 
+    /**
+     * Choose how multiplications and divisions are made
+     * @param serial true for the bit-serial algorithms, false for the host operations
+     */
+    void setSerialMulDiv(bool serial);
+    /**
+     * Tells if multiplications and divisions are made by the bit-serial algorithms
+     * @returns true in serial mode
+     */
+    bool isSerialMulDiv() const;
+
     /**
      * Substract a value from a double word represented by two aligned registers.
      * This makes the 64 bit substraction : even|odd = even|odd - term; with even as the MSB register and odd as the LSB one
@@ -78,6 +94,22 @@ class SimpleALU : public AbstractALU {
 	protected:
 
 	private:
+    /**
+     * Multiplication with the host operation
+     * @param multiplicand left number of the product
+     * @param multiplier right number of the product
+     * @param sign true for a signed multiplication
+     * @param rd destination register
+     */
+    void nativeMult(uint32_t multiplicand, uint32_t multiplier, bool sign, Register* rd);
+    /**
+     * Unsigned division with the host operation; a division by zero gives 0xFFFFFFFF with the dividend as rest, as
+     * the algorithm does.
+     * @param dividend left number of the division
+     * @param divisor right number of the division
+     * @param rd destination register
+     */
+    void nativeDiv(uint32_t dividend, uint32_t divisor, Register* rd);
     /**
      * Unsigned multiplication algorithm (quite standard).
      * @param multiplicand left number of the product
@@ -94,6 +126,10 @@ class SimpleALU : public AbstractALU {
      */
     void udiv(uint32_t dividend, uint32_t divisor, Register* rd);
 
+    /**
+     * Are multiplications and divisions made by the algorithms ?
+     */
+    bool _serial;
 };
 
 #endif // SIMPLEALU_H
@@ -5,25 +5,63 @@
 
 // Cstr
 SimpleMemory::SimpleMemory(uint32_t size) : AbstractMemory(size) {
-  _content = new uint8_t[size];
+  _content = new uint8_t[size](); // zeroed : the null word stops the engine
 }
 
 // Dstr
 SimpleMemory::~SimpleMemory() {
-  delete _content;
+  delete[] _content;
 }
 
-// Read
-void SimpleMemory::read(uint32_t address, uint32_t size, uint8_t* data) const {
-  for (uint32_t i = 0; i < size; i++)
-    data[i] = _content[address+i];
+// Pages for the TLB
+const uint8_t* SimpleMemory::readablePage(uint32_t address) const {
+  uint32_t page = address & ~TLB_PAGE_MASK;
+  if ((uint64_t)page + TLB_PAGE_SIZE > getSize())
+    return NULL;
+  return _content + page;
 }
 
-// Write
-void SimpleMemory::write(uint32_t address, uint8_t* data, uint32_t size) {
-  for (uint32_t i = 0; i < size; i++)
-    _content[address+i] = data[i];
+uint8_t* SimpleMemory::writablePage(uint32_t address) {
+  return const_cast<uint8_t*>(readablePage(address));
 }
 
+// Block transfers : what is beyond the end reads zeros and is not written
+uint32_t SimpleMemory::within(uint32_t address, uint32_t size) const {
+  uint32_t n = (address >= getSize() ? 0 : getSize() - address);
+  if (n >= size)
+    return size;
+  if (isStrict())
+    fault(address + n);
+  return n;
+}
+
+void SimpleMemory::copyIn(uint32_t address, const uint8_t* data, uint32_t size) {
+  uint32_t n = within(address, size);
+  if (n == 0)
+    return;
+  std::memcpy(_content + address, data, n);
+  writtenBlock(address, n);
+}
 
+void SimpleMemory::copyOut(uint32_t address, uint8_t* data, uint32_t size) const {
+  uint32_t n = within(address, size);
+  if (n > 0)
+    std::memcpy(data, _content + address, n);
+  std::memset(data + n, 0, size - n);
+}
 
+void SimpleMemory::fill(uint32_t address, uint8_t value, uint32_t size) {
+  uint32_t n = within(address, size);
+  if (n == 0)
+    return;
+  std::memset(_content + address, value, n);
+  writtenBlock(address, n);
+}
+
+int SimpleMemory::compare(uint32_t address, const uint8_t* data, uint32_t size) const {
+  uint32_t n = within(address, size);
+  int diff = (n > 0 ? std::memcmp(_content + address, data, n) : 0);
+  for (uint32_t i = n; diff == 0 && i < size; i++)
+    diff = -(int)data[i]; // zeros beyond the end
+  return diff;
+}
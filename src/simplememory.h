@@ -4,12 +4,17 @@
 #ifndef SIMPLEMEMORY_H
 #define SIMPLEMEMORY_H
 
+#include <cstring>
+
 #include "abstractmemory.h"
 
 /**
  * This class is a simple memory device for use with the kSPARC engine.
  * It is not reallistic as every access is done in 1 cycle and there is no alignment verification.
  * This is a good base though
+ *
+ * The accesses are checked against the size of the device : beyond it, reads give zeros (the null word) and
+ * writes are dropped, and in strict mode the access faults (see AbstractMemory::setStrict()).
  */
 class SimpleMemory : public AbstractMemory {
 	public:
@@ -34,9 +39,119 @@ class SimpleMemory : public AbstractMemory {
      */
     void write(uint32_t address, uint8_t* data, uint32_t size);
 
+    /**
+     * Pages are in the buffer (except the last one if it is not complete)
+     * @see AbstractMemory::readablePage()
+     */
+    const uint8_t* readablePage(uint32_t address) const;
+    /**
+     * @see AbstractMemory::writablePage()
+     */
+    uint8_t* writablePage(uint32_t address);
+
+    /**
+     * Fast paths : a direct access to the buffer and a byte swap
+     * @see AbstractMemory::load32()
+     */
+    uint32_t load32(uint32_t address) const;
+    uint16_t load16(uint32_t address) const;
+    uint64_t load64(uint32_t address) const;
+    uint32_t fetch32(uint32_t address) const;
+    void store32(uint32_t address, uint32_t data);
+    void store16(uint32_t address, uint16_t data);
+
+    /**
+     * Block transfers : memcpy(), memset() and memcmp() on the buffer, up to its end
+     * @see AbstractMemory::copyIn()
+     */
+    void copyIn(uint32_t address, const uint8_t* data, uint32_t size);
+    void copyOut(uint32_t address, uint8_t* data, uint32_t size) const;
+    void fill(uint32_t address, uint8_t value, uint32_t size);
+    int compare(uint32_t address, const uint8_t* data, uint32_t size) const;
+
 	private:
+    /**
+     * Check the bounds of an access, and fault in strict mode if it goes beyond them
+     * @param address address of the access
+     * @param size size of the access
+     * @returns true if the access is inside the device
+     */
+    bool inside(uint32_t address, uint32_t size) const;
+    /**
+     * Check the bounds of a block, and fault in strict mode if it goes beyond them
+     * @param address address of the block
+     * @param size size of the block
+     * @returns the size of the part of the block inside the device
+     */
+    uint32_t within(uint32_t address, uint32_t size) const;
+
     uint8_t* _content;
 };
 
+// A comparison on 64 bits, so that the accesses around the end of the address space are out too
+inline bool SimpleMemory::inside(uint32_t address, uint32_t size) const {
+  if ((uint64_t)address + size <= getSize())
+    return true;
+  if (isStrict())
+    fault(address);
+  return false;
+}
+
+// Read and write are inline, so that BasicSparcEngine<SimpleMemory, ...> accesses the content directly
+inline void SimpleMemory::read(uint32_t address, uint32_t size, uint8_t* data) const {
+  if (!inside(address, size)) {
+    std::memset(data, 0, size);
+    return;
+  }
+  for (uint32_t i = 0; i < size; i++)
+    data[i] = _content[address+i];
+}
+
+inline void SimpleMemory::write(uint32_t address, uint8_t* data, uint32_t size) {
+  if (!inside(address, size))
+    return;
+  for (uint32_t i = 0; i < size; i++)
+    _content[address+i] = data[i];
+}
+
+// Fast paths (memcpy() makes a single load or store, aligned or not)
+inline uint32_t SimpleMemory::load32(uint32_t address) const {
+  if (!inside(address, 4))
+    return 0;
+  uint32_t data;
+  std::memcpy(&data, _content + address, 4);
+  return bigEndian32(data);
+}
+
+inline uint16_t SimpleMemory::load16(uint32_t address) const {
+  if (!inside(address, 2))
+    return 0;
+  uint16_t data;
+  std::memcpy(&data, _content + address, 2);
+  return littleEndian16(data); // see AbstractMemory::readHalfword()
+}
+
+inline uint64_t SimpleMemory::load64(uint32_t address) const {
+  return ((uint64_t)load32(address) << 32) | (uint64_t)load32(address + 4);
+}
+
+inline uint32_t SimpleMemory::fetch32(uint32_t address) const {
+  return load32(address);
+}
+
+inline void SimpleMemory::store32(uint32_t address, uint32_t data) {
+  if (!inside(address, 4))
+    return;
+  data = bigEndian32(data);
+  std::memcpy(_content + address, &data, 4);
+}
+
+inline void SimpleMemory::store16(uint32_t address, uint16_t data) {
+  if (!inside(address, 2))
+    return;
+  data = bigEndian16(data);
+  std::memcpy(_content + address, &data, 2);
+}
+
 #endif // SIMPLEMEMORY_H
 
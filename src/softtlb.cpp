@@ -0,0 +1,53 @@
+/*
+ * softtlb.cpp -- implement the SoftTLB class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "softtlb.h"
+
+// Cstr
+SoftTLB::SoftTLB() : _hits(0), _misses(0) {
+  flush();
+}
+
+// Dstr
+SoftTLB::~SoftTLB() {
+}
+
+// Enter a page
+void SoftTLB::fill(uint32_t address, uint8_t* page, bool writable) {
+  Entry& e = _entries[(address >> TLB_PAGE_BITS) & (TLB_ENTRIES - 1)];
+  e.tag = address >> TLB_PAGE_BITS;
+  e.page = page;
+  e.writable = writable;
+}
+
+// Invalidation
+void SoftTLB::invalidate(uint32_t address) {
+  Entry& e = _entries[(address >> TLB_PAGE_BITS) & (TLB_ENTRIES - 1)];
+  if (e.tag == (address >> TLB_PAGE_BITS))
+    e.tag = TLB_INVALID;
+}
+
+void SoftTLB::flush() {
+  for (uint32_t k = 0; k < TLB_ENTRIES; k++) {
+    _entries[k].tag = TLB_INVALID;
+    _entries[k].page = NULL;
+    _entries[k].writable = false;
+  }
+}
+
+// Counters
+uint64_t SoftTLB::getHits() const {
+  return _hits;
+}
+
+uint64_t SoftTLB::getMisses() const {
+  return _misses;
+}
+
+void SoftTLB::resetCounters() {
+  _hits = 0;
+  _misses = 0;
+}
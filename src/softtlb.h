@@ -0,0 +1,126 @@
+/*
+ * softtlb.h -- a software translation lookaside buffer, from guest pages to host memory
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef SOFTTLB_H
+#define SOFTTLB_H
+
+#include "utils.h"
+
+// Pages seen by the TLB (the same as PagedMemory)
+#define TLB_PAGE_BITS   12
+#define TLB_PAGE_SIZE   (1 << TLB_PAGE_BITS)
+#define TLB_PAGE_MASK   (TLB_PAGE_SIZE - 1)
+
+// Number of entries (a power of two : direct-mapped on the low bits of the page number)
+#define TLB_ENTRIES     256
+
+// Tag of an empty entry (page numbers only take 20 bits)
+#define TLB_INVALID     0xFFFFFFFF
+
+/**
+ * A direct-mapped software TLB : it remembers, for a few guest pages, where they are in the host memory, so that
+ * the memory devices which are not a single flat buffer (see AbstractMemory::hostPage()) do not have to look for
+ * the page on each access.
+ *
+ * An entry tells if the page can be written through it; a page that is only readable (the shared zero page of
+ * PagedMemory, for instance) is entered again when it is written. The memory device must invalidate the entries
+ * of a page whose host memory changes (remapping).
+ *
+ * The number of hits and misses is counted.
+ */
+class SoftTLB {
+	public:
+    /**
+     * Constructor : every entry is empty
+     */
+		SoftTLB();
+    /**
+     * Destructor
+     */
+		~SoftTLB();
+
+    /**
+     * Look for a page to read
+     * @param address guest address
+     * @returns host address of the byte, or NULL if the page is not in the TLB
+     */
+    uint8_t* lookup(uint32_t address);
+    /**
+     * Look for a page to write
+     * @param address guest address
+     * @returns host address of the byte, or NULL if the page is not in the TLB or cannot be written through it
+     */
+    uint8_t* lookupWritable(uint32_t address);
+    /**
+     * Enter a page in the TLB (replacing the one of the same entry)
+     * @param address an address in the page
+     * @param page host address of the beginning of the page
+     * @param writable true if the page can be written through this entry
+     */
+    void fill(uint32_t address, uint8_t* page, bool writable);
+
+    /**
+     * Remove a page from the TLB
+     * @param address an address in the page
+     */
+    void invalidate(uint32_t address);
+    /**
+     * Remove every page from the TLB
+     */
+    void flush();
+
+    /**
+     * Number of accesses found in the TLB
+     * @returns the number of hits
+     */
+    uint64_t getHits() const;
+    /**
+     * Number of accesses not found in the TLB
+     * @returns the number of misses
+     */
+    uint64_t getMisses() const;
+    /**
+     * Set the counters back to zero
+     */
+    void resetCounters();
+
+	private:
+    /**
+     * An entry : page number, where it is, and if it can be written
+     */
+    struct Entry {
+      uint32_t tag;
+      uint8_t* page;
+      bool writable;
+    };
+
+    Entry _entries[TLB_ENTRIES];
+    uint64_t _hits;
+    uint64_t _misses;
+};
+
+// Lookups are inline : they are made on each memory access
+inline uint8_t* SoftTLB::lookup(uint32_t address) {
+  const Entry& e = _entries[(address >> TLB_PAGE_BITS) & (TLB_ENTRIES - 1)];
+  if (e.tag == (address >> TLB_PAGE_BITS)) {
+    _hits++;
+    return e.page + (address & TLB_PAGE_MASK);
+  }
+  _misses++;
+  return NULL;
+}
+
+inline uint8_t* SoftTLB::lookupWritable(uint32_t address) {
+  const Entry& e = _entries[(address >> TLB_PAGE_BITS) & (TLB_ENTRIES - 1)];
+  if (e.tag == (address >> TLB_PAGE_BITS) && e.writable) {
+    _hits++;
+    return e.page + (address & TLB_PAGE_MASK);
+  }
+  _misses++;
+  return NULL;
+}
+
+#endif // SOFTTLB_H
@@ -3,11 +3,13 @@
  */
 #include "sparcengine.h"
 
+#include <cstring>
+
 // Cstr
 SparcEngine::SparcEngine(
     AbstractMemory* mem,
     AbstractALU* alu,
-    /*AbstractFPU* fpu,*/
+    AbstractFPU* fpu,
     WindowRegisters* registers,
     SpecialRegister* psr,
     SpecialRegister* wim,
@@ -16,15 +18,27 @@ SparcEngine::SparcEngine(
     SpecialRegister* pc,
     SpecialRegister* npc,
     SpecialRegister* fsr
-) : AbstractSparcEngine(mem, alu/*, fpu*/, registers, psr, wim, tbr, y, pc, npc, fsr) {
+) : AbstractSparcEngine(mem, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr) {
+  _usedcache = true;
+  _windowspill = false;
+  _spills = 0;
+  _fills = 0;
+  _stop = SE_STOP_NONE;
+  _trapped = false;
+  _executed = 0;
+  for (uint32_t asi = 0; asi < SE_ASI_COUNT; asi++)
+    _spaces[asi] = mem;
+  mem->setFetchListener(this);
 }
 
 // Dstr
 SparcEngine::~SparcEngine() {
+  memory()->setFetchListener(NULL);
 }
 
 // (Re-)initialize the engine
 void SparcEngine::init() {
+  alu()->syncFlags(); // nothing pending may overwrite the new condition codes
   psr()->setField(PSR_IMPL, SE_IMPL); // impl 1
   psr()->setField(PSR_VERS, SE_VERS); // vers 1
   psr()->setField(PSR_ICC, 0);
@@ -35,16 +49,25 @@ void SparcEngine::init() {
   psr()->setField(PSR_PS, 0);
   psr()->setField(PSR_ET, 0);         // traps disabled
   psr()->setField(PSR_CWP, 0);        // current windows : 0
+  registers()->update();
 
   wim()->write(0);
   tbr()->write(SE_TRAPS_BASE_ADDR);
   pc()->write(0xFFFFFFFF);
   npc()->write(0);
 
-  // TODO: initialize fsr
- 
+  fpu()->reset(); // round to nearest, no exception enabled
+
   _branch = false;
   _isdcti = false;
+  _stop = SE_STOP_NONE;
+  _trapped = false;
+  _executed = 0;
+  _spills = 0;
+  _fills = 0;
+
+  // The memory may have been (re)loaded since the last run
+  _dcache.clear();
 }
 
 // Execute next instruction
@@ -53,277 +76,576 @@ bool SparcEngine::next() {
   pc()->write(npc()->read());
   
   // Read the instruction
-  Instruction inst = memory()->readInstruction(pc()->read());
+  const DecodedInstruction& inst = fetch(pc()->read());
 
   // This special instruction (which correspond to "cbn 0x00000000" is simply ignored, as it is a basic state of the memory
-  if (inst.getContent() == 0x00000000)
-    return true;
+  if (inst.handler == DI_HALT) {
+    _stop = SE_STOP_HALT;
+    return false;
+  }
 
-  // Get the main operator
-  uint32_t op = inst.getField(INST_OP);
+  _stop = SE_STOP_NONE;
+  _trapped = false;
+  execute(inst);
 
-  if (op == INST_OP_BR) {
-    // Branches and SETHI
-    uint32_t op2 = inst.getField(INST_OP2);
+  // The instruction could not be executed : we stay on it
+  if (_stop != SE_STOP_NONE) {
+    npc()->write(pc()->read());
+    return false;
+  }
+  _executed++;
 
-    if (op2 == INST_OP2_SETHI) {
-      // Set high
-      uint32_t rd = inst.getField(INST_RD);
-      registers()->write(rd, 0);
-      registers()->write(rd, inst.getField(INST_IMM22) << 10);
-    } else if (op2 == INST_OP2_BICC) {
-      // Branches
-      uint32_t rawcond = inst.getField(INST_COND);
-      bool neg = (rawcond >> 3) == 1;
-      uint8_t cond = ((uint8_t)rawcond) & 0x07;
-      bool a = inst.getField(INST_A) == 1;
-      _dcti = pc()->read() + (signext(inst.getField(INST_DISP22), 22) << 2);
-      Logger::log() << "dcti = " << pc()->read() << " - " << COMPL32((signext(inst.getField(INST_DISP22), 22) << 2)) << "\n";
-      bool Z = (psr()->getField(PSR_ICC_Z) == 1),
-           N = (psr()->getField(PSR_ICC_N) == 1),
-           C = (psr()->getField(PSR_ICC_C) == 1),
-           V = (psr()->getField(PSR_ICC_V) == 1);
-
-      Logger::log() << "Branch ! Z=" << Z << ";N=" << N << ";C=" << C << ";V=" << V << "\n";
-
-      // Calculate if we branch
-      switch (cond) {
-        case INST_COND_NEVER:
-          _branch = false;
-          break;
-        case INST_COND_EQ:
-          _branch = Z;
-          break;
-        case INST_COND_LET:
-          _branch = Z || (N ^ V);
-          break;
-        case INST_COND_LT:
-          _branch = N ^ V;
-          break;
-        case INST_COND_ULET:
-          _branch = C || Z;
-          break;
-        case INST_COND_CSET:
-          _branch = C;
-          break;
-        case INST_COND_NEG:
-          _branch = N;
-          break;
-        case INST_COND_OSET:
-          _branch = V;
+  // Position the next pc
+  if (_branch) {
+    if (_isdcti) {
+      Logger::log("Executing DCTI...");
+      alu()->calc(ALU_OP_ADD, pc(), 4, npc());
+      _isdcti = false;
+    } else {
+      Logger::log("Execution Branch !");
+      npc()->write(_dcti);
+      _branch = false;
+    }
+  } else {
+    alu()->calc(ALU_OP_ADD, pc(), 4, npc());
+  }
+  Logger::log() << "New nPC calculated : " << std::hex << npc()->read() << std::endl; 
+
+  alu()->syncFlags();
+  return true;
+}
+
+// Run the engine
+// (the condition codes are made up to date for the caller, see AbstractALU)
+uint32_t SparcEngine::run(uint64_t maxInstructions) {
+  registers()->update(); // the PSR may have been written while the engine was stopped
+  uint32_t reason = runBatch(maxInstructions, SE_NO_BREAKPOINT);
+  alu()->syncFlags();
+  return reason;
+}
+
+uint32_t SparcEngine::runUntil(uint32_t address, uint64_t maxInstructions) {
+  registers()->update();
+  uint32_t reason = runBatch(maxInstructions, address);
+  alu()->syncFlags();
+  return reason;
+}
+
+uint32_t SparcEngine::runUntilHalt() {
+  registers()->update();
+  uint32_t reason = runBatch(SE_UNLIMITED, SE_NO_BREAKPOINT);
+  alu()->syncFlags();
+  return reason;
+}
+
+uint64_t SparcEngine::getInstructionCount() const {
+  return _executed;
+}
+
+// Main loop
+uint32_t SparcEngine::runBatch(uint64_t count, uint32_t breakpoint) {
+  for (uint64_t n = 0; n < count; n++) {
+    if (npc()->read() == breakpoint)
+      return SE_STOP_BREAKPOINT;
+    if (!next())
+      return _stop;
+  }
+  return SE_STOP_BUDGET;
+}
+
+// Fetch and decode an instruction
+const DecodedInstruction& SparcEngine::fetch(uint32_t address) {
+  const DecodedInstruction* di = (_usedcache ? _dcache.lookup(address) : NULL);
+  if (di != NULL)
+    return *di;
+
+  _decoded = DecodedInstruction::decode(memory()->readInstruction(address));
+  if (memory()->hasFault()) {
+    // nothing there, or not executable : an instruction access exception, not cached (the memory may be mapped later)
+    memory()->clearFault();
+    _decoded = DecodedInstruction();
+    _decoded.handler = DI_IFAULT;
+    return _decoded;
+  }
+  if (!_usedcache)
+    return _decoded;
+
+  // The next instructions of the page are likely to come next (the rest of a block, a loop)
+  uint32_t count;
+  const uint8_t* run = memory()->fetchRun(address, count);
+  for (uint32_t k = 1; k < count && k <= SE_FETCH_AHEAD; k++) {
+    uint32_t word;
+    std::memcpy(&word, run + 4 * k, 4);
+    _dcache.insert(address + 4 * k, DecodedInstruction::decode(Instruction(bigEndian32(word))));
+  }
+  return *_dcache.insert(address, _decoded);
+}
+
+// Execute a decoded instruction
+void SparcEngine::execute(const DecodedInstruction& inst) {
+  switch (inst.handler) {
+    // Set high
+    case DI_SETHI:
+      registers()->write(inst.rd, inst.imm);
+      break;
+    // Branches
+    case DI_BICC:
+    case DI_FBFCC: {
+        if (inst.handler == DI_FBFCC && !fpuEnabled())
           break;
-        default:
-          _dcti = 0;
-          //nop
-      }
+        uint8_t cond = inst.cond & 0x07;
+        _dcti = pc()->read() + inst.imm;
+        Logger::log() << "dcti = " << pc()->read() << " - " << COMPL32(inst.imm) << "\n";
 
-      // adjust
-      if (neg) _branch = !_branch;
-      Logger::log() << "Will we branch ? " << (_branch ? "yes" : "no") << "\n";
+        // Calculate if we branch
+        _branch = (inst.handler == DI_BICC ? condition(inst.cond) : fcondition(inst.cond));
+        Logger::log() << "Will we branch ? " << (_branch ? "yes" : "no") << "\n";
 
-      // Calculate if we need to DCTI
-      _isdcti = (!a) || (_branch && !(cond == INST_COND_NEVER));
+        // Calculate if we need to DCTI
+        _isdcti = (!inst.a) || (_branch && !(cond == INST_COND_NEVER));
 
-      /*if (_isdcti)
-        _dcti -= 1;*/
-      Logger::log() << "Will we dcti ? " << (_isdcti ? "yes" : "no") << "\n";
+        Logger::log() << "Will we dcti ? " << (_isdcti ? "yes" : "no") << "\n";
 
-      Logger::log() << "Where will we branch ? " << _dcti << "\n";
-    } else if (op2 == INST_OP2_FBFCC) {
-      // unimplemented yet
-    } else if (op2 == INST_OP2_CBCCC) {
+        Logger::log() << "Where will we branch ? " << _dcti << "\n";
+      }
+      break;
+    case DI_CBCCC:
       // unimplemented yet
-    } else {
-      // nop (or trap ?)
-    }
-  } else if (op == INST_OP_CALL) {
+      break;
     // CALL
-    _dcti = pc()->read() + (inst.getField(INST_DISP30) << 2);
-    registers()->write(15, pc()->read() >> 2);
-    _branch = true;
-    _isdcti = false;
-  } else if (op == INST_OP_OTHER) {
-    // Arith, Logics, others
-    uint32_t op3 = inst.getField(INST_OP3);
-    uint32_t rd = inst.getField(INST_RD);
-    uint32_t rs1 = inst.getField(INST_RS1);
-
-    switch (op3) {
-      // Read special registers
-      case INST_OP3_RDY:
-        registers()->write(rd, (!READING_PRIVILEGE | isSupervisor() ? y()->read() : 0));
-        break;
-      case INST_OP3_RDPSR:
-        registers()->write(rd, (!READING_PRIVILEGE | isSupervisor() ? psr()->read() : 0));
-        break;
-      case INST_OP3_RDWIM:
-        registers()->write(rd, (!READING_PRIVILEGE | isSupervisor() ? wim()->read() : 0));
-        break;
-      case INST_OP3_RDTBR:
-        registers()->write(rd, (!READING_PRIVILEGE | isSupervisor() ? tbr()->read() : 0));
-        break;
-      // Write special registers
-      case INST_OP3_WRY:
-        if (isSupervisor())
-          y()->write(registers()->read(rs1));
-        break;
-      case INST_OP3_WRPSR:
-        if (isSupervisor())
-          psr()->write(registers()->read(rs1));
-        break;
-      case INST_OP3_WRWIM:
-        if (isSupervisor())
-          wim()->write(registers()->read(rs1));
-        break;
-      case INST_OP3_WRTBR:
-        if (isSupervisor())
-          tbr()->write(registers()->read(rs1));
-        break;
-      // External instructions
-      case INST_OP3_FPOP1:
-      case INST_OP3_FPOP2:
-      case INST_OP3_CPOP1:
-      case INST_OP3_CPOP2:
-        // Unimplemented yet
-        break;
-      // Jump and link
-      case INST_OP3_JMPL:
-        _dcti = registers()->read(rs1);
-        if (inst.getField(INST_I) == 0)
-          _dcti += registers()->read(inst.getField(INST_RS2));
+    case DI_CALL:
+      _dcti = pc()->read() + inst.imm;
+      registers()->write(15, pc()->read() >> 2);
+      _branch = true;
+      _isdcti = false;
+      break;
+    // Read special registers
+    case DI_RDY:
+      registers()->write(inst.rd, (!READING_PRIVILEGE | isSupervisor() ? y()->read() : 0));
+      break;
+    case DI_RDPSR:
+      alu()->syncFlags();
+      registers()->write(inst.rd, (!READING_PRIVILEGE | isSupervisor() ? psr()->read() : 0));
+      break;
+    case DI_RDWIM:
+      registers()->write(inst.rd, (!READING_PRIVILEGE | isSupervisor() ? wim()->read() : 0));
+      break;
+    case DI_RDTBR:
+      registers()->write(inst.rd, (!READING_PRIVILEGE | isSupervisor() ? tbr()->read() : 0));
+      break;
+    // Write special registers
+    case DI_WRY:
+      if (isSupervisor())
+        y()->write(registers()->read(inst.rs1));
+      break;
+    case DI_WRPSR:
+      if (isSupervisor()) {
+        alu()->syncFlags();
+        psr()->write(registers()->read(inst.rs1));
+        registers()->update();
+      }
+      break;
+    case DI_WRWIM:
+      if (isSupervisor())
+        wim()->write(registers()->read(inst.rs1));
+      break;
+    case DI_WRTBR:
+      if (isSupervisor())
+        tbr()->write(registers()->read(inst.rs1));
+      break;
+    // External instructions
+    case DI_FPOP:
+      if (fpuEnabled() && fpu()->execute(inst.imm, inst.rs1, inst.rs2, inst.rd) != FPU_FTT_NONE)
+        trap(SE_TT_FP_EXCEPTION);
+      break;
+    case DI_CPOP:
+      // Unimplemented yet
+      break;
+    // Jump and link
+    case DI_JMPL:
+      _dcti = registers()->read(inst.rs1);
+      if (!inst.i)
+        _dcti += registers()->read(inst.rs2);
+      else
+        _dcti += inst.imm;
+      _dcti = _dcti << 2;
+      registers()->write(inst.rd, pc()->read() >> 2);
+      _isdcti = false;
+      _branch = true;
+      break;
+    // Return from trap : only from a trap handler (supervisor, traps disabled)
+    case DI_RETT:
+      if (psr()->getField(PSR_ET) == 1 || !isSupervisor()) {
+        trap(isSupervisor() ? SE_TT_ILLEGAL_INSTRUCTION : SE_TT_PRIVILEGED_INSTRUCTION);
+      } else {
+        // unlike JMPL, the target is a byte address (the ones saved by the trap, see trap())
+        _dcti = registers()->read(inst.rs1);
+        if (!inst.i)
+          _dcti += registers()->read(inst.rs2);
         else
-          _dcti += signext(inst.getField(INST_SIMM13), 13);
-        _dcti = _dcti << 2;
-        registers()->write(rd, pc()->read() >> 2);
+          _dcti += inst.imm;
+        if (!enterWindow(false))
+          break;
+        registers()->restore();
+        psr()->setField(PSR_S, psr()->getField(PSR_PS));
+        psr()->setField(PSR_ET, 1);
         _isdcti = false;
         _branch = true;
-        break;
-      // Return from trap
-      case INST_OP3_RETT:
-        registers()->restore();
-        break;
-      // Trap if condition code
-      case INST_OP3_TICC:
-        break;
-      // Flush
-      case INST_OP3_FLUSH:
-        break;
-      // Save context
-      case INST_OP3_SAVE: {
-          Register* r1 = registers()->get(rs1);
-          Register* r2 = (inst.getField(INST_I) == 0 ? registers()->get(inst.getField(INST_RS2)) : NULL);
+      }
+      break;
+    // Trap if condition code
+    case DI_TICC:
+      if (condition(inst.cond)) {
+        uint32_t nb = registers()->read(inst.rs1) + (inst.i ? inst.imm : registers()->read(inst.rs2));
+        trap(SE_TT_TRAP_INSTRUCTION + (nb & 0x7F));
+      }
+      break;
+    // Flush : the instructions of the doubleword may have been modified
+    case DI_FLUSH: {
+        uint32_t addr = registers()->read(inst.rs1) + (inst.i ? inst.imm : registers()->read(inst.rs2));
+        invalidate(addr & 0xFFFFFFF8, 8);
+      }
+      break;
+    // Save context
+    case DI_SAVE:
+    case DI_RESTORE: {
+        if (!enterWindow(inst.handler == DI_SAVE))
+          break;
+        // the operands are read in the old window (by value : a change of window may move the registers)
+        uint32_t value = registers()->read(inst.rs1) + (inst.i ? inst.imm : registers()->read(inst.rs2));
+        if (inst.handler == DI_SAVE)
           registers()->save();
-        
-          if (r2 == NULL)
-            alu()->calc(ALU_OP_ADD, r1, inst.getField(INST_SIMM13), registers()->get(rd));
-          else
-            alu()->calc(ALU_OP_ADD, r1, r2, registers()->get(rd));
-        }
-        break;
-      // Restore context
-      case INST_OP3_REST:{
-          Register* r1 = registers()->get(rs1);
-          Register* r2 = (inst.getField(INST_I) == 0 ? registers()->get(inst.getField(INST_RS2)) : NULL);
+        else
           registers()->restore();
-        
-          if (r2 == NULL)
-            alu()->calc(ALU_OP_ADD, r1, inst.getField(INST_SIMM13), registers()->get(rd));
-          else
-            alu()->calc(ALU_OP_ADD, r1, r2, registers()->get(rd));
-        }
-        break;
-      default:
-        if (inst.getField(INST_I) == 0) {
-          // use register as src 2
-          alu()->calc(op3,
-              registers()->get(rs1),
-              registers()->get(inst.getField(INST_RS2)),
-              registers()->get(rd));
-        } else {
-          // use sign extension of simm13 (13-bit signed int) as src 2
-          uint32_t extsimm = signext(inst.getField(INST_SIMM13), 13);
-          alu()->calc(op3,
-              registers()->get(rs1),
-              extsimm,
-              registers()->get(rd));
-        }
-    }
-  } else {
+        registers()->write(inst.rd, value);
+      }
+      break;
+    case DI_ALU:
+      if (!inst.i) {
+        // use register as src 2
+        alu()->calc(inst.op3,
+            registers()->get(inst.rs1),
+            registers()->get(inst.rs2),
+            registers()->get(inst.rd));
+      } else {
+        // use sign extension of simm13 (13-bit signed int) as src 2
+        alu()->calc(inst.op3,
+            registers()->get(inst.rs1),
+            inst.imm,
+            registers()->get(inst.rd));
+      }
+      break;
     // Memory related insts
-    uint32_t op3 = inst.getField(INST_OP3);
-    uint32_t addr = registers()->read(inst.getField(INST_RS1));
-    if (inst.getField(INST_I) == 0)
-      addr += registers()->read(inst.getField(INST_RS2));
-    else
-      addr += signext(inst.getField(INST_SIMM13), 13);
-    uint32_t rd = inst.getField(INST_RD);
-
-    switch (op3) {
-      // Load instruction
-      case INST_OP3_LDSB:
-        registers()->write(rd, signext(memory()->readByte(addr), 8));
-        break;
-      case INST_OP3_LDSH:
-        registers()->write(rd, signext(memory()->readHalfword(addr), 16));
-        break;
-      case INST_OP3_LDUB:
-        registers()->write(rd, memory()->readByte(addr));
-        break;
-      case INST_OP3_LDUH:
-        registers()->write(rd, memory()->readHalfword(addr));
-        break;
-      case INST_OP3_LD:
-        registers()->write(rd, memory()->readWord(addr));
-        break;
-      case INST_OP3_LDD:
-        if (rd % 2 != 0) {
-          // pb : rd is odd; we cannot write a double word in it !
-          // trap ?
-          registers()->write(rd, 0);
-        } else {
-          memory()->readDoubleword(addr, registers()->get(rd), registers()->get(rd+1));
-        }
-        break;
-      // Store instruction
-      case INST_OP3_STB:
-        memory()->writeByte(addr, registers()->get(rd));
-        break;
-      case INST_OP3_STH:
-        memory()->writeHalfword(addr, registers()->get(rd));
-        break;
-      case INST_OP3_ST:
-        memory()->writeWord(addr, registers()->get(rd));
+    case DI_LDSB:
+    case DI_LDSH:
+    case DI_LDUB:
+    case DI_LDUH:
+    case DI_LD:
+    case DI_LDD:
+    case DI_STB:
+    case DI_STH:
+    case DI_ST:
+    case DI_STD: {
+        uint32_t addr = registers()->read(inst.rs1);
+        if (!inst.i)
+          addr += registers()->read(inst.rs2);
+        else
+          addr += inst.imm;
+        access(memory(), inst.handler, addr, inst.rd);
+      }
+      break;
+    // Floating-point loads and stores : a double takes an aligned pair of registers
+    case DI_LDF:
+    case DI_LDDF:
+    case DI_LDFSR:
+    case DI_STF:
+    case DI_STDF:
+    case DI_STFSR:
+      if (!fpuEnabled())
         break;
-      case INST_OP3_STD:
-        if (rd % 2 != 0) {
-          // pb !
-        } else {
-          memory()->writeDoubleword(addr, registers()->get(rd), registers()->get(rd+1));
-        }
+      if ((inst.handler == DI_LDDF || inst.handler == DI_STDF) && inst.rd % 2 != 0) {
+        fpu()->fail(FPU_FTT_INVALID_REGISTER);
+        trap(SE_TT_FP_EXCEPTION);
         break;
-      //default:
-        // unknown load/store instruction
-        // nop
-    }
-  } 
+      }
+      access(memory(), inst.handler, registers()->read(inst.rs1) + (inst.i ? inst.imm : registers()->read(inst.rs2)), inst.rd);
+      break;
+    // Alternate space : privileged, and the ASI takes the place of the immediate
+    case DI_ALTERNATE:
+      if (!isSupervisor())
+        trap(SE_TT_PRIVILEGED_INSTRUCTION);
+      else if (inst.i)
+        trap(SE_TT_ILLEGAL_INSTRUCTION);
+      else if (_spaces[inst.imm] == NULL)
+        trap(SE_TT_DATA_ACCESS_EXCEPTION);
+      else {
+        // an MMU may change the mapping of the addresses (context, flush) : what has been decoded is dropped
+        uint32_t mapping = memory()->getMappingVersion();
+        access(_spaces[inst.imm], inst.op3, registers()->read(inst.rs1) + registers()->read(inst.rs2), inst.rd);
+        if (memory()->getMappingVersion() != mapping)
+          flushDecoded();
+      }
+      break;
+    case DI_IFAULT:
+      trap(SE_TT_INSTRUCTION_ACCESS_EXCEPTION);
+      break;
+    default:
+      // unknown instruction
+      trap(SE_TT_ILLEGAL_INSTRUCTION);
+      break;
+  }
+}
 
-  // Position the next pc
-  if (_branch) {
-    if (_isdcti) {
-      Logger::log("Executing DCTI...");
-      alu()->calc(ALU_OP_ADD, pc(), 4, npc());
-      _isdcti = false;
+// Load or store
+void SparcEngine::access(AbstractMemory* bank, uint8_t handler, uint32_t addr, uint32_t rd) {
+  uint64_t value = 0;
+
+  switch (handler) {
+    // Load instruction (the registers are written below, when the access has not faulted)
+    case DI_LDSB:
+      value = signext(bank->readByte(addr), 8);
+      break;
+    case DI_LDSH:
+      value = signext(bank->readHalfword(addr), 16);
+      break;
+    case DI_LDUB:
+      value = bank->readByte(addr);
+      break;
+    case DI_LDUH:
+      value = bank->readHalfword(addr);
+      break;
+    case DI_LD:
+      value = bank->readWord(addr);
+      break;
+    case DI_LDD:
+      if (rd % 2 == 0)
+        value = bank->readDoubleword(addr);
+      break;
+    // Store instruction (the memory tells fetchedPageWritten() when it hits a page of instructions)
+    case DI_STB:
+      bank->writeByte(addr, registers()->get(rd));
+      break;
+    case DI_STH:
+      bank->writeHalfword(addr, registers()->get(rd));
+      break;
+    case DI_ST:
+      bank->writeWord(addr, registers()->get(rd));
+      break;
+    case DI_STD:
+      if (rd % 2 != 0) {
+        // pb !
+      } else {
+        bank->writeDoubleword(addr, registers()->get(rd), registers()->get(rd+1));
+      }
+      break;
+    // Floating-point ones (rd is an f register)
+    case DI_LDF:
+    case DI_LDFSR:
+      value = bank->readWord(addr);
+      break;
+    case DI_LDDF:
+      value = bank->readDoubleword(addr);
+      break;
+    case DI_STF:
+      bank->writeWord(addr, fpu()->read(rd));
+      break;
+    case DI_STDF:
+      bank->writeDoubleword(addr, fpu()->readDouble(rd));
+      break;
+    case DI_STFSR:
+      bank->writeWord(addr, fsr()->read());
+      break;
+  }
+
+  if (bank->hasFault()) {
+    trap(faultTrap(bank));
+  } else if (handler == DI_LDD) {
+    if (rd % 2 != 0) {
+      // pb : rd is odd; we cannot write a double word in it !
+      // trap ?
+      registers()->write(rd, 0);
     } else {
-      Logger::log("Execution Branch !");
-      npc()->write(_dcti);
-      _branch = false;
+      registers()->write(rd, (uint32_t)(value >> 32));
+      registers()->write(rd+1, (uint32_t)value);
     }
-  } else {
-    alu()->calc(ALU_OP_ADD, pc(), 4, npc());
+  } else if (handler < DI_LDD) {
+    registers()->write(rd, (uint32_t)value);
+  } else if (handler == DI_LDF) {
+    fpu()->write(rd, (uint32_t)value);
+  } else if (handler == DI_LDDF) {
+    fpu()->writeDouble(rd, value);
+  } else if (handler == DI_LDFSR) {
+    fpu()->loadFSR((uint32_t)value);
   }
-  Logger::log() << "New nPC calculated : " << std::hex << npc()->read() << std::endl; 
+}
 
-  return true;
+// Raise a trap
+void SparcEngine::trap(uint32_t tt) {
+  Logger::log() << "Trap ! tt=" << std::hex << tt << "\n";
+  _trapped = true;
+  tbr()->setField(TBR_TT, tt);
+  alu()->syncFlags();
+
+  // Traps disabled : the processor would enter the error mode, we just stop
+  if (psr()->getField(PSR_ET) == 0) {
+    _stop = (tt == SE_TT_ILLEGAL_INSTRUCTION ? SE_STOP_ILLEGAL : SE_STOP_TRAP);
+    return;
+  }
+
+  // Where we would have gone without the trap (see next())
+  uint32_t next = (_branch && !_isdcti ? _dcti : pc()->read() + 4);
+
+  psr()->setField(PSR_ET, 0);
+  psr()->setField(PSR_PS, psr()->getField(PSR_S));
+  psr()->setField(PSR_S, 1);
+  registers()->save();
+  registers()->write(REG_LOC(1), pc()->read());
+  registers()->write(REG_LOC(2), next);
+
+  // Go to the trap table, right now
+  _dcti = tbr()->read();
+  _isdcti = false;
+  _branch = true;
+}
+
+// A misaligned access (strict mode) is not a data access exception
+uint32_t SparcEngine::faultTrap(AbstractMemory* bank) {
+  uint32_t type = bank->getFaultType();
+  bank->clearFault();
+  return (type == MEM_FAULT_ALIGNMENT ? SE_TT_MEM_ADDRESS_NOT_ALIGNED : SE_TT_DATA_ACCESS_EXCEPTION);
+}
+
+// Invalid windows
+bool SparcEngine::enterWindow(bool save) {
+  if (save ? registers()->canSave() : registers()->canRestore())
+    return true;
+  if (_windowspill) {
+    if (save && registers()->spill(memory())) {
+      _spills++;
+      return true;
+    }
+    if (!save && registers()->fill(memory())) {
+      _fills++;
+      return true;
+    }
+  }
+  trap(save ? SE_TT_WINDOW_OVERFLOW : SE_TT_WINDOW_UNDERFLOW);
+  return false;
+}
+
+// Stores in the pages fetched from (the write functions of the memory tell them)
+void SparcEngine::fetchedPageWritten(uint32_t address, uint32_t size) {
+  invalidate(address, size);
+}
+
+// Invalidate cached instructions
+void SparcEngine::invalidate(uint32_t address, uint32_t size) {
+  if (_usedcache)
+    _dcache.invalidate(address, size);
+}
+
+void SparcEngine::flushDecoded() {
+  _dcache.clear();
+}
+
+// Decode cache switch
+void SparcEngine::setDecodeCache(bool enabled) {
+  _dcache.clear();
+  _usedcache = enabled;
+}
+
+bool SparcEngine::isDecodeCacheEnabled() const {
+  return _usedcache;
+}
+
+// Window spill switch
+void SparcEngine::setWindowSpill(bool enabled) {
+  _windowspill = enabled;
+}
+
+bool SparcEngine::isWindowSpillEnabled() const {
+  return _windowspill;
+}
+
+uint64_t SparcEngine::getWindowSpills() const {
+  return _spills;
+}
+
+uint64_t SparcEngine::getWindowFills() const {
+  return _fills;
+}
+
+// Address spaces
+void SparcEngine::setAddressSpace(uint8_t asi, AbstractMemory* bank) {
+  _spaces[asi] = bank;
+}
+
+AbstractMemory* SparcEngine::getAddressSpace(uint8_t asi) const {
+  return _spaces[asi];
+}
+
+const DecodeCache& SparcEngine::decodeCache() const {
+  return _dcache;
+}
+
+// Evaluate a condition
+bool SparcEngine::condition(uint8_t cond) {
+  alu()->syncFlags();
+  uint32_t icc = psr()->getField(PSR_ICC);
+
+  Logger::log() << "Condition ! Z=" << ((icc >> 2) & 1) << ";N=" << (icc >> 3) << ";C=" << (icc & 1)
+                << ";V=" << ((icc >> 1) & 1) << "\n";
+
+  return holds(cond, icc);
+}
+
+// Evaluate a floating-point condition
+bool SparcEngine::fcondition(uint8_t cond) {
+  uint32_t fcc = fsr()->getField(FPU_FCC);
+  bool L = (fcc == FPU_FCC_LESS),
+       G = (fcc == FPU_FCC_GREATER),
+       U = (fcc == FPU_FCC_UNORDERED);
+
+  bool taken = false;
+  switch (cond & 0x07) {
+    case INST_FCOND_NEVER:
+      taken = false;
+      break;
+    case INST_FCOND_NE:
+      taken = L || G || U;
+      break;
+    case INST_FCOND_LG:
+      taken = L || G;
+      break;
+    case INST_FCOND_UL:
+      taken = U || L;
+      break;
+    case INST_FCOND_L:
+      taken = L;
+      break;
+    case INST_FCOND_UG:
+      taken = U || G;
+      break;
+    case INST_FCOND_G:
+      taken = G;
+      break;
+    case INST_FCOND_U:
+      taken = U;
+      break;
+  }
+
+  // the conditions with the "not" bit are the opposite ones (FBE of FBNE, FBO of FBU...)
+  if ((cond >> 3) == 1)
+    taken = !taken;
+  return taken;
+}
+
+// Floating-point instructions
+bool SparcEngine::fpuEnabled() {
+  if (psr()->getField(PSR_EF) == 1)
+    return true;
+  trap(SE_TT_FP_DISABLED);
+  return false;
 }
 
 // Are we supervisor ?
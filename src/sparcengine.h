@@ -5,6 +5,7 @@
 #define SPARCENGINE_H
 
 #include "abstractsparcengine.h"
+#include "decodecache.h"
 
 // Implementation and version of the engine
 #define SE_IMPL 0x01
@@ -13,14 +14,39 @@
 // Value of the TBR
 #define SE_TRAPS_BASE_ADDR  0x00000000
 
+// Trap types
+#define SE_TT_INSTRUCTION_ACCESS_EXCEPTION 0x01  // the fetch has faulted
+#define SE_TT_ILLEGAL_INSTRUCTION     0x02
+#define SE_TT_PRIVILEGED_INSTRUCTION  0x03
+#define SE_TT_FP_DISABLED             0x04  // a floating-point instruction while the FPU is disabled (PSR_EF)
+#define SE_TT_WINDOW_OVERFLOW         0x05  // a save enters an invalid window (see WindowRegisters::canSave())
+#define SE_TT_WINDOW_UNDERFLOW        0x06  // a restore or a rett enters an invalid window
+#define SE_TT_MEM_ADDRESS_NOT_ALIGNED 0x07  // misaligned access, in strict mode (see AbstractMemory::setStrict())
+#define SE_TT_FP_EXCEPTION            0x08  // the FPU has trapped (the reason is in FPU_FTT)
+#define SE_TT_DATA_ACCESS_EXCEPTION   0x09  // the access has faulted (see AbstractMemory::hasFault())
+#define SE_TT_TRAP_INSTRUCTION        0x80  // + software trap number (Ticc)
+
+// Address spaces (ASI) of the alternate loads and stores : the usual ones, and how many there are
+#define SE_ASI_USER_INSTRUCTION       0x08
+#define SE_ASI_SUPERVISOR_INSTRUCTION 0x09
+#define SE_ASI_USER_DATA              0x0A
+#define SE_ASI_SUPERVISOR_DATA        0x0B
+#define SE_ASI_COUNT                  256
+
+// Instructions decoded ahead when the decode cache misses (from the run of the page, see AbstractMemory::fetchRun())
+#define SE_FETCH_AHEAD  8
+
 // do we need privilege to read internal registers ?
 #define READING_PRIVILEGE true
 
 /**
  * This defines a really simple sparc enfine, sufficient for most of the application we could do with.
- * There is no system of cycle, every instruction is executed one following the other, no pipeline, no trap, no FPU, etc.
+ * There is no system of cycle, every instruction is executed one following the other, no pipeline, etc.
+ * The floating-point operations are made by the FPU as soon as they are met (no queue), and an exception enabled in
+ * the FSR traps on the operation itself rather than on the next floating-point instruction.
+ * Traps only go as far as the trap table : an illegal instruction or a Ticc either jumps to it, or stops the engine when traps are disabled.
  */
-class SparcEngine : public AbstractSparcEngine {
+class SparcEngine : public AbstractSparcEngine, public AbstractMemory::FetchListener {
 	public:
     /**
      * Constructor.
@@ -29,7 +55,7 @@ class SparcEngine : public AbstractSparcEngine {
 		SparcEngine(
         AbstractMemory* mem,
         AbstractALU* alu,
-        /*AbstractFPU* fpu,*/
+        AbstractFPU* fpu,
         WindowRegisters* registers,
         SpecialRegister* psr,
         SpecialRegister* wim,
@@ -55,13 +81,168 @@ class SparcEngine : public AbstractSparcEngine {
      */
     bool next();
 
+    /**
+     * Run the engine
+     * @see AbstractSparcEngine::run()
+     */
+    uint32_t run(uint64_t maxInstructions);
+    /**
+     * Run the engine up to an address
+     * @see AbstractSparcEngine::runUntil()
+     */
+    uint32_t runUntil(uint32_t address, uint64_t maxInstructions = SE_UNLIMITED);
+    /**
+     * Run the engine until it stops
+     * @see AbstractSparcEngine::runUntilHalt()
+     */
+    uint32_t runUntilHalt();
+    /**
+     * Number of instructions executed
+     * @see AbstractSparcEngine::getInstructionCount()
+     */
+    uint64_t getInstructionCount() const;
+
+    /**
+     * Enable or disable the decoded instruction cache.
+     * When disabled, every instruction is fetched and decoded again each time it is executed.
+     * @param enabled true to use the cache
+     */
+    void setDecodeCache(bool enabled);
+    /**
+     * Tells if the decoded instruction cache is used
+     * @returns true if the cache is enabled
+     */
+    bool isDecodeCacheEnabled() const;
+    /**
+     * Get the decoded instruction cache (mainly for statistics)
+     * @returns the cache
+     */
+    const DecodeCache& decodeCache() const;
+
+    /**
+     * Make the window overflows and underflows spill and fill the windows in the host (see
+     * WindowRegisters::spill()), instead of trapping to the handlers of the program. A spill or a fill that
+     * faults still traps.
+     * @param enabled true to handle them in the host
+     */
+    void setWindowSpill(bool enabled);
+    /**
+     * Tells if the window overflows and underflows are handled in the host
+     * @returns true if they are
+     */
+    bool isWindowSpillEnabled() const;
+    /**
+     * Number of windows spilled and filled by the host
+     * @returns the count
+     */
+    uint64_t getWindowSpills() const;
+    uint64_t getWindowFills() const;
+
+    /**
+     * Route an address space of the alternate loads and stores (LDA, STA, etc.) to a memory bank, to model
+     * split instruction and data memories or device windows. Every space goes to the main memory at first.
+     * The normal loads and stores, and the instruction fetches, always use the main memory.
+     * @param asi address space identifier
+     * @param bank memory of the space, or NULL to make its accesses raise data access exceptions
+     */
+    void setAddressSpace(uint8_t asi, AbstractMemory* bank);
+    /**
+     * Get the memory bank of an address space
+     * @param asi address space identifier
+     * @returns the bank, or NULL if the space has none
+     */
+    AbstractMemory* getAddressSpace(uint8_t asi) const;
+
+    /**
+     * A store has hit a page fetched from : the instructions decoded there are dropped
+     * @see AbstractMemory::FetchListener::fetchedPageWritten()
+     */
+    void fetchedPageWritten(uint32_t address, uint32_t size);
+
+    /**
+     * Evaluate a branch condition on given integer condition codes (for all the engines and the AOT runtime)
+     * @param cond condition (INST_COND_*, with the "not" bit)
+     * @param icc integer condition codes (N Z V C, from the most to the least significant bit)
+     * @returns true if the condition holds
+     */
+    static bool holds(uint8_t cond, uint32_t icc);
+
 	protected:
     /**
      * Determines if the CPU is in supervisor mode
      */
     bool isSupervisor();
+    /**
+     * Evaluate a branch condition on the integer condition codes
+     * @param cond condition (INST_COND_*, with the "not" bit)
+     * @returns true if the condition holds
+     */
+    bool condition(uint8_t cond);
+    /**
+     * Evaluate a branch condition on the floating-point condition codes (FPU_FCC)
+     * @param cond condition (INST_FCOND_*)
+     * @returns true if the condition holds
+     */
+    bool fcondition(uint8_t cond);
+    /**
+     * Check that the FPU is enabled (PSR_EF), or raise an fp_disabled trap
+     * @returns false if the instruction has trapped
+     */
+    bool fpuEnabled();
+    /**
+     * Raise a trap for the current instruction (the one at pc).
+     * If the traps are enabled, the trap is taken : new window, pc and next pc saved into %l1 and %l2,
+     * supervisor mode, and the next instruction is the one of the trap table. Otherwise, the engine
+     * stops on the instruction (see _stop).
+     * @param tt trap type
+     */
+    void trap(uint32_t tt);
+    /**
+     * Clear the fault of a memory, and tell which trap it raises
+     * @param bank the memory that has faulted
+     * @returns SE_TT_MEM_ADDRESS_NOT_ALIGNED or SE_TT_DATA_ACCESS_EXCEPTION
+     */
+    uint32_t faultTrap(AbstractMemory* bank);
+    /**
+     * Check the window a save or a restore enters : if it is invalid, the host spills or fills a window, or the
+     * instruction raises a window overflow or underflow
+     * @param save true for a save, false for a restore
+     * @returns false if the instruction has trapped
+     */
+    bool enterWindow(bool save);
+    /**
+     * Execute instructions until the budget is exhausted, the breakpoint is reached or the engine stops.
+     * This is where the run*() functions end up; faster engines override it.
+     * @param count maximum number of instructions
+     * @param breakpoint address before which to stop (SE_NO_BREAKPOINT for none)
+     * @returns why the engine stopped (SE_STOP_*)
+     */
+    virtual uint32_t runBatch(uint64_t count, uint32_t breakpoint);
+
+    /**
+     * Fetch and decode the instruction at a given address, using the cache if it is enabled. On a miss, the next
+     * instructions of the page are decoded too (up to SE_FETCH_AHEAD).
+     * @param address address of the instruction
+     * @returns the decoded instruction
+     */
+    const DecodedInstruction& fetch(uint32_t address);
+    /**
+     * Execute a decoded instruction (the pc register must already point to it)
+     * @param di the instruction
+     */
+    void execute(const DecodedInstruction& di);
+    /**
+     * Tell the engine that a range of the memory has been modified, so the cached
+     * instructions overlapping it are decoded again
+     * @param address beginning of the range
+     * @param size size of the range
+     */
+    virtual void invalidate(uint32_t address, uint32_t size);
+    /**
+     * Drop every cached instruction, when the addresses may designate something else (a change of the mapping)
+     */
+    virtual void flushDecoded();
 
-	private:
     /**
      * This attribute is set to true when a branch as been encountered and taken.
      * When this is the case, at the next instruction, we execute the branch (if there is no DCTI) or we execute the DCTI and then, at the next instruction we execute the branch (and set the attribute to false).
@@ -80,8 +261,70 @@ class SparcEngine : public AbstractSparcEngine {
      * When there is a branch, indicate the next instruction (and maybe the next, next instruction, if we must execute dcti).
      */
     uint32_t _dcti;
+    /**
+     * Set by execute() when the engine must stop on the current instruction (SE_STOP_*); the instruction
+     * is not executed and the engine stays on it (pc == npc).
+     */
+    uint32_t _stop;
+    /**
+     * Set by trap() : the current instruction has trapped (the trap is taken, or the engine stops)
+     */
+    bool _trapped;
+    /**
+     * Number of instructions executed since the last initialization
+     */
+    uint64_t _executed;
 
+	private:
+    /**
+     * Make a load or a store (the destination is left alone, and a trap raised, if the access faults)
+     * @param bank memory to access
+     * @param handler DI_LDSB to DI_STD, or DI_LDF to DI_STFSR
+     * @param addr address
+     * @param rd register to load or store
+     */
+    void access(AbstractMemory* bank, uint8_t handler, uint32_t addr, uint32_t rd);
+
+    /**
+     * Memory banks of the address spaces
+     */
+    AbstractMemory* _spaces[SE_ASI_COUNT];
+    /**
+     * Cache of decoded instructions, keyed by address
+     */
+    DecodeCache _dcache;
+    /**
+     * Is the cache used ?
+     */
+    bool _usedcache;
+    /**
+     * Decoded instruction when the cache is not used
+     */
+    DecodedInstruction _decoded;
+    /**
+     * Are the windows spilled and filled by the host ? How many have been ?
+     */
+    bool _windowspill;
+    uint64_t _spills;
+    uint64_t _fills;
 };
 
+inline bool SparcEngine::holds(uint8_t cond, uint32_t icc) {
+  bool n = ((icc >> 3) & 1) == 1, z = ((icc >> 2) & 1) == 1,
+       v = ((icc >> 1) & 1) == 1, c = (icc & 1) == 1;
+  bool taken;
+  switch (cond & 0x07) {
+    case INST_COND_NEVER: taken = false;        break;
+    case INST_COND_EQ:    taken = z;            break;
+    case INST_COND_LET:   taken = z || (n ^ v); break;
+    case INST_COND_LT:    taken = n ^ v;        break;
+    case INST_COND_ULET:  taken = c || z;       break;
+    case INST_COND_CSET:  taken = c;            break;
+    case INST_COND_NEG:   taken = n;            break;
+    default:              taken = v;            break; // INST_COND_OSET
+  }
+  return ((cond >> 3) == 1) ? !taken : taken;
+}
+
 #endif // SPARCENGINE_H
 
@@ -75,5 +75,19 @@ class SpecialRegister : public Register {
 
 };
 
+// Get a field
+inline uint32_t SpecialRegister::getField(uint32_t from, uint32_t size) const {
+  return sub(read(), from, size);
+}
+
+// Set a field
+inline void SpecialRegister::setField(uint32_t from, uint32_t size, uint32_t value) {
+  // It may seems complicated, but basically we :
+  // - read the current value
+  // - set the bits corresponding to the field we want to modify to 0
+  // - or' this last number with the new value we want, shifted so it fit
+  write((read() & (~((0xFFFFFFFF >> (32 - size)) << from))) | (value << from));
+}
+
 #endif // SPECIALREGISTER_H
 
@@ -0,0 +1,263 @@
+/*
+ * srmmumemory.cpp -- implement the SrmmuMemory class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "srmmumemory.h"
+
+#include <cstring>
+
+// What each ACC value allows (user bits, then supervisor bits)
+static const uint32_t SRMMU_PERMISSIONS[8] = {
+  0x09, // read             / read
+  0x1B, // read write       / read write
+  0x2D, // read execute     / read execute
+  0x3F, // read write exec. / read write execute
+  0x24, // execute          / execute
+  0x19, // read             / read write
+  0x28, // nothing          / read execute
+  0x38  // nothing          / read write execute
+};
+
+// Virtual address bits of each level : what is below the index, and the size of the index
+static const uint32_t SRMMU_LEVEL_SHIFT[4] = { 32, 24, 18, 12 };
+static const uint32_t SRMMU_LEVEL_MASK[4] = { 0, 0xFF, 0x3F, 0x3F };
+
+// Access types of the fault status, for a user access (+1 in supervisor mode)
+static const uint32_t SRMMU_ACCESS_TYPES[3] = { 0, 4, 2 };
+
+// Cstr
+SrmmuMemory::SrmmuMemory(AbstractMemory* physical, const SpecialRegister* psr) :
+    AbstractMemory(physical->getSize()), _physical(physical), _psr(psr),
+    _control(0), _ctp(0), _context(0), _fsr(0), _far(0), _hits(0), _misses(0),
+    _registerspace(this, true), _flushspace(this, false) {
+  setTLB(false); // the pages are found in the translation cache
+  for (uint32_t k = 0; k < SRMMU_CACHE_ENTRIES; k++) {
+    _cache[k].tag = SRMMU_CACHE_INVALID;
+    _cache[k].page = 0;
+    _cache[k].perms = 0;
+  }
+}
+
+// Dstr
+SrmmuMemory::~SrmmuMemory() {
+}
+
+// Address spaces
+AbstractMemory* SrmmuMemory::registerSpace() {
+  return &_registerspace;
+}
+
+AbstractMemory* SrmmuMemory::flushSpace() {
+  return &_flushspace;
+}
+
+// Registers
+uint32_t SrmmuMemory::readRegister(uint32_t reg) {
+  uint32_t value = 0;
+  switch (reg & SRMMU_REG_MASK) {
+    case SRMMU_REG_CONTROL: value = _control; break;
+    case SRMMU_REG_CTP:     value = _ctp;     break;
+    case SRMMU_REG_CONTEXT: value = _context; break;
+    case SRMMU_REG_FSR:
+      value = _fsr;
+      _fsr = 0;
+      break;
+    case SRMMU_REG_FAR:     value = _far;     break;
+  }
+  return value;
+}
+
+void SrmmuMemory::writeRegister(uint32_t reg, uint32_t value) {
+  switch (reg & SRMMU_REG_MASK) {
+    case SRMMU_REG_CONTROL:
+      _control = value & SRMMU_CTRL_E;
+      flush();
+      break;
+    case SRMMU_REG_CTP:
+      _ctp = value;
+      flush();
+      break;
+    case SRMMU_REG_CONTEXT:
+      // the translations of each context stay in the cache
+      _context = value % SRMMU_CONTEXTS;
+      newMapping();
+      break;
+  }
+}
+
+// Flush and probe
+void SrmmuMemory::flush() {
+  for (uint32_t k = 0; k < SRMMU_CACHE_ENTRIES; k++)
+    _cache[k].tag = SRMMU_CACHE_INVALID;
+  newMapping();
+}
+
+uint32_t SrmmuMemory::probe(uint32_t address) {
+  uint32_t pte, pteaddr, level;
+  return (walk(address, pte, pteaddr, level) == 0 ? pte : 0);
+}
+
+// Counters
+uint64_t SrmmuMemory::getHits() const {
+  return _hits;
+}
+
+uint64_t SrmmuMemory::getMisses() const {
+  return _misses;
+}
+
+// Load a program
+uint32_t SrmmuMemory::loadFile(const std::string& filename, uint32_t baseaddr) {
+  return _physical->loadFile(filename, baseaddr);
+}
+
+// Instruction fetch
+const uint8_t* SrmmuMemory::instructionPage(uint32_t address) const {
+  uint32_t physical = address;
+  if ((_control & SRMMU_CTRL_E) != 0 && !lookup(address, SRMMU_EXECUTE, physical))
+    return NULL;
+  return _physical->instructionPage(physical);
+}
+
+// Read and write
+void SrmmuMemory::read(uint32_t address, uint32_t size, uint8_t* data) const {
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t a = address + i;
+    uint32_t n = TLB_PAGE_SIZE - (a & TLB_PAGE_MASK);
+    if (n > size - i)
+      n = size - i;
+    uint32_t physical;
+    if (!translate(a, SRMMU_READ, physical)) {
+      std::memset(data + i, 0, size - i);
+      return;
+    }
+    _physical->read(physical, n, data + i);
+    checkPhysical(a, SRMMU_READ);
+    i += n;
+  }
+}
+
+void SrmmuMemory::write(uint32_t address, uint8_t* data, uint32_t size) {
+  for (uint32_t i = 0; i < size; ) {
+    uint32_t a = address + i;
+    uint32_t n = TLB_PAGE_SIZE - (a & TLB_PAGE_MASK);
+    if (n > size - i)
+      n = size - i;
+    uint32_t physical;
+    if (!translate(a, SRMMU_WRITE, physical))
+      return;
+    _physical->write(physical, data + i, n);
+    checkPhysical(a, SRMMU_WRITE);
+    i += n;
+  }
+}
+
+// Walk the tables and enter the page in the cache
+bool SrmmuMemory::miss(uint32_t address, uint32_t kind, uint32_t& physical) const {
+  _misses++;
+  uint32_t supervisor = _psr->getField(PSR_S);
+  uint32_t pte, pteaddr, level;
+  uint32_t ft = walk(address, pte, pteaddr, level);
+  uint32_t acc = (pte >> SRMMU_PTE_ACC_SHIFT) & SRMMU_PTE_ACC_MASK;
+  uint32_t perms = SRMMU_PERMISSIONS[acc];
+  if (ft == 0 && ((perms >> (kind + 3 * supervisor)) & 1) == 0)
+    ft = (!supervisor && acc >= 6 ? SRMMU_FT_PRIVILEGE : SRMMU_FT_PROTECTION);
+  if (ft != 0) {
+    raise(address, kind, level, ft);
+    return false;
+  }
+
+  // Referenced, and modified by a write; until it is, the page is not writable in the cache
+  uint32_t flags = SRMMU_PTE_R | (kind == SRMMU_WRITE ? SRMMU_PTE_M : 0);
+  if ((pte & flags) != flags) {
+    pte |= flags;
+    _physical->writeWord(pteaddr, pte);
+    if (_physical->hasFault())
+      _physical->clearFault();
+  }
+  if ((pte & SRMMU_PTE_M) == 0)
+    perms &= ~((1 << SRMMU_WRITE) | (1 << (SRMMU_WRITE + 3)));
+
+  // A PTE above the last level maps a whole region or segment : only the page of the access is entered
+  uint32_t mask = (1 << SRMMU_LEVEL_SHIFT[level]) - 1;
+  Entry& e = _cache[((address >> TLB_PAGE_BITS) ^ _context) & (SRMMU_CACHE_ENTRIES - 1)];
+  e.tag = (_context << (32 - TLB_PAGE_BITS)) | (address >> TLB_PAGE_BITS);
+  e.page = ((((pte >> 8) << TLB_PAGE_BITS) & ~mask) | (address & mask)) & ~TLB_PAGE_MASK;
+  e.perms = perms;
+  physical = e.page | (address & TLB_PAGE_MASK);
+  return true;
+}
+
+uint32_t SrmmuMemory::walk(uint32_t address, uint32_t& pte, uint32_t& pteaddr, uint32_t& level) const {
+  // The context table, then the tables of the context
+  level = 0;
+  pteaddr = ((_ctp & ~SRMMU_ET_MASK) << 4) + 4 * _context;
+  while (true) {
+    pte = _physical->readWord(pteaddr);
+    if (_physical->hasFault()) {
+      _physical->clearFault();
+      return SRMMU_FT_TRANSLATION;
+    }
+
+    switch (pte & SRMMU_ET_MASK) {
+      case SRMMU_ET_INVALID:
+        return SRMMU_FT_INVALID;
+      case SRMMU_ET_PTE:
+        return (level == 0 ? SRMMU_FT_TRANSLATION : 0);
+      case SRMMU_ET_PTD:
+        if (level == 3)
+          return SRMMU_FT_TRANSLATION;
+        level++;
+        pteaddr = ((pte & ~SRMMU_ET_MASK) << 4)
+                + 4 * ((address >> SRMMU_LEVEL_SHIFT[level]) & SRMMU_LEVEL_MASK[level]);
+        break;
+      default:
+        return SRMMU_FT_TRANSLATION;
+    }
+  }
+}
+
+// Faults
+void SrmmuMemory::raise(uint32_t address, uint32_t kind, uint32_t level, uint32_t ft) const {
+  uint32_t at = SRMMU_ACCESS_TYPES[kind] + _psr->getField(PSR_S);
+  _fsr = ((_fsr & SRMMU_FSR_FAV) != 0 ? SRMMU_FSR_OW : 0) | (level << SRMMU_FSR_L_SHIFT)
+       | (at << SRMMU_FSR_AT_SHIFT) | (ft << SRMMU_FSR_FT_SHIFT) | SRMMU_FSR_FAV;
+  _far = address;
+  fault(address);
+}
+
+// Address spaces of the MMU
+SrmmuMemory::Space::Space(SrmmuMemory* mmu, bool registers) :
+    AbstractMemory(registers ? SRMMU_REG_MASK + 0x100 : 0xFFFFFFFF), _mmu(mmu), _registers(registers) {
+  setTLB(false);
+}
+
+SrmmuMemory::Space::~Space() {
+}
+
+// A word is read once, whatever the size of the access (reading the fault status clears it)
+void SrmmuMemory::Space::read(uint32_t address, uint32_t size, uint8_t* data) const {
+  uint32_t word = 0, current = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    uint32_t a = address + i;
+    if (i == 0 || (a & ~3) != current) {
+      current = a & ~3;
+      word = (_registers ? _mmu->readRegister(current) : _mmu->probe(current));
+    }
+    data[i] = (uint8_t)(word >> (8 * (3 - (a & 3))));
+  }
+}
+
+// Only whole words are written in the registers; anything flushes
+void SrmmuMemory::Space::write(uint32_t address, uint8_t* data, uint32_t size) {
+  if (!_registers) {
+    _mmu->flush();
+    return;
+  }
+  for (uint32_t i = (4 - (address & 3)) & 3; i + 4 <= size; i += 4) {
+    uint32_t value = ((uint32_t)data[i] << 24) | ((uint32_t)data[i+1] << 16) | ((uint32_t)data[i+2] << 8) | data[i+3];
+    _mmu->writeRegister(address + i, value);
+  }
+}
@@ -0,0 +1,377 @@
+/*
+ * srmmumemory.h -- a SPARC reference MMU in front of a memory device
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef SRMMUMEMORY_H
+#define SRMMUMEMORY_H
+
+#include "abstractmemory.h"
+#include "specialregister.h"
+
+// Address spaces of the MMU (see SparcEngine::setAddressSpace())
+#define SRMMU_ASI_FLUSH       0x03  // stores flush the translations, loads probe the tables
+#define SRMMU_ASI_REGISTERS   0x04  // the registers below
+#define SRMMU_ASI_BYPASS      0x20  // physical addresses (the memory behind the MMU)
+
+// Registers, in the register space
+#define SRMMU_REG_CONTROL     0x000
+#define SRMMU_REG_CTP         0x100  // context table pointer
+#define SRMMU_REG_CONTEXT     0x200
+#define SRMMU_REG_FSR         0x300  // fault status (cleared when read)
+#define SRMMU_REG_FAR         0x400  // fault address
+#define SRMMU_REG_MASK        0x700
+
+// Control register : only the enable bit is implemented
+#define SRMMU_CTRL_E          0x00000001
+
+// Number of contexts
+#define SRMMU_CONTEXTS        256
+
+// Entries of the tables : type, then the fields of a PTE
+#define SRMMU_ET_INVALID      0
+#define SRMMU_ET_PTD          1
+#define SRMMU_ET_PTE          2
+#define SRMMU_ET_MASK         0x3
+#define SRMMU_PTE_ACC_SHIFT   2
+#define SRMMU_PTE_ACC_MASK    0x7
+#define SRMMU_PTE_R           0x20  // referenced
+#define SRMMU_PTE_M           0x40  // modified
+
+// Fault status : fields, access types and fault types
+#define SRMMU_FSR_OW          0x00000001
+#define SRMMU_FSR_FAV         0x00000002
+#define SRMMU_FSR_FT_SHIFT    2
+#define SRMMU_FSR_AT_SHIFT    5
+#define SRMMU_FSR_L_SHIFT     8
+#define SRMMU_FT_INVALID      1  // invalid entry
+#define SRMMU_FT_PROTECTION   2  // the access is not allowed by the page
+#define SRMMU_FT_PRIVILEGE    3  // user access to a supervisor page
+#define SRMMU_FT_TRANSLATION  4  // bad table, or the walk has faulted
+#define SRMMU_FT_BUS          5  // the physical access has faulted
+
+// Kinds of access (bit of the permissions, plus 3 in supervisor mode)
+#define SRMMU_READ            0
+#define SRMMU_WRITE           1
+#define SRMMU_EXECUTE         2
+
+// Translation cache : number of entries (a power of two : direct-mapped), tag of an empty entry
+#define SRMMU_CACHE_ENTRIES   512
+#define SRMMU_CACHE_INVALID   0xFFFFFFFF
+
+/**
+ * This memory device is a SPARC reference MMU (SRMMU) : it translates the addresses of the engine (virtual) into
+ * addresses of another memory device (physical), through page tables held in the physical memory.
+ *
+ * The context register selects an entry of the context table, which points to a three-level tree : 256 regions of
+ * 16 MB, 64 segments of 256 KB, 64 pages of 4 KB. A page table entry (PTE) at any level maps the whole range;
+ * its ACC field tells what user and supervisor code may do in it (read, write, execute), and the MMU sets its
+ * referenced and modified bits. An access that the tables do not allow is not made : the fault status and fault
+ * address registers tell why, and the engine raises a data access exception (or an instruction access exception
+ * for a fetch, see AbstractMemory::hasFault()). The supervisor mode is read from the PSR.
+ *
+ * In front of the tables, a direct-mapped translation cache keyed by (context, virtual page) remembers the
+ * physical page and the permissions of the last pages used, so a translated access costs a lookup more than an
+ * untranslated one. Like the TLB of the hardware, it is not kept in sync with the tables : the program flushes it
+ * (a store in SRMMU_ASI_FLUSH) when it changes them. A context switch does not flush it.
+ *
+ * The registers and the flush are address spaces of their own (registerSpace(), flushSpace()), to route from
+ * the ASIs of the alternate loads and stores. Writing the control, context table pointer or context register, or
+ * flushing, changes the mapping of the addresses (see AbstractMemory::getMappingVersion()).
+ *
+ * The MMU is disabled at first : addresses go to the physical memory as they are. Physical addresses are 32-bit
+ * (the 4 high bits of the 36-bit SRMMU addresses are dropped). The instructions already decoded by the engine are
+ * not checked again when the supervisor mode changes.
+ */
+class SrmmuMemory : public AbstractMemory {
+	public:
+    /**
+     * Constructor
+     * @param physical the memory behind the MMU (not owned)
+     * @param psr the PSR, for the supervisor mode
+     */
+		SrmmuMemory(AbstractMemory* physical, const SpecialRegister* psr);
+    /**
+     * Destructor
+     */
+		~SrmmuMemory();
+
+    /**
+     * The memory behind the MMU
+     * @returns the physical memory
+     */
+    AbstractMemory* physical() const;
+    /**
+     * The address space of the registers (SRMMU_ASI_REGISTERS) : words at SRMMU_REG_*
+     * @returns the space
+     */
+    AbstractMemory* registerSpace();
+    /**
+     * The address space of the flushes and probes (SRMMU_ASI_FLUSH) : a store flushes the translation cache, a
+     * word load gives the PTE of the page (0 if it has none)
+     * @returns the space
+     */
+    AbstractMemory* flushSpace();
+
+    /**
+     * Read a register
+     * @param reg SRMMU_REG_*
+     * @returns its value
+     */
+    uint32_t readRegister(uint32_t reg);
+    /**
+     * Write a register
+     * @param reg SRMMU_REG_*
+     * @param value the value
+     */
+    void writeRegister(uint32_t reg, uint32_t value);
+    /**
+     * Forget every translation
+     */
+    void flush();
+    /**
+     * Walk the tables for an address, as the MMU would, without marking the PTE referenced
+     * @param address virtual address
+     * @returns the PTE, or 0 if there is none
+     */
+    uint32_t probe(uint32_t address);
+
+    /**
+     * Number of accesses found in the translation cache
+     * @returns the number of hits
+     */
+    uint64_t getHits() const;
+    /**
+     * Number of accesses that have walked the tables
+     * @returns the number of misses
+     */
+    uint64_t getMisses() const;
+
+    /**
+     * Programs are loaded into the physical memory
+     * @see AbstractMemory::loadFile()
+     */
+    uint32_t loadFile(const std::string& filename, uint32_t baseaddr = 0);
+
+    /**
+     * Read function, page by page
+     * @see AbstractMemory::read()
+     */
+    void read(uint32_t address, uint32_t size, uint8_t* data) const;
+    /**
+     * Write function, page by page
+     * @see AbstractMemory::write()
+     */
+    void write(uint32_t address, uint8_t* data, uint32_t size);
+
+    /**
+     * The page of the physical memory, when the translation cache allows to execute it (the fetch that has
+     * walked the tables has entered it)
+     * @see AbstractMemory::instructionPage()
+     */
+    const uint8_t* instructionPage(uint32_t address) const;
+
+    /**
+     * Fast paths : a lookup in the translation cache, then the fast path of the physical memory
+     * @see AbstractMemory::load32()
+     */
+    uint32_t load32(uint32_t address) const;
+    uint16_t load16(uint32_t address) const;
+    uint64_t load64(uint32_t address) const;
+    uint32_t fetch32(uint32_t address) const;
+    void store32(uint32_t address, uint32_t data);
+    void store16(uint32_t address, uint16_t data);
+
+	private:
+    /**
+     * An address space of the MMU : the registers, or the flushes and probes
+     */
+    class Space : public AbstractMemory {
+      public:
+        Space(SrmmuMemory* mmu, bool registers);
+        ~Space();
+        void read(uint32_t address, uint32_t size, uint8_t* data) const;
+        void write(uint32_t address, uint8_t* data, uint32_t size);
+
+      private:
+        SrmmuMemory* _mmu;
+        bool _registers;
+    };
+
+    /**
+     * An entry of the translation cache : context and virtual page, physical page, permissions (SRMMU_READ to
+     * SRMMU_EXECUTE bits for the user, the same shifted by 3 for the supervisor)
+     */
+    struct Entry {
+      uint32_t tag;
+      uint32_t page;
+      uint32_t perms;
+    };
+
+    /**
+     * Look for an address in the translation cache
+     * @param address virtual address
+     * @param kind SRMMU_READ, SRMMU_WRITE or SRMMU_EXECUTE
+     * @param physical the physical address
+     * @returns false if the page is not in the cache, or the access is not allowed by its entry
+     */
+    bool lookup(uint32_t address, uint32_t kind, uint32_t& physical) const;
+    /**
+     * Translate an address
+     * @param address virtual address
+     * @param kind SRMMU_READ, SRMMU_WRITE or SRMMU_EXECUTE
+     * @param physical the physical address
+     * @returns false if the access is not allowed (the fault is recorded)
+     */
+    bool translate(uint32_t address, uint32_t kind, uint32_t& physical) const;
+    /**
+     * Translate an address which is not in the cache : walk the tables, and fill the cache
+     * @see translate()
+     */
+    bool miss(uint32_t address, uint32_t kind, uint32_t& physical) const;
+    /**
+     * Walk the tables
+     * @param address virtual address
+     * @param pte the entry found
+     * @param pteaddr its physical address
+     * @param level its level (0 for the context table, up to 3)
+     * @returns 0, or the SRMMU_FT_* of the failure
+     */
+    uint32_t walk(uint32_t address, uint32_t& pte, uint32_t& pteaddr, uint32_t& level) const;
+    /**
+     * Record a fault in the registers, and for the engine
+     * @param address virtual address
+     * @param kind kind of access
+     * @param level level of the tables where it has faulted
+     * @param ft SRMMU_FT_*
+     */
+    void raise(uint32_t address, uint32_t kind, uint32_t level, uint32_t ft) const;
+    /**
+     * Record a fault if the physical memory has faulted
+     * @param address virtual address of the access
+     * @param kind kind of access
+     */
+    void checkPhysical(uint32_t address, uint32_t kind) const;
+
+    //!< The memory behind the MMU, and the PSR
+    AbstractMemory* _physical;
+    const SpecialRegister* _psr;
+
+    //!< Registers
+    uint32_t _control;
+    uint32_t _ctp;
+    uint32_t _context;
+    mutable uint32_t _fsr;
+    mutable uint32_t _far;
+
+    //!< Translation cache
+    mutable Entry _cache[SRMMU_CACHE_ENTRIES];
+    mutable uint64_t _hits;
+    mutable uint64_t _misses;
+
+    //!< Address spaces
+    Space _registerspace;
+    Space _flushspace;
+};
+
+/*
+ * The lookup is inline : it is made on each access. A page which is not modified yet is not writable in the
+ * cache, so that the first write walks the tables to mark it.
+ */
+inline bool SrmmuMemory::lookup(uint32_t address, uint32_t kind, uint32_t& physical) const {
+  const Entry& e = _cache[((address >> TLB_PAGE_BITS) ^ _context) & (SRMMU_CACHE_ENTRIES - 1)];
+  uint32_t bit = kind + 3 * _psr->getField(PSR_S);
+  if (e.tag == ((_context << (32 - TLB_PAGE_BITS)) | (address >> TLB_PAGE_BITS)) && ((e.perms >> bit) & 1) != 0) {
+    _hits++;
+    physical = e.page | (address & TLB_PAGE_MASK);
+    return true;
+  }
+  return false;
+}
+
+inline bool SrmmuMemory::translate(uint32_t address, uint32_t kind, uint32_t& physical) const {
+  if ((_control & SRMMU_CTRL_E) == 0) {
+    physical = address;
+    return true;
+  }
+  return lookup(address, kind, physical) || miss(address, kind, physical);
+}
+
+inline void SrmmuMemory::checkPhysical(uint32_t address, uint32_t kind) const {
+  if (_physical->hasFault()) {
+    _physical->clearFault();
+    raise(address, kind, 0, SRMMU_FT_BUS);
+  }
+}
+
+// An access crossing a page goes through read() or write(), which translate each page
+inline uint32_t SrmmuMemory::load32(uint32_t address) const {
+  uint32_t physical;
+  if ((address & TLB_PAGE_MASK) > TLB_PAGE_SIZE - 4)
+    return AbstractMemory::load32(address);
+  if (!translate(address, SRMMU_READ, physical))
+    return 0;
+  uint32_t data = _physical->load32(physical);
+  checkPhysical(address, SRMMU_READ);
+  return data;
+}
+
+inline uint16_t SrmmuMemory::load16(uint32_t address) const {
+  uint32_t physical;
+  if ((address & TLB_PAGE_MASK) > TLB_PAGE_SIZE - 2)
+    return AbstractMemory::load16(address);
+  if (!translate(address, SRMMU_READ, physical))
+    return 0;
+  uint16_t data = _physical->load16(physical);
+  checkPhysical(address, SRMMU_READ);
+  return data;
+}
+
+inline uint64_t SrmmuMemory::load64(uint32_t address) const {
+  uint32_t physical;
+  if ((address & TLB_PAGE_MASK) > TLB_PAGE_SIZE - 8)
+    return AbstractMemory::load64(address);
+  if (!translate(address, SRMMU_READ, physical))
+    return 0;
+  uint64_t data = _physical->load64(physical);
+  checkPhysical(address, SRMMU_READ);
+  return data;
+}
+
+inline uint32_t SrmmuMemory::fetch32(uint32_t address) const {
+  uint32_t physical;
+  if ((address & TLB_PAGE_MASK) > TLB_PAGE_SIZE - 4)
+    return AbstractMemory::fetch32(address);
+  if (!translate(address, SRMMU_EXECUTE, physical))
+    return 0;
+  uint32_t data = _physical->fetch32(physical);
+  checkPhysical(address, SRMMU_EXECUTE);
+  return data;
+}
+
+inline void SrmmuMemory::store32(uint32_t address, uint32_t data) {
+  uint32_t physical;
+  if ((address & TLB_PAGE_MASK) > TLB_PAGE_SIZE - 4) {
+    AbstractMemory::store32(address, data);
+  } else if (translate(address, SRMMU_WRITE, physical)) {
+    _physical->store32(physical, data);
+    checkPhysical(address, SRMMU_WRITE);
+  }
+}
+
+inline void SrmmuMemory::store16(uint32_t address, uint16_t data) {
+  uint32_t physical;
+  if ((address & TLB_PAGE_MASK) > TLB_PAGE_SIZE - 2) {
+    AbstractMemory::store16(address, data);
+  } else if (translate(address, SRMMU_WRITE, physical)) {
+    _physical->store16(physical, data);
+    checkPhysical(address, SRMMU_WRITE);
+  }
+}
+
+inline AbstractMemory* SrmmuMemory::physical() const {
+  return _physical;
+}
+
+#endif // SRMMUMEMORY_H
@@ -0,0 +1,736 @@
+/*
+ * threadedsparcengine.cpp -- implement the ThreadedSparcEngine class
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#include "threadedsparcengine.h"
+
+/*
+ * Branch conditions : for each condition, bit n is set if the branch is taken when icc == n
+ * (see SparcEngine::holds())
+ */
+static uint16_t conditions[16];
+
+static void buildConditions() {
+  for (uint32_t cond = 0; cond < 16; cond++) {
+    conditions[cond] = 0;
+    for (uint32_t icc = 0; icc < 16; icc++) {
+      if (SparcEngine::holds(cond, icc))
+        conditions[cond] |= (1 << icc);
+    }
+  }
+}
+
+// Number of the lowest bit set in a (non null) mask
+static inline uint32_t lowestBit(uint32_t mask) {
+#ifdef __GNUC__
+  return __builtin_ctz(mask);
+#else
+  uint32_t nb = 0;
+  while (((mask >> nb) & 1) == 0)
+    nb++;
+  return nb;
+#endif
+}
+
+// Cstr
+ThreadedSparcEngine::ThreadedSparcEngine(
+    AbstractMemory* mem,
+    AbstractALU* alu,
+    AbstractFPU* fpu,
+    WindowRegisters* registers,
+    SpecialRegister* psr,
+    SpecialRegister* wim,
+    SpecialRegister* tbr,
+    SpecialRegister* y,
+    SpecialRegister* pc,
+    SpecialRegister* npc,
+    SpecialRegister* fsr
+) : SparcEngine(mem, alu, fpu, registers, psr, wim, tbr, y, pc, npc, fsr),
+    _zeroval(0), _sinkval(0), _zero(&_zeroval), _sink(&_sinkval), _blockmode(false),
+    _jit(NULL), _jitthreshold(0) {
+  buildConditions();
+  _jitctx.engine = this;
+}
+
+// Dstr
+ThreadedSparcEngine::~ThreadedSparcEngine() {
+  delete _jit;
+}
+
+// Init
+void ThreadedSparcEngine::init() {
+  SparcEngine::init();
+  _blocks.flush();
+  _blocks.collect();
+}
+
+// Execute next instruction
+bool ThreadedSparcEngine::next() {
+  bool executed = (runBatch(1, SE_NO_BREAKPOINT) == SE_STOP_BUDGET);
+  alu()->syncFlags();
+  return executed;
+}
+
+// Block mode switch
+void ThreadedSparcEngine::setBlockMode(bool enabled) {
+  _blocks.flush();
+  _blocks.collect();
+  _blockmode = enabled;
+}
+
+bool ThreadedSparcEngine::isBlockModeEnabled() const {
+  return _blockmode;
+}
+
+const BlockCache& ThreadedSparcEngine::blockCache() const {
+  return _blocks;
+}
+
+// Compiler switch
+bool ThreadedSparcEngine::setJit(bool enabled, uint32_t threshold) {
+  // the compiled blocks are dropped either way
+  _blocks.flush();
+  _blocks.collect();
+  _jitthreshold = 0;
+  if (!enabled)
+    return true;
+
+  if (_jit == NULL) {
+    JitHelpers helpers;
+    helpers.load = jitLoad;
+    helpers.store = jitStore;
+    helpers.alu = jitALU;
+    _jit = new JitCompiler(helpers);
+  }
+  if (!_jit->isAvailable())
+    return false;
+  _jit->reset();
+  _jitthreshold = (threshold == 0 ? 1 : threshold);
+  return true;
+}
+
+bool ThreadedSparcEngine::isJitEnabled() const {
+  return _jitthreshold != 0;
+}
+
+const JitCompiler* ThreadedSparcEngine::jit() const {
+  return _jit;
+}
+
+// Compile a block
+void ThreadedSparcEngine::compile(BasicBlock* block) {
+  if (!_jit->compile(block)) {
+    // no compiled code is in use : the current block (if any) has not been compiled
+    _blocks.flush();
+    _jit->reset();
+  }
+}
+
+// Helpers for the compiled code
+uint32_t ThreadedSparcEngine::jitLoad(JitContext* ctx, uint32_t handler, uint32_t address) {
+  AbstractMemory* mem = ((ThreadedSparcEngine*)ctx->engine)->memory();
+  uint32_t value;
+  switch (handler) {
+    case DI_LDSB: value = signext(mem->readByte(address), 8);     break;
+    case DI_LDSH: value = signext(mem->readHalfword(address), 16); break;
+    case DI_LDUB: value = mem->readByte(address);                 break;
+    case DI_LDUH: value = mem->readHalfword(address);             break;
+    default:      value = mem->readWord(address);                 break;
+  }
+  if (mem->hasFault())
+    ctx->stop = 1;
+  return value;
+}
+
+void ThreadedSparcEngine::jitStore(JitContext* ctx, uint32_t handler, uint32_t address, uint32_t value) {
+  ThreadedSparcEngine* engine = (ThreadedSparcEngine*)ctx->engine;
+  uint32_t generation = engine->_blocks.getGeneration();
+  switch (handler) {
+    case DI_STB:
+      engine->memory()->writeByte(address, (uint8_t)value);
+      break;
+    case DI_STH:
+      engine->memory()->writeHalfword(address, (uint16_t)value);
+      break;
+    default:
+      engine->memory()->writeWord(address, value);
+      break;
+  }
+  if (engine->_blocks.getGeneration() != generation || engine->memory()->hasFault())
+    ctx->stop = 1;
+}
+
+uint32_t ThreadedSparcEngine::jitALU(JitContext* ctx, uint32_t op3, uint32_t a, uint32_t b, uint32_t rd) {
+  Register rs1(&a), dest(&rd);
+  ((ThreadedSparcEngine*)ctx->engine)->alu()->calc(op3, &rs1, b, &dest);
+  return rd;
+}
+
+// Invalidate cached instructions and blocks
+void ThreadedSparcEngine::invalidate(uint32_t address, uint32_t size) {
+  SparcEngine::invalidate(address, size);
+  _blocks.invalidate(address, size);
+}
+
+void ThreadedSparcEngine::flushDecoded() {
+  SparcEngine::flushDecoded();
+  _blocks.flush();
+}
+
+// Registers for the ALU
+Register* ThreadedSparcEngine::aluRegister(uint32_t nb, bool dest) {
+  if (nb != 0)
+    return registers()->get(nb);
+  if (dest)
+    return &_sink;
+  _zeroval = 0;
+  return &_zero;
+}
+
+// Get a block
+BasicBlock* ThreadedSparcEngine::findBlock(uint32_t address) {
+  BasicBlock* block = _blocks.lookupTarget(address);
+  if (block == NULL)
+    block = translate(address);
+  return block;
+}
+
+// Translate a block
+BasicBlock* ThreadedSparcEngine::translate(uint32_t address) {
+  BasicBlock* block = new BasicBlock(address);
+  uint32_t addr = address;
+
+  while (block->length < BC_MAX_LENGTH) {
+    const DecodedInstruction& di = fetch(addr);
+    if (di.handler == DI_HALT || di.handler == DI_IFAULT)
+      break;
+    if (di.isControlTransfer()) {
+      // Only these ones end a block; the others are executed alone
+      if (di.handler == DI_BICC || di.handler == DI_CALL || di.handler == DI_JMPL) {
+        block->code.push_back(di);
+        block->length++;
+        if (di.handler == DI_BICC) {
+          const DecodedInstruction& delay = fetch(addr + 4);
+          if (delay.handler != DI_HALT && delay.handler != DI_IFAULT && !delay.isControlTransfer()) {
+            block->code.push_back(delay);
+            block->hasdelay = true;
+          }
+        }
+      }
+      break;
+    }
+    block->code.push_back(di);
+    block->length++;
+    addr += 4;
+  }
+
+  if (block->length == 0) {
+    delete block;
+    return NULL;
+  }
+
+  DecodedInstruction exit;
+  exit.handler = DI_BLOCKEXIT;
+  block->code.push_back(exit);
+  return _blocks.insert(block);
+}
+
+// Execute several instructions
+uint32_t ThreadedSparcEngine::runBatch(uint64_t count, uint32_t breakpoint) {
+  uint64_t done = 0;
+  _stop = SE_STOP_NONE;
+  while (done < count) {
+    if (npc()->read() == breakpoint)
+      return SE_STOP_BREAKPOINT;
+
+    uint64_t n = 0;
+    if (_blockmode) {
+      // No block is in use here
+      _blocks.collect();
+      if (!_branch) {
+        BasicBlock* block = findBlock(npc()->read());
+        // room is needed for the delay slot too
+        if (block != NULL && count - done > block->length)
+          n = loop<true>(count - done, breakpoint, block);
+      }
+
+      // One instruction alone : pending delayed branch, no block here, breakpoint in the block, or not enough budget
+      if (n == 0 && _stop == SE_STOP_NONE)
+        n = loop<false>(1, breakpoint, NULL);
+    } else {
+      n = loop<false>(count - done, breakpoint, NULL);
+    }
+
+    done += n;
+    _executed += n;
+    if (_stop != SE_STOP_NONE)
+      return _stop;
+  }
+  return SE_STOP_BUDGET;
+}
+
+/*
+ * Dispatching : with computed gotos, each handler jumps directly to the next one; else, we go
+ * back to a switch.
+ */
+#ifdef TSE_COMPUTED_GOTO
+#define TSE_DISPATCH()    goto *handlers[di->handler]
+#else
+#define TSE_DISPATCH()    goto dispatch
+#endif
+#define TSE_HANDLER(h)    case DI_##h: h_##h
+
+/*
+ * Position the next pc (see SparcEngine::next()), then go to the next instruction. In block mode,
+ * it is the next one in the block.
+ */
+#define TSE_NEXT() \
+  do { \
+    if (Blocks) { \
+      pcv += 4; \
+      ++di; \
+      TSE_DISPATCH(); \
+    } \
+    if (branch) { \
+      if (isdcti) { \
+        npcv = pcv + 4; \
+        isdcti = false; \
+      } else { \
+        npcv = dcti; \
+        branch = false; \
+      } \
+    } else { \
+      npcv = pcv + 4; \
+    } \
+    if (++done == count || npcv == breakpoint) \
+      goto out; \
+    pcv = npcv; \
+    di = &fetch(pcv); \
+    TSE_DISPATCH(); \
+  } while (0)
+
+/*
+ * In block mode, after an instruction that may have modified the code : if the blocks have been
+ * dropped, leave the current one (giving back the instructions counted but not executed), unless
+ * it is over anyway.
+ */
+#define TSE_CHECK_CODE() \
+  do { \
+    if (Blocks && generation != _blocks.getGeneration() && di[1].handler != DI_BLOCKEXIT) { \
+      done -= (block->end() - pcv - 4) >> 2; \
+      target = pcv + 4; \
+      link = NULL; \
+      goto chain; \
+    } \
+  } while (0)
+
+/*
+ * After a memory access : if it has faulted (see AbstractMemory::hasFault()), nothing is written and the
+ * instruction traps, without making the access again (the guest could see it twice, an MMU for one).
+ */
+#define TSE_CHECK_FAULT() \
+  do { \
+    if (mem->hasFault()) \
+      goto faulted; \
+  } while (0)
+
+// Effective address of a format 3 instruction
+#define TSE_ADDRESS()     (regs->read(di->rs1) + (di->i ? di->imm : regs->read(di->rs2)))
+
+// Main loop
+template <bool Blocks>
+uint64_t ThreadedSparcEngine::loop(uint64_t count, uint32_t breakpoint, BasicBlock* block) {
+#ifdef TSE_COMPUTED_GOTO
+  // Must follow the order of the DI_* identifiers
+  static const void* const handlers[DI_COUNT + 2] = {
+    &&h_HALT, &&h_UNKNOWN, &&h_SETHI, &&h_BICC, &&h_FBFCC, &&h_CBCCC, &&h_CALL,
+    &&h_RDY, &&h_RDPSR, &&h_RDWIM, &&h_RDTBR, &&h_WRY, &&h_WRPSR, &&h_WRWIM, &&h_WRTBR,
+    &&h_FPOP, &&h_CPOP, &&h_JMPL, &&h_RETT, &&h_TICC, &&h_FLUSH, &&h_SAVE, &&h_RESTORE, &&h_ALU,
+    &&h_LDSB, &&h_LDSH, &&h_LDUB, &&h_LDUH, &&h_LD, &&h_LDD, &&h_STB, &&h_STH, &&h_ST, &&h_STD,
+    &&h_ALTERNATE, &&h_IFAULT, &&h_LDF, &&h_LDDF, &&h_LDFSR, &&h_STF, &&h_STDF, &&h_STFSR,
+    &&h_BLOCKEXIT, &&h_NATIVE
+  };
+#endif
+
+  if (count == 0)
+    return 0;
+
+  AbstractMemory* mem = memory();
+  WindowRegisters* regs = registers();
+  uint64_t done = 0;
+
+  // Local copies of the state
+  uint32_t npcv = npc()->read();
+  uint32_t pcv = npcv;
+  bool branch = _branch, isdcti = _isdcti;
+  uint32_t dcti = _dcti;
+  const DecodedInstruction* di;
+
+  // Block mode : where to go when leaving the current block, and the link to follow to get there
+  uint32_t target = 0;
+  BasicBlock** link = NULL;
+  uint32_t generation = 0;
+
+  if (Blocks) {
+    pcv = pc()->read();
+    goto enter;
+  }
+
+  di = &fetch(pcv);
+  TSE_DISPATCH();
+
+  // Leave the current block for the one at target
+chain:
+  npcv = target;
+  if (link != NULL && generation == _blocks.getGeneration() && *link != NULL) {
+    block = *link;
+  } else {
+    block = findBlock(target);
+    // the link is only written if its block has not been dropped in the meantime
+    if (link != NULL && generation == _blocks.getGeneration())
+      *link = block;
+  }
+  if (block == NULL)
+    goto out;
+
+  // Start a block (at npcv, with no pending branch)
+enter:
+  if (count - done <= block->length)
+    goto out;
+  // the instructions around a breakpoint are executed one by one
+  if (breakpoint - block->address < 4 * (block->length + (block->hasdelay ? 1 : 0)))
+    goto out;
+  done += block->length;
+  block->count++;
+  generation = _blocks.getGeneration();
+  if (block->count == _jitthreshold)
+    compile(block);
+  target = block->end();
+  link = &block->fallthrough;
+  pcv = block->address;
+  di = &block->code[0];
+  TSE_DISPATCH();
+
+#ifndef TSE_COMPUTED_GOTO
+dispatch:
+#endif
+  switch (di->handler) {
+    // The null word : we stay here (as SparcEngine does)
+    TSE_HANDLER(HALT):
+      _stop = SE_STOP_HALT;
+      goto out;
+
+    TSE_HANDLER(SETHI):
+      if (di->rd != 0)
+        regs->write(di->rd, di->imm);
+      TSE_NEXT();
+
+    TSE_HANDLER(BICC):
+      alu()->syncFlags();
+      branch = ((conditions[di->cond] >> psr()->getField(PSR_ICC)) & 1) == 1;
+      dcti = pcv + di->imm;
+      isdcti = (!di->a) || (branch && (di->cond & 0x07) != INST_COND_NEVER);
+      if (Blocks) {
+        if (!branch) {
+          target = pcv + 4;
+          link = &block->fallthrough;
+          goto chain;
+        }
+        branch = false;
+        target = dcti;
+        link = &block->taken;
+        if (!isdcti)
+          goto chain;
+        isdcti = false;
+        if (block->hasdelay) {
+          // the delay slot follows, then the exit of the block
+          done++;
+          TSE_NEXT();
+        }
+        // the delay slot is executed alone
+        branch = true;
+        npcv = pcv + 4;
+        goto out;
+      }
+      TSE_NEXT();
+
+    TSE_HANDLER(CALL):
+      dcti = pcv + di->imm;
+      regs->write(15, pcv >> 2);
+      if (Blocks) {
+        isdcti = false;
+        _blocks.pushReturn(pcv + 4, block->fallthrough);
+        target = dcti;
+        link = &block->taken;
+        goto chain;
+      }
+      branch = true;
+      isdcti = false;
+      TSE_NEXT();
+
+    TSE_HANDLER(JMPL):
+      dcti = TSE_ADDRESS() << 2;
+      if (di->rd != 0)
+        regs->write(di->rd, pcv >> 2);
+      if (Blocks) {
+        isdcti = false;
+        target = dcti;
+        link = NULL;
+        // a return (ret, retl) : try the return address stack first
+        if (di->rd == 0) {
+          block = _blocks.popReturn(target);
+          if (block != NULL) {
+            npcv = target;
+            goto enter;
+          }
+        }
+        goto chain;
+      }
+      branch = true;
+      isdcti = false;
+      TSE_NEXT();
+
+    TSE_HANDLER(SAVE):
+    TSE_HANDLER(RESTORE): {
+        // operands are read in the old window, result written in the new one; an invalid window is for the reference
+        if (!(di->handler == DI_SAVE ? regs->canSave() : regs->canRestore()))
+          goto reference;
+        uint32_t res = TSE_ADDRESS();
+        if (di->handler == DI_SAVE)
+          regs->save();
+        else
+          regs->restore();
+        if (di->rd != 0)
+          regs->write(di->rd, res);
+      }
+      TSE_NEXT();
+
+    TSE_HANDLER(FLUSH):
+      invalidate(TSE_ADDRESS() & 0xFFFFFFF8, 8);
+      TSE_CHECK_CODE();
+      TSE_NEXT();
+
+    TSE_HANDLER(ALU): {
+        uint32_t a = regs->read(di->rs1);
+        uint32_t b = di->i ? di->imm : regs->read(di->rs2);
+        uint32_t res;
+
+        // Operations that do not touch the condition codes nor y are made here
+        switch (di->op3) {
+          case ALU_OP_ADD:  res = a + b;  break;
+          case ALU_OP_AND:  res = a & b;  break;
+          case ALU_OP_OR:   res = a | b;  break;
+          case ALU_OP_XOR:  res = a ^ b;  break;
+          case ALU_OP_SUB:  res = a - b;  break;
+          case ALU_OP_ANDN: res = a & ~b; break;
+          case ALU_OP_ORN:  res = a | ~b; break;
+          case ALU_OP_XNOR: res = a ^ ~b; break;
+          case ALU_OP_SLL:
+          case ALU_OP_SRL:
+          case ALU_OP_SRA:  res = AbstractALU::shift(di->op3, a, b); break;
+          default:
+            // the others are left to the ALU
+            alu()->calc(di->op3, aluRegister(di->rs1, false), b, aluRegister(di->rd, true));
+            TSE_NEXT();
+        }
+
+        if (di->rd != 0)
+          regs->write(di->rd, res);
+      }
+      TSE_NEXT();
+
+    // Loads
+    TSE_HANDLER(LDSB): {
+        uint32_t v = signext(mem->readByte(TSE_ADDRESS()), 8);
+        TSE_CHECK_FAULT();
+        if (di->rd != 0)
+          regs->write(di->rd, v);
+      }
+      TSE_NEXT();
+    TSE_HANDLER(LDSH): {
+        uint32_t v = signext(mem->readHalfword(TSE_ADDRESS()), 16);
+        TSE_CHECK_FAULT();
+        if (di->rd != 0)
+          regs->write(di->rd, v);
+      }
+      TSE_NEXT();
+    TSE_HANDLER(LDUB): {
+        uint32_t v = mem->readByte(TSE_ADDRESS());
+        TSE_CHECK_FAULT();
+        if (di->rd != 0)
+          regs->write(di->rd, v);
+      }
+      TSE_NEXT();
+    TSE_HANDLER(LDUH): {
+        uint32_t v = mem->readHalfword(TSE_ADDRESS());
+        TSE_CHECK_FAULT();
+        if (di->rd != 0)
+          regs->write(di->rd, v);
+      }
+      TSE_NEXT();
+    TSE_HANDLER(LD): {
+        uint32_t v = mem->readWord(TSE_ADDRESS());
+        TSE_CHECK_FAULT();
+        if (di->rd != 0)
+          regs->write(di->rd, v);
+      }
+      TSE_NEXT();
+
+    // Stores
+    TSE_HANDLER(STB): {
+        uint32_t addr = TSE_ADDRESS();
+        mem->writeByte(addr, (uint8_t)regs->read(di->rd));
+        TSE_CHECK_FAULT();
+      }
+      TSE_CHECK_CODE();
+      TSE_NEXT();
+    TSE_HANDLER(STH): {
+        uint32_t addr = TSE_ADDRESS();
+        mem->writeHalfword(addr, (uint16_t)regs->read(di->rd));
+        TSE_CHECK_FAULT();
+      }
+      TSE_CHECK_CODE();
+      TSE_NEXT();
+    TSE_HANDLER(ST): {
+        uint32_t addr = TSE_ADDRESS();
+        mem->writeWord(addr, regs->read(di->rd));
+        TSE_CHECK_FAULT();
+      }
+      TSE_CHECK_CODE();
+      TSE_NEXT();
+
+    // Everything else is done by the reference engine
+    TSE_HANDLER(UNKNOWN):
+    TSE_HANDLER(FBFCC):
+    TSE_HANDLER(CBCCC):
+    TSE_HANDLER(RDY):
+    TSE_HANDLER(RDPSR):
+    TSE_HANDLER(RDWIM):
+    TSE_HANDLER(RDTBR):
+    TSE_HANDLER(WRY):
+    TSE_HANDLER(WRPSR):
+    TSE_HANDLER(WRWIM):
+    TSE_HANDLER(WRTBR):
+    TSE_HANDLER(FPOP):
+    TSE_HANDLER(CPOP):
+    TSE_HANDLER(RETT):
+    TSE_HANDLER(TICC):
+    TSE_HANDLER(LDD):
+    TSE_HANDLER(STD):
+    TSE_HANDLER(ALTERNATE):
+    TSE_HANDLER(IFAULT):
+    TSE_HANDLER(LDF):
+    TSE_HANDLER(LDDF):
+    TSE_HANDLER(LDFSR):
+    TSE_HANDLER(STF):
+    TSE_HANDLER(STDF):
+    TSE_HANDLER(STFSR):
+    default:
+    reference:
+      pc()->write(pcv);
+      if (Blocks) {
+        // the instructions of a block do not branch, but the branch of the block is pending in its delay slot
+        _branch = (pcv == block->end());
+        _isdcti = false;
+        _dcti = target;
+      } else {
+        _branch = branch;
+        _isdcti = isdcti;
+        _dcti = dcti;
+      }
+      execute(*di);
+      if (_trapped)
+        goto trapped;
+      if (!Blocks) {
+        branch = _branch;
+        isdcti = _isdcti;
+        dcti = _dcti;
+      }
+      TSE_CHECK_CODE();
+      TSE_NEXT();
+
+    // A memory access has faulted and left its destination alone : trap as the reference engine would have
+    faulted:
+      pc()->write(pcv);
+      if (Blocks) {
+        _branch = (pcv == block->end());
+        _isdcti = false;
+        _dcti = target;
+      } else {
+        _branch = branch;
+        _isdcti = isdcti;
+        _dcti = dcti;
+      }
+      trap(faultTrap(mem));
+      goto trapped;
+
+    // The instruction has trapped (see SparcEngine::trap())
+    trapped:
+      _trapped = false;
+      if (_stop != SE_STOP_NONE) {
+        // the engine stays on the instruction; in block mode, give back the instructions counted but
+        // not executed, this one included (the branch of the block is pending again in its delay slot)
+        if (Blocks)
+          done -= (pcv == block->end() ? 1 : (block->end() - pcv) >> 2);
+        branch = _branch;
+        isdcti = _isdcti;
+        dcti = _dcti;
+        npcv = pcv;
+        goto out;
+      }
+      if (Blocks) {
+        // leave the block for the trap table
+        if (pcv != block->end())
+          done -= (block->end() - pcv - 4) >> 2;
+        target = _dcti;
+        link = NULL;
+        goto chain;
+      }
+      branch = _branch;
+      isdcti = _isdcti;
+      dcti = _dcti;
+      TSE_NEXT();
+
+    // End of a block (only in block mode) : target and link have been set before
+    TSE_HANDLER(BLOCKEXIT):
+      pcv -= 4;
+      goto chain;
+
+    // Compiled instructions (only in block mode)
+    TSE_HANDLER(NATIVE): {
+        const NativeSegment& segment = block->native[di->imm];
+        for (uint32_t live = segment.live; live != 0; live &= live - 1) {
+          uint32_t nb = lowestBit(live);
+          _jitctx.r[nb] = regs->read(nb);
+        }
+        _jitctx.stop = 0;
+        uint32_t n = segment.entry(&_jitctx);
+        for (uint32_t defined = segment.defined; defined != 0; defined &= defined - 1) {
+          uint32_t nb = lowestBit(defined);
+          regs->write(nb, _jitctx.r[nb]);
+        }
+        // go to the last instruction executed
+        pcv += 4 * (n - 1);
+        di += n - 1;
+        if (mem->hasFault())
+          goto faulted;
+      }
+      TSE_CHECK_CODE();
+      TSE_NEXT();
+  }
+
+out:
+  // Write back the state
+  pc()->write(pcv);
+  npc()->write(npcv);
+  _branch = branch;
+  _isdcti = isdcti;
+  _dcti = dcti;
+  return done;
+}
+
+template uint64_t ThreadedSparcEngine::loop<false>(uint64_t count, uint32_t breakpoint, BasicBlock* block);
+template uint64_t ThreadedSparcEngine::loop<true>(uint64_t count, uint32_t breakpoint, BasicBlock* block);
+
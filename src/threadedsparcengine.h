@@ -0,0 +1,201 @@
+/*
+ * threadedsparcengine.h -- defines a sparc engine with threaded dispatch
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef THREADEDSPARCENGINE_H
+#define THREADEDSPARCENGINE_H
+
+#include "sparcengine.h"
+#include "blockcache.h"
+#include "jitcompiler.h"
+
+// Use GCC's "labels as values" for dispatching when it is available
+#if defined(__GNUC__)
+#define TSE_COMPUTED_GOTO
+#endif
+
+/**
+ * This engine executes the same instruction set as SparcEngine, with the same semantics, but is
+ * made for speed rather than readability.
+ *
+ * Instructions are decoded once (see DecodedInstruction) and then executed by jumping directly
+ * from the handler of an instruction to the handler of the next one, through a table indexed by
+ * the handler identifier ("threaded code"). The program counters and the delayed branch state
+ * are kept in local variables for as long as the engine runs, so that run() executes many
+ * instructions per call without going back to the caller. A breakpoint (see runUntil()) costs a
+ * comparison per instruction, or per block in block mode.
+ *
+ * Only the frequent instructions have their own handler; the others (special registers, traps,
+ * double word accesses, etc.) are given to SparcEngine::execute(), which stays the reference.
+ *
+ * In block mode (see setBlockMode()), the engine translates the code into basic blocks (see
+ * BlockCache) and runs a whole block without looking at the program counter, then goes directly to
+ * the next block through the links between blocks. Delayed branches whose delay slot cannot be part
+ * of a block, and instructions that cannot start one, are executed one by one as in the normal mode.
+ *
+ * On top of the block mode, the hot blocks can be compiled into host code (see setJit() and
+ * JitCompiler); the parts of the blocks which cannot be compiled are still interpreted.
+ *
+ * @see SparcEngine
+ */
+class ThreadedSparcEngine : public SparcEngine {
+	public:
+    /**
+     * Constructor.
+     * @see AbstractSparcEngine::AbstractSparcEngine()
+     */
+		ThreadedSparcEngine(
+        AbstractMemory* mem,
+        AbstractALU* alu,
+        AbstractFPU* fpu,
+        WindowRegisters* registers,
+        SpecialRegister* psr,
+        SpecialRegister* wim,
+        SpecialRegister* tbr,
+        SpecialRegister* y,
+        SpecialRegister* pc,
+        SpecialRegister* npc,
+        SpecialRegister* fsr
+    );
+    /**
+     * Destructor
+     */
+		~ThreadedSparcEngine();
+
+    /**
+     * Execute next instruction
+     * @see AbstractSparcEngine::next()
+     */
+    bool next();
+
+    /**
+     * (Re-)initialize sparc engine
+     * @see SparcEngine::init()
+     */
+    void init();
+
+    /**
+     * Enable or disable the block mode
+     * @param enabled true to run basic blocks
+     */
+    void setBlockMode(bool enabled);
+    /**
+     * Tells if the block mode is enabled
+     * @returns true if the engine runs basic blocks
+     */
+    bool isBlockModeEnabled() const;
+    /**
+     * Get the block cache (mainly for statistics)
+     * @returns the cache
+     */
+    const BlockCache& blockCache() const;
+
+    /**
+     * Enable or disable the compilation of hot blocks into host code (only used in block mode)
+     * @param enabled true to compile blocks
+     * @param threshold number of executions of a block before it is compiled
+     * @returns false if the compiler cannot be used on this host
+     */
+    bool setJit(bool enabled, uint32_t threshold = JIT_THRESHOLD);
+    /**
+     * Tells if the hot blocks are compiled
+     * @returns true if the compiler is enabled
+     */
+    bool isJitEnabled() const;
+    /**
+     * Get the compiler (mainly for statistics)
+     * @returns the compiler, or NULL if it has never been enabled
+     */
+    const JitCompiler* jit() const;
+
+	protected:
+    /**
+     * Drop the cached instructions and blocks overlapping a modified range of memory
+     * @see SparcEngine::invalidate()
+     */
+    void invalidate(uint32_t address, uint32_t size);
+    /**
+     * Drop every cached instruction and block
+     * @see SparcEngine::flushDecoded()
+     */
+    void flushDecoded();
+    /**
+     * Execute several instructions in a row, with the threaded loop (and the blocks)
+     * @see SparcEngine::runBatch()
+     */
+    uint32_t runBatch(uint64_t count, uint32_t breakpoint);
+
+	private:
+    /**
+     * Main loop
+     * Stops when the count is reached, before the instruction at the breakpoint, or when the engine
+     * stops by itself (_stop is then set).
+     * @param count maximum number of instructions to execute
+     * @param breakpoint address of the breakpoint (SE_NO_BREAKPOINT for none)
+     * @param block (in block mode) first block to execute, which must start at the next pc
+     * @returns number of instructions executed
+     */
+    template <bool Blocks>
+    uint64_t loop(uint64_t count, uint32_t breakpoint, BasicBlock* block);
+
+    /**
+     * Get the block starting at a given address, translating it if needed
+     * @param address address of the block
+     * @returns the block, or NULL if no block can start at this address
+     */
+    BasicBlock* findBlock(uint32_t address);
+    /**
+     * Translate the code at a given address into a block, and add it to the cache
+     * @param address address of the block
+     * @returns the block, or NULL if no block can start at this address
+     */
+    BasicBlock* translate(uint32_t address);
+    /**
+     * Compile a block; if the compiler is full, every block is dropped and the compiler restarts
+     * @param block the block
+     */
+    void compile(BasicBlock* block);
+
+    /**
+     * Helpers for the compiled code
+     * @see JitHelpers
+     */
+    static uint32_t jitLoad(JitContext* ctx, uint32_t handler, uint32_t address);
+    static void jitStore(JitContext* ctx, uint32_t handler, uint32_t address, uint32_t value);
+    static uint32_t jitALU(JitContext* ctx, uint32_t op3, uint32_t a, uint32_t b, uint32_t rd);
+
+    /**
+     * Get a register for the ALU, without allocating anything for %g0
+     * @param nb register number
+     * @param dest true if the register is written
+     * @returns the register
+     */
+    Register* aluRegister(uint32_t nb, bool dest);
+
+    /**
+     * %g0 as a source (always 0) and as a destination (written values are lost)
+     */
+    uint32_t _zeroval, _sinkval;
+    Register _zero, _sink;
+
+    /**
+     * Translated blocks
+     */
+    BlockCache _blocks;
+    /**
+     * Is the block mode enabled ?
+     */
+    bool _blockmode;
+
+    /**
+     * Compiler (NULL until it is enabled), threshold (0 when disabled) and context of the compiled code
+     */
+    JitCompiler* _jit;
+    uint32_t _jitthreshold;
+    JitContext _jitctx;
+};
+
+#endif // THREADEDSPARCENGINE_H
+
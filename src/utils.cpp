@@ -3,20 +3,6 @@
  */
 #include "utils.h"
 
-// Subbits of an int
-uint32_t sub(uint32_t data, uint32_t from, uint32_t size) {
-  return (data & ((0xFFFFFFFF >> (32 - size)) << from)) >> from;
-}
-
-// Sign extension
-uint32_t signext(uint32_t data, uint32_t size) {
-  if ((data >> (size - 1)) == 1) { // it is negative
-    return data | (0xFFFFFFFF << size);
-  } else {
-    return data;
-  }
-}
-
 // Sign extension for 64 bits
 uint64_t signext64(uint64_t data, uint32_t size) {
   if ((data >> (size - 1)) == 1) { // it is negative
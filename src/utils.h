@@ -22,13 +22,57 @@
  * @param size number of bits to retrieve
  * @returns the data
  */
-uint32_t sub(uint32_t data, uint32_t from, uint32_t size);
+inline uint32_t sub(uint32_t data, uint32_t from, uint32_t size) {
+  return (data & ((0xFFFFFFFF >> (32 - size)) << from)) >> from;
+}
 /**
  * Sign-extend a value
  * @param data to sign-extend
  * @param size size of the original value
  */
-uint32_t signext(uint32_t data, uint32_t size);
+inline uint32_t signext(uint32_t data, uint32_t size) {
+  if ((data >> (size - 1)) == 1) { // it is negative
+    return data | (0xFFFFFFFF << size);
+  } else {
+    return data;
+  }
+}
+/**
+ * Convert a 32 bits value between the big endian order (the one of the guest) and the order of the host
+ * @param data value to convert
+ * @returns the converted value
+ */
+inline uint32_t bigEndian32(uint32_t data) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap32(data);
+#else
+  return data;
+#endif
+}
+/**
+ * Convert a 16 bits value between the big endian order and the order of the host
+ * @param data value to convert
+ * @returns the converted value
+ */
+inline uint16_t bigEndian16(uint16_t data) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap16(data);
+#else
+  return data;
+#endif
+}
+/**
+ * Convert a 16 bits value between the little endian order and the order of the host
+ * @param data value to convert
+ * @returns the converted value
+ */
+inline uint16_t littleEndian16(uint16_t data) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return data;
+#else
+  return __builtin_bswap16(data);
+#endif
+}
 /**
  * Sign-extend a 64 bits value
  * @param data to sign-extend
@@ -0,0 +1,173 @@
+/*
+ * windowregisterfile.h -- a register file whose number of windows is known at compile time
+ * ------
+ * Author: krab
+ * Version: 0.1
+ */
+#ifndef WINDOWREGISTERFILE_H
+#define WINDOWREGISTERFILE_H
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "windowregisters.h"
+
+// Size of the cache lines of the host
+#define WRF_CACHE_LINE  64
+
+/**
+ * The array of a WindowRegisterFile, in a base class of its own : it is built (zeroed) before the WindowRegisters
+ * makes its views on it.
+ */
+template <uint32_t NWINDOWS>
+struct WindowRegisterSpace {
+  WindowRegisterSpace() : space() {}
+
+  alignas(WRF_CACHE_LINE) uint32_t space[NREGGLOB + NWINDOWS*NREGWIN + NREGIO];
+};
+
+/**
+ * A WindowRegisters for a number of windows given at compile time (2 to 32), for the engines that know the type of
+ * their register file (see BasicSparcEngine) : the changes of window and the checks of the WIM are inline, the
+ * wrap-around of the CWP is a mask (or a constant modulo when the number of windows is not a power of two).
+ *
+ * The array is in a private base, aligned on a cache line : the globals are in the first line, and the 24 registers
+ * of any window (its outs and locals, then its ins) exactly in two lines.
+ *
+ * The functions of WindowRegisters work on the same array, so that the engines that only know a WindowRegisters
+ * (SparcEngine, which the faster engines fall back to, the tools) see the same registers. The unbounded mode is
+ * not available : WindowRegisters remains the register file for it and for the numbers of windows only known at
+ * run time.
+ */
+template <uint32_t NWINDOWS>
+class WindowRegisterFile : private WindowRegisterSpace<NWINDOWS>, public WindowRegisters {
+  static_assert(NWINDOWS >= 2 && NWINDOWS <= 32, "a SPARC has 2 to 32 windows");
+
+	public:
+    /**
+     * Constructor
+     * @param psr processor state register
+     * @param wim window invalid mask register
+     */
+		WindowRegisterFile(SpecialRegister* psr, SpecialRegister* wim);
+    /**
+     * Destructor
+     */
+		~WindowRegisterFile();
+
+    /**
+     * Allocation on a cache line (before C++17, new does not honour the alignment of the array)
+     */
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p);
+
+    /**
+     * Save context
+     * @see WindowRegisters::save()
+     */
+    void save();
+    /**
+     * Restore context
+     * @see WindowRegisters::restore()
+     */
+    void restore();
+    /**
+     * @see WindowRegisters::canSave()
+     */
+    bool canSave() const;
+    /**
+     * @see WindowRegisters::canRestore()
+     */
+    bool canRestore() const;
+
+	private:
+    /**
+     * Make a window the current one
+     * @param cwp the window
+     */
+    void enter(uint32_t cwp);
+    /**
+     * The windows after and before one
+     * @param cwp the window
+     * @returns its neighbour
+     */
+    static uint32_t next(uint32_t cwp);
+    static uint32_t previous(uint32_t cwp);
+};
+
+// Cstr
+template <uint32_t NWINDOWS>
+WindowRegisterFile<NWINDOWS>::WindowRegisterFile(SpecialRegister* psr, SpecialRegister* wim) :
+    WindowRegisters(NWINDOWS, psr, wim, WindowRegisterSpace<NWINDOWS>::space) {
+}
+
+// Dstr
+template <uint32_t NWINDOWS>
+WindowRegisterFile<NWINDOWS>::~WindowRegisterFile() {
+}
+
+// Allocation
+template <uint32_t NWINDOWS>
+void* WindowRegisterFile<NWINDOWS>::operator new(std::size_t size) {
+  void* p;
+  if (posix_memalign(&p, WRF_CACHE_LINE, size) != 0)
+    throw std::bad_alloc();
+  return p;
+}
+
+template <uint32_t NWINDOWS>
+void WindowRegisterFile<NWINDOWS>::operator delete(void* p) {
+  std::free(p);
+}
+
+// Neighbours : the conditions are constants
+template <uint32_t NWINDOWS>
+inline uint32_t WindowRegisterFile<NWINDOWS>::next(uint32_t cwp) {
+  if ((NWINDOWS & (NWINDOWS - 1)) == 0)
+    return (cwp + 1) & (NWINDOWS - 1);
+  return (cwp + 1) % NWINDOWS;
+}
+
+template <uint32_t NWINDOWS>
+inline uint32_t WindowRegisterFile<NWINDOWS>::previous(uint32_t cwp) {
+  if ((NWINDOWS & (NWINDOWS - 1)) == 0)
+    return (cwp - 1) & (NWINDOWS - 1);
+  return (cwp + NWINDOWS - 1) % NWINDOWS;
+}
+
+// Change of window, as WindowRegisters::setWindow() does it
+template <uint32_t NWINDOWS>
+inline void WindowRegisterFile<NWINDOWS>::enter(uint32_t cwp) {
+  uint32_t* outs = _file + NREGGLOB;
+  uint32_t* shadow = _file + NREGGLOB + NWINDOWS*NREGWIN;
+  if (_cwp == NWINDOWS - 1)
+    std::memcpy(outs, shadow, NREGIO * sizeof(uint32_t));
+  else if (cwp == NWINDOWS - 1)
+    std::memcpy(shadow, outs, NREGIO * sizeof(uint32_t));
+  _cwp = cwp;
+  _window = _file + cwp*NREGWIN;
+  _psr->setField(PSR_CWP, cwp);
+}
+
+template <uint32_t NWINDOWS>
+inline void WindowRegisterFile<NWINDOWS>::save() {
+  enter(next(_cwp));
+}
+
+template <uint32_t NWINDOWS>
+inline void WindowRegisterFile<NWINDOWS>::restore() {
+  enter(previous(_cwp));
+}
+
+template <uint32_t NWINDOWS>
+inline bool WindowRegisterFile<NWINDOWS>::canSave() const {
+  return ((_wim->read() >> next(_cwp)) & 1) == 0;
+}
+
+template <uint32_t NWINDOWS>
+inline bool WindowRegisterFile<NWINDOWS>::canRestore() const {
+  return ((_wim->read() >> previous(_cwp)) & 1) == 0;
+}
+
+#endif // WINDOWREGISTERFILE_H
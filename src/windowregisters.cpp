@@ -3,23 +3,32 @@
  */
 #include "windowregisters.h"
 
+#include <cstring>
+
 using namespace std;
 
 // Cstr
-WindowRegisters::WindowRegisters(const uint32_t wsize, SpecialRegister* psr, SpecialRegister* wim) : _wsize(wsize) {
-  _psr = psr;
-  _wim = wim;
-
+WindowRegisters::WindowRegisters(const uint32_t wsize, SpecialRegister* psr, SpecialRegister* wim, bool unbounded) :
+    _wsize(wsize), _file(NULL), _window(NULL), _cwp(0), _psr(psr), _wim(wim), _unbounded(unbounded), _windows(0),
+    _index(0), _nextzero(0) {
   /*
    * Registers :
    * [0..NREGGLOB-1]                                                                      globals
    * [cwp*(NREGIO+NREGLOC)+(NREGGLOB..NREGGLOB+NREGIO-1)]                                 outs
    * [cwp*(NREGIO+NREGLOC)+(NREGGLOB+NREGIO..NREGGLOB+NREGIO+NREGLOC-1)]                  locals
    * [cwp*(NREGIO+NREGLOC)+(NREGGLOB+NREGIO+NREGLOC..NREGGLOB+NREGIO+NREGLOC+NREGIO-1)]   ins
+   * The ins of a window are the outs of the next one; the ins of the last window are the outs of the first one,
+   * kept after the last window while it is the current one. In the unbounded mode, the window of the array is
+   * _index instead of cwp, and the ins of the last window are the outs of the next one, as for the others.
    */
-  _registers = new Register[NREGGLOB+_wsize*NREGIO+_wsize*NREGLOC];
+  _store.assign(NREGGLOB, 0); // %g0 always equals to 0
+  grow(0, _wsize);
+}
 
-  _registers[0].write(0x00000000); // %g0 always equals to 0
+WindowRegisters::WindowRegisters(const uint32_t wsize, SpecialRegister* psr, SpecialRegister* wim, uint32_t* file) :
+    _wsize(wsize), _file(file), _window(file), _cwp(0), _psr(psr), _wim(wim), _unbounded(false), _windows(wsize),
+    _index(0), _nextzero(0) {
+  makeViews();
 }
 
 // Dstr
@@ -31,68 +40,170 @@ uint32_t WindowRegisters::getWindowSize() const {
   return _wsize;
 }
 
+bool WindowRegisters::isUnbounded() const {
+  return _unbounded;
+}
+
+uint32_t WindowRegisters::getAllocatedWindows() const {
+  return _windows;
+}
+
 // Get a pointer to a register
 Register* WindowRegisters::get(uint32_t nb) {
-  uint32_t cwp = _psr->getField(PSR_CWP);
   if (nb == 0) {
-    Register* r = new Register();
+    Register* r = &_zeros[_nextzero];
+    _nextzero = (_nextzero + 1) % NREGZERO;
     r->write(0);
-    return r; // these registers should always be given by copy
-  } else if (nb < NREGGLOB) { // Want to access global registers
-    return &_registers[nb];
-  } else if (cwp == _wsize - 1 && nb >= NREGIO+NREGLOC+NREGGLOB) {
-    // Want to access input of the last window, which are the
-    // outputs of the first
-    return &_registers[nb-NREGLOC-NREGIO];
-  } else {
-    return &_registers[cwp*(NREGIO+NREGLOC)+nb];
+    return r;
   }
+  return &_views[index(nb)];
 }
 
-// Read write operations
-uint32_t WindowRegisters::read(uint32_t nb) const {
-  uint32_t cwp = _psr->getField(PSR_CWP);
-  if (nb == 0) {
-    return 0;
-  } else if (nb < NREGGLOB) { // Want to access global registers
-    return _registers[nb].read();
-  } else if (cwp == _wsize - 1 && nb >= NREGIO+NREGLOC+NREGGLOB) {
-    // Want to access input of the last window, which are the
-    // outputs of the first
-    return _registers[nb-NREGLOC-NREGIO].read();
-  } else {
-    return _registers[cwp*(NREGIO+NREGLOC)+nb].read();
-  }
+// Change of window : the outs of the first window follow the last one
+void WindowRegisters::setWindow(uint32_t cwp) {
+  uint32_t* outs = _file + NREGGLOB;
+  uint32_t* shadow = _file + NREGGLOB + _wsize*NREGWIN;
+  if (_cwp == _wsize - 1 && cwp != _wsize - 1)
+    memcpy(outs, shadow, NREGIO * sizeof(uint32_t));
+  else if (cwp == _wsize - 1 && _cwp != _wsize - 1)
+    memcpy(shadow, outs, NREGIO * sizeof(uint32_t));
+  _cwp = cwp;
+  _window = _file + cwp*NREGWIN;
+}
+
+// Unbounded mode : a window further in the array, which grows by doubling
+void WindowRegisters::moveWindow(uint32_t cwp, int32_t delta) {
+  if (delta < 0 && (uint32_t)-delta > _index)
+    grow(_windows, 0);
+  else if (delta > 0 && _index + delta >= _windows)
+    grow(0, _windows);
+  _index += delta;
+  _cwp = cwp;
+  _window = _file + _index*NREGWIN;
+}
+
+void WindowRegisters::grow(uint32_t before, uint32_t after) {
+  // the globals stay at the beginning, the windows (and the ins of the last one) move by the windows added
+  _store.insert(_store.begin() + NREGGLOB, before*NREGWIN, 0);
+  _store.resize(NREGGLOB + (_windows + before + after)*NREGWIN + NREGIO, 0);
+  _windows += before + after;
+  _index += before;
+  _file = _store.data();
+  _window = _file + (_unbounded ? _index : _cwp)*NREGWIN;
+  makeViews();
+}
+
+void WindowRegisters::makeViews() {
+  uint32_t size = NREGGLOB + _windows*NREGWIN + NREGIO;
+  _views.clear();
+  _views.reserve(size);
+  for (uint32_t k = 0; k < size; k++)
+    _views.push_back(Register(&_file[k]));
 }
 
-void WindowRegisters::write(uint32_t nb, uint32_t data) {
-  return get(nb)->write(data);
+void WindowRegisters::update() {
+  uint32_t cwp = _psr->getField(PSR_CWP) % _wsize;
+  if (!_unbounded) {
+    setWindow(cwp);
+    return;
+  }
+
+  // the nearest window of this CWP
+  int32_t delta = (int32_t)((cwp + _wsize - _cwp) % _wsize);
+  if (delta > (int32_t)_wsize / 2)
+    delta -= _wsize;
+  moveWindow(cwp, delta);
 }
 
-// Save and restore context
+// Save and restore context (the windows wrap around, or grow; the WIM is for the engine to check)
 void WindowRegisters::save() {
-  uint32_t cwp = _psr->getField(PSR_CWP);
-  if (cwp == _wsize - 1) {// overflow !
-    _wim->setField(_wsize, 0, 1);
-    cwp = 0;
+  uint32_t cwp = (_cwp == _wsize - 1 ? 0 : _cwp + 1);
+  if (!_unbounded) {
+    setWindow(cwp);
   } else {
-    cwp = cwp + 1;
+    if (((_wim->read() >> cwp) & 1) != 0)
+      rotateInvalid(true); // as spill() would have
+    moveWindow(cwp, 1);
   }
-
   _psr->setField(PSR_CWP, cwp);
 }
 
 void WindowRegisters::restore() {
-  uint32_t cwp = _psr->getField(PSR_CWP);
-  if (cwp == 0) {// underflow !
-    _wim->setField(_wsize, 0, 1);
-    cwp = _wsize - 1;
+  uint32_t cwp = (_cwp == 0 ? _wsize - 1 : _cwp - 1);
+  if (!_unbounded) {
+    setWindow(cwp);
   } else {
-    cwp = cwp - 1;
+    if (((_wim->read() >> cwp) & 1) != 0)
+      rotateInvalid(false); // as fill() would have
+    moveWindow(cwp, -1);
   }
-
   _psr->setField(PSR_CWP, cwp);
 }
 
+// Invalid windows
+bool WindowRegisters::canSave() const {
+  return _unbounded || ((_wim->read() >> ((_cwp + 1) % _wsize)) & 1) == 0;
+}
+
+bool WindowRegisters::canRestore() const {
+  return _unbounded || ((_wim->read() >> ((_cwp + _wsize - 1) % _wsize)) & 1) == 0;
+}
+
+uint32_t* WindowRegisters::outs(uint32_t cwp) {
+  if (cwp == 0 && _cwp == _wsize - 1)
+    return _file + NREGGLOB + _wsize*NREGWIN;
+  return _file + NREGGLOB + cwp*NREGWIN;
+}
+
+void WindowRegisters::rotateInvalid(bool left) {
+  uint32_t mask = (_wsize == 32 ? 0xFFFFFFFF : (1u << _wsize) - 1);
+  uint32_t wim = _wim->read() & mask;
+  if (left)
+    wim = (wim << 1) | (wim >> (_wsize - 1));
+  else
+    wim = (wim >> 1) | (wim << (_wsize - 1));
+  _wim->write(wim & mask);
+}
 
+// Window overflow and underflow in the host : the 16 registers in one block, big-endian as the stores make them
+bool WindowRegisters::spill(AbstractMemory* memory) {
+  uint32_t w = (_cwp + 2) % _wsize;
+  uint32_t* out = outs(w);
+  uint32_t address = outs((w + 1) % _wsize)[6]; // %i6 of the window
+  if ((address & 7) != 0)
+    return false;
+
+  uint32_t block[NREGWIN];
+  for (uint32_t k = 0; k < NREGLOC; k++)
+    block[k] = bigEndian32(_file[NREGGLOB + w*NREGWIN + NREGIO + k]);
+  for (uint32_t k = 0; k < NREGIO; k++)
+    block[NREGLOC + k] = bigEndian32(out[k]);
+  memory->copyIn(address, (const uint8_t*)block, sizeof(block));
+  if (memory->hasFault()) {
+    memory->clearFault();
+    return false;
+  }
+  rotateInvalid(true);
+  return true;
+}
 
+bool WindowRegisters::fill(AbstractMemory* memory) {
+  uint32_t w = (_cwp + _wsize - 1) % _wsize;
+  uint32_t address = read(REG_OUT(6)); // the %i6 of the window
+  if ((address & 7) != 0)
+    return false;
+
+  uint32_t block[NREGWIN];
+  memory->copyOut(address, (uint8_t*)block, sizeof(block));
+  if (memory->hasFault()) {
+    memory->clearFault();
+    return false;
+  }
+  uint32_t* out = outs(w);
+  for (uint32_t k = 0; k < NREGLOC; k++)
+    _file[NREGGLOB + w*NREGWIN + NREGIO + k] = bigEndian32(block[k]);
+  for (uint32_t k = 0; k < NREGIO; k++)
+    out[k] = bigEndian32(block[NREGLOC + k]);
+  rotateInvalid(false);
+  return true;
+}
@@ -4,6 +4,9 @@
 #ifndef WINDOWREGISTERS_H
 #define WINDOWREGISTERS_H
 
+#include <vector>
+
+#include "abstractmemory.h"
 #include "specialregister.h"
 #include "register.h"
 
@@ -18,34 +21,72 @@
 #define REG_OUT(n)  n+NREGGLOB
 #define REG_LOC(n)  n+NREGGLOB+NREGIO
 
+// Registers of a window (outs and locals; the ins are the outs of the next one)
+#define NREGWIN     (NREGIO+NREGLOC)
+
+// Number of scratch registers given by get(0) in turn (the operands of an instruction must be distinct)
+#define NREGZERO    4
+
 /**
  * This class defines the general windowed register system of a SPARC architecture.
  * Basically, each context can access 4 types of registers : globals, which are the same for every context; locals, which are specific to each context and input and outputs, which are shared from adjacent context.
  * Indeed, the inputs of context N is the outputs of context N+1, which makes easy argument and result transfer between context.
- * The context number is given by the CWP field of the PSR. When CWPmax is reached and we increment it (or when 0 is reached and we decrement it), the WIM register is positionned to indicate the incriminated register that caused an over/underflow.
+ * The context number is given by the CWP field of the PSR. save() increments it and restore() decrements it, modulo the number of windows.
+ *
+ * The windows whose bit is set in the WIM are invalid : the engine raises a window overflow (or underflow) instead
+ * of a save (or restore) that would enter one (see canSave()). The handler of the program makes room by storing the
+ * oldest window on its stack and moving the invalid window; spill() and fill() do the same work in the host.
+ * As the windows go the other way than on a real SPARC, the registers a window shares with the one before it
+ * (in the order of the saves) are its outs : a window is stored as its locals, then its outs, at its %i6.
+ *
+ * The registers are a single array of words : the globals, then the outs and locals of each window, so that the
+ * registers of the current window are at a base pointer (computed when the window changes) plus their number.
+ * The ins of the last window are the outs of the first one : they are kept after the last window while it is
+ * the current one, and copied back when it is left. %g0 is a word of the array set back to zero after each write.
+ *
+ * The window is changed by save() and restore(), which write the CWP field; whoever else writes the PSR (WRPSR,
+ * the tools) calls update() for the base pointer to follow it.
+ *
+ * In the unbounded mode (not a SPARC one), the windows do not wrap : each save takes a window after the current one
+ * in the array, which grows as deep as the calls go, so that there is never a window to spill nor to fill. The
+ * CWP still counts modulo the number of windows, and the WIM moves as the spills and fills of the host would move
+ * it (see spill()), so that a program reading them sees the same as with windows handled by the host.
  */
 class WindowRegisters {
 	public:
     /**
      * Constructor
-     * @param wsize size of the window
+     * @param wsize number of windows (at least 2)
      * @param psr processor state register
      * @param wim window invalid mask register
+     * @param unbounded true for the windows to grow instead of wrapping
      */
-		WindowRegisters(const uint32_t wsize, SpecialRegister* psr, SpecialRegister* wim);
+		WindowRegisters(const uint32_t wsize, SpecialRegister* psr, SpecialRegister* wim, bool unbounded = false);
     /**
      * Destructor
      */
-		~WindowRegisters();
+		virtual ~WindowRegisters();
 
     /**
      * Get the window size
      * @returns window size
      */
     uint32_t getWindowSize() const;
+    /**
+     * Tells if the windows grow instead of wrapping
+     * @returns true in the unbounded mode
+     */
+    bool isUnbounded() const;
+    /**
+     * Number of windows in the array (in the unbounded mode, as many as the deepest calls have needed)
+     * @returns the count
+     */
+    uint32_t getAllocatedWindows() const;
 
     /**
-     * Get a pointer to a register, depending on the context
+     * Get a pointer to a register, depending on the context. For %g0, it is a scratch register whose writes are
+     * discarded (it is zero when given). In the unbounded mode, the pointer is only valid until the next change
+     * of window.
      * @param nb number of the register to access
      * @returns pointer to the requested register
      */
@@ -71,12 +112,122 @@ class WindowRegisters {
      * Restore context. This basically means CWP--
      */
     void restore();
+    /**
+     * The PSR has been written : take the window of its CWP field
+     */
+    void update();
+
+    /**
+     * Tell if save() would enter a valid window (its bit of the WIM is clear, or the mode is unbounded)
+     * @returns false if a save raises a window overflow
+     */
+    bool canSave() const;
+    /**
+     * Tell if restore() would enter a valid window
+     * @returns false if a restore raises a window underflow
+     */
+    bool canRestore() const;
+    /**
+     * Handle a window overflow in the host : the window after the invalid one is stored on its stack (at its %i6,
+     * with a single block transfer), then becomes the invalid one, so that save() can proceed
+     * @param memory the memory of the stack
+     * @returns false if the stack is misaligned or the store has faulted; the WIM is left alone and the fault
+     * cleared, so that the handler of the program can take over
+     */
+    bool spill(AbstractMemory* memory);
+    /**
+     * Handle a window underflow in the host : the invalid window is loaded from its stack (the %o6 of the current
+     * window), then the one before it becomes the invalid one, so that restore() can proceed
+     * @param memory the memory of the stack
+     * @returns false if the stack is misaligned or the load has faulted (nothing is changed)
+     */
+    bool fill(AbstractMemory* memory);
+
+	protected:
+    /**
+     * Constructor for the register files that give their own array (see WindowRegisterFile), in the bounded mode
+     * @param wsize number of windows (at least 2)
+     * @param psr processor state register
+     * @param wim window invalid mask register
+     * @param file the array, of NREGGLOB+wsize*NREGWIN+NREGIO words set to zero
+     */
+    WindowRegisters(const uint32_t wsize, SpecialRegister* psr, SpecialRegister* wim, uint32_t* file);
 
-	private:
     const uint32_t _wsize;
-    Register* _registers;
+    //!< The registers : globals, outs and locals of each window, ins of the last window
+    uint32_t* _file;
+    //!< The current window : register nb (from NREGGLOB) is _window[nb]
+    uint32_t* _window;
+    uint32_t _cwp;
     SpecialRegister *_psr, *_wim;
+
+	private:
+    /**
+     * Make a window the current one
+     * @param cwp the window
+     */
+    void setWindow(uint32_t cwp);
+    /**
+     * Move in the array of the unbounded mode, which grows if it has to
+     * @param cwp the window it makes the current one
+     * @param delta number of windows to move by
+     */
+    void moveWindow(uint32_t cwp, int32_t delta);
+    /**
+     * Reallocate the array of the unbounded mode
+     * @param before number of windows to add before the first one
+     * @param after number of windows to add after the last one
+     */
+    void grow(uint32_t before, uint32_t after);
+    /**
+     * Put a Register on each word of the array
+     */
+    void makeViews();
+    /**
+     * Index of a register in the array, depending on the context
+     * @param nb number of the register
+     * @returns the index
+     */
+    uint32_t index(uint32_t nb) const;
+    /**
+     * Where the outs of a window are (those of the first one move while the last one is the current one)
+     * @param cwp the window
+     * @returns the first out
+     */
+    uint32_t* outs(uint32_t cwp);
+    /**
+     * Rotate the WIM by one window
+     * @param left true towards the next window (as a save), false towards the previous one
+     */
+    void rotateInvalid(bool left);
+
+    const bool _unbounded;
+    //!< The array, unless a derived class gives it
+    std::vector<uint32_t> _store;
+    //!< Number of windows in the array, and where the current one is
+    uint32_t _windows;
+    uint32_t _index;
+    //!< A Register on each word of the array, for get()
+    std::vector<Register> _views;
+    //!< The scratch registers of %g0
+    Register _zeros[NREGZERO];
+    uint32_t _nextzero;
 };
 
+// Register accesses are inline : they are made several times per instruction (a select and an access, no branch)
+inline uint32_t WindowRegisters::index(uint32_t nb) const {
+  return (nb < NREGGLOB ? nb : (uint32_t)(_window - _file) + nb);
+}
+
+inline uint32_t WindowRegisters::read(uint32_t nb) const {
+  return (nb < NREGGLOB ? _file : _window)[nb];
+}
+
+inline void WindowRegisters::write(uint32_t nb, uint32_t data) {
+  // writing %g0 has no effect
+  (nb < NREGGLOB ? _file : _window)[nb] = data;
+  _file[0] = 0;
+}
+
 #endif // WINDOWREGISTERS_H
 